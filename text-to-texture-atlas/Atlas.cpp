@@ -0,0 +1,274 @@
+#include "Atlas.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#pragma region constructor
+text_to_texture_atlas::Atlas::Atlas
+(
+	const atlas_settings& settings
+)
+	: settings_(settings)
+{
+	settings_.channels = settings_.channels == 1 ? 1u : 4u;
+	settings_.max_pages = std::clamp(settings_.max_pages, 1u, 256u);
+}
+#pragma endregion
+
+#pragma region allocate
+bool text_to_texture_atlas::Atlas::allocate
+(
+	const unsigned int width,
+	const unsigned int height,
+	atlas_slot& slot
+)
+{
+	std::lock_guard lock{ mutex_ };
+	for (unsigned int page = 0; page < pages_.size(); page++)
+	{
+		if (pages_[page]->packer.insert(width, height, slot.rect))
+		{
+			slot.page = page;
+			return true;
+		}
+	}
+
+	if (pages_.size() >= settings_.max_pages)
+	{
+		return false;
+	}
+	online_packer packer{ settings_.page_width, settings_.page_height, settings_.packing };
+	if (!packer.insert(width, height, slot.rect))
+	{
+		return false;
+	}
+
+	// New pages start zeroed, so only what is written later needs uploading.
+	const std::size_t page_bytes{ get_row_pitch() * settings_.page_height };
+	pages_.push_back(std::make_unique<atlas_page>(atlas_page{
+		.pixels = std::pmr::vector<unsigned char>(page_bytes, settings_.resource ? settings_.resource : std::pmr::get_default_resource()),
+		.packer = std::move(packer) }));
+	slot.page = static_cast<unsigned int>(pages_.size() - 1);
+	return true;
+}
+#pragma endregion
+
+#pragma region write
+bool text_to_texture_atlas::Atlas::write
+(
+	const atlas_slot& slot,
+	const std::span<const unsigned char> pixels,
+	const unsigned int channels
+)
+{
+	const atlas_rect& rect{ slot.rect };
+	const std::size_t source_row_bytes{ static_cast<std::size_t>(rect.width) * channels };
+	if ((channels != 1 && channels != 4) || pixels.size() < source_row_bytes * rect.height)
+	{
+		return false;
+	}
+
+	std::lock_guard lock{ mutex_ };
+	if (slot.page >= pages_.size() || rect.x + rect.width > settings_.page_width || rect.y + rect.height > settings_.page_height)
+	{
+		return false;
+	}
+
+	auto& page{ *pages_[slot.page] };
+	const std::size_t row_pitch{ get_row_pitch() };
+	for (unsigned int y = 0; y < rect.height; y++)
+	{
+		const unsigned char* source_row{ pixels.data() + y * source_row_bytes };
+		unsigned char* destination{ page.pixels.data() + (rect.y + y) * row_pitch + static_cast<std::size_t>(rect.x) * settings_.channels };
+		if (channels == settings_.channels)
+		{
+			std::memcpy(destination, source_row, source_row_bytes);
+			continue;
+		}
+		for (unsigned int x = 0; x < rect.width; x++)
+		{
+			const unsigned char coverage{ source_row[static_cast<std::size_t>(x) * channels + (channels - 1)] };
+			if (settings_.channels == 4)
+			{
+				*destination++ = 0;
+				*destination++ = 0;
+				*destination++ = 0;
+			}
+			*destination++ = coverage;
+		}
+	}
+	mark_dirty(page, rect);
+	return true;
+}
+#pragma endregion
+
+#pragma region release
+bool text_to_texture_atlas::Atlas::release
+(
+	const atlas_slot& slot
+)
+{
+	std::lock_guard lock{ mutex_ };
+	if (slot.page >= pages_.size() || !pages_[slot.page]->packer.remove(slot.rect))
+	{
+		return false;
+	}
+
+	// A smaller rect placed here later would otherwise sit next to stale pixels inside its gap.
+	auto& page{ *pages_[slot.page] };
+	const std::size_t row_pitch{ get_row_pitch() };
+	const std::size_t row_bytes{ static_cast<std::size_t>(slot.rect.width) * settings_.channels };
+	for (unsigned int y = 0; y < slot.rect.height; y++)
+	{
+		std::memset(page.pixels.data() + (slot.rect.y + y) * row_pitch + static_cast<std::size_t>(slot.rect.x) * settings_.channels, 0, row_bytes);
+	}
+	mark_dirty(page, slot.rect);
+	return true;
+}
+#pragma endregion
+
+#pragma region mark_dirty
+void text_to_texture_atlas::Atlas::mark_dirty
+(
+	atlas_page& page,
+	const atlas_rect& rect
+)
+{
+	if (!rect.width || !rect.height)
+	{
+		return;
+	}
+	if (!page.has_dirty)
+	{
+		page.dirty = rect;
+		page.has_dirty = true;
+		return;
+	}
+
+	const unsigned int left{ std::min(page.dirty.x, rect.x) };
+	const unsigned int top{ std::min(page.dirty.y, rect.y) };
+	const unsigned int right{ std::max(page.dirty.x + page.dirty.width, rect.x + rect.width) };
+	const unsigned int bottom{ std::max(page.dirty.y + page.dirty.height, rect.y + rect.height) };
+	page.dirty = { .x = left, .y = top, .width = right - left, .height = bottom - top };
+}
+#pragma endregion
+
+#pragma region take_dirty_region
+bool text_to_texture_atlas::Atlas::take_dirty_region
+(
+	const unsigned int page,
+	atlas_rect& region
+)
+{
+	std::lock_guard lock{ mutex_ };
+	if (page >= pages_.size() || !pages_[page]->has_dirty)
+	{
+		return false;
+	}
+	region = pages_[page]->dirty;
+	pages_[page]->has_dirty = false;
+	return true;
+}
+#pragma endregion
+
+#pragma region get_page_count
+unsigned int text_to_texture_atlas::Atlas::get_page_count() const
+{
+	std::lock_guard lock{ mutex_ };
+	return static_cast<unsigned int>(pages_.size());
+}
+#pragma endregion
+
+#pragma region get_page_pixels
+std::span<const unsigned char> text_to_texture_atlas::Atlas::get_page_pixels
+(
+	const unsigned int page
+) const
+{
+	std::lock_guard lock{ mutex_ };
+	return page < pages_.size() ? std::span<const unsigned char>{ pages_[page]->pixels } : std::span<const unsigned char>{};
+}
+#pragma endregion
+
+#pragma region get_occupancy
+double text_to_texture_atlas::Atlas::get_occupancy
+(
+	const unsigned int page
+) const
+{
+	std::lock_guard lock{ mutex_ };
+	return page < pages_.size() ? pages_[page]->packer.get_occupancy() : 0.0;
+}
+#pragma endregion
+
+#pragma region atlas_allocation
+text_to_texture_atlas::atlas_allocation::atlas_allocation
+(
+	Atlas* atlas
+)
+	: atlas_(atlas)
+{
+}
+
+text_to_texture_atlas::atlas_allocation::atlas_allocation
+(
+	atlas_allocation&& other
+) noexcept
+	: atlas_(std::exchange(other.atlas_, nullptr)),
+	slots_(std::move(other.slots_))
+{
+	other.slots_.clear();
+}
+
+text_to_texture_atlas::atlas_allocation& text_to_texture_atlas::atlas_allocation::operator=
+(
+	atlas_allocation&& other
+) noexcept
+{
+	if (this != &other)
+	{
+		reset();
+		atlas_ = std::exchange(other.atlas_, nullptr);
+		slots_ = std::move(other.slots_);
+		other.slots_.clear();
+	}
+	return *this;
+}
+
+text_to_texture_atlas::atlas_allocation::~atlas_allocation()
+{
+	reset();
+}
+#pragma endregion
+
+#pragma region atlas_allocation::allocate
+bool text_to_texture_atlas::atlas_allocation::allocate
+(
+	const unsigned int width,
+	const unsigned int height,
+	atlas_slot& slot
+)
+{
+	if (!atlas_ || !atlas_->allocate(width, height, slot))
+	{
+		return false;
+	}
+	slots_.push_back(slot);
+	return true;
+}
+#pragma endregion
+
+#pragma region atlas_allocation::reset
+void text_to_texture_atlas::atlas_allocation::reset()
+{
+	if (atlas_)
+	{
+		for (const auto& slot : slots_)
+		{
+			atlas_->release(slot);
+		}
+	}
+	slots_.clear();
+}
+#pragma endregion
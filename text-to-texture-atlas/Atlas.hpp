@@ -0,0 +1,195 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include "OnlinePacker.hpp"
+
+namespace text_to_texture_atlas
+{
+	/**
+	 * @brief
+	 * The page size, format and packing of an `Atlas`.
+	 */
+	struct atlas_settings
+	{
+		unsigned int page_width{ 1024 };		///< Width of every page in pixels.
+		unsigned int page_height{ 1024 };		///< Height of every page in pixels.
+		unsigned int channels{ 4 };				///< 4 for RGBA8 pages, 1 for R8 pages.
+		unsigned int max_pages{ 1 };			///< Pages are added on demand up to this many (at most 256, the range of `glyph_record::page`).
+		online_packer_settings packing{};		///< The gaps and shelf sizes used on every page.
+		std::pmr::memory_resource* resource{};	///< Where the page pixels come from (null = the default resource).
+	};
+
+	/**
+	 * @brief
+	 * A rect reserved in an `Atlas`: the page it is on and where.
+	 */
+	struct atlas_slot
+	{
+		unsigned int page{};	///< The index of the page.
+		atlas_rect rect{};		///< The rect on the page, in pixels.
+
+		bool operator==(const atlas_slot&) const = default;
+	};
+
+	/**
+	 * @brief
+	 * One texture of an `Atlas`: its pixels, its packer and the region written since the last upload.
+	 */
+	struct atlas_page
+	{
+		std::pmr::vector<unsigned char> pixels{};	///< The page pixels, `page_width * channels` bytes per row.
+		online_packer packer;						///< The free space on the page.
+		atlas_rect dirty{};							///< The bounding rect of every write since `take_dirty_region`.
+		bool has_dirty{};							///< Whether `dirty` holds anything.
+	};
+
+	/**
+	 * @brief
+	 * **Texture pages shared by many fonts, with their packing and dirty tracking.**
+	 *
+	 * @details
+	 * A `Font` normally owns its atlas, so a UI with a few faces, sizes and icon sets binds a few
+	 * textures. An `Atlas` owns the pixels instead: fonts built with `build_options::shared_atlas`
+	 * reserve a slot per glyph here and copy their glyphs in, keeping only their glyph-to-slot
+	 * mapping (`character::page_` and its coordinates). The whole UI then draws from one page, or a
+	 * few when `max_pages` allows.
+	 *
+	 * Each page is packed by an `online_packer`, so slots can be freed and reused: a font releases
+	 * its slots when it is destroyed, and a font built later fills the space. Every write and
+	 * release grows the page's dirty rect, so only the changed part needs to be uploaded.
+	 *
+	 * *Usage Example:*
+	 *
+	 * @code
+	 * text_to_texture_atlas::Atlas atlas{ { .page_width = 2048, .page_height = 2048 } };
+	 *
+	 * text_to_texture_atlas::build_options options{};
+	 * options.shared_atlas = &atlas;
+	 * auto body = text_to_texture_atlas::Font::Font_Px("Inter-Regular.ttf", 16, 0, options);
+	 * auto heading = text_to_texture_atlas::Font::Font_Px("Inter-Bold.ttf", 32, 0, options);
+	 *
+	 * // Every frame, before drawing:
+	 * text_to_texture_atlas::atlas_rect region{};
+	 * for (unsigned int page = 0; page < atlas.get_page_count(); page++) {
+	 *     if (atlas.take_dirty_region(page, region)) {
+	 *         upload_sub_image(textures[page], region, atlas.get_page_pixels(page), atlas.get_row_pitch());
+	 *     }
+	 * }
+	 * @endcode
+	 *
+	 * @note Reserving, writing and releasing slots are thread-safe, so fonts can be built into the
+	 * same atlas from several threads. Page pixels must not be read while a font is being built into
+	 * or destroyed from the atlas. The atlas must outlive every font built into it.
+	 */
+	class Atlas
+	{
+		atlas_settings settings_{};			// The page size, format and packing.
+		std::vector<std::unique_ptr<atlas_page>> pages_{};	// The pages added so far; held by pointer so adding one never copies or moves the others.
+		mutable std::mutex mutex_{};		// Guards `pages_` between threads building fonts.
+
+		void mark_dirty(atlas_page& page, const atlas_rect& rect);	// Grows a page's dirty rect to cover `rect`.
+
+	public:
+		/**
+		 * @brief Creates an atlas with no pages; the first is added by the first `allocate`.
+		 */
+		explicit Atlas(const atlas_settings& settings = {});
+
+		Atlas(const Atlas&) = delete;
+		Atlas& operator=(const Atlas&) = delete;
+
+		/**
+		 * @brief Reserves a rect on the first page with room, adding a page if none has and `max_pages` allows.
+		 *
+		 * @param width The rect width in pixels.
+		 * @param height The rect height in pixels.
+		 * @param slot Receives the page and rect.
+		 *
+		 * @return true if the rect was reserved, false if no page has room and no page can be added.
+		 */
+		bool allocate(unsigned int width, unsigned int height, atlas_slot& slot);
+
+		/**
+		 * @brief Copies pixels into a reserved slot and marks it dirty.
+		 *
+		 * @details Pixels with as many channels as the atlas are copied. Otherwise they are treated
+		 * as glyph coverage: a single channel goes into the alpha of an RGBA8 page, and only the
+		 * alpha of RGBA pixels goes into an R8 page.
+		 *
+		 * @param slot A slot returned by `allocate`.
+		 * @param pixels The pixels, `slot.rect.width * channels` bytes per row, top row first.
+		 * @param channels The channels of `pixels`, 1 or 4.
+		 *
+		 * @return true if the pixels were copied, false if the slot is outside the pages or there are too few pixels.
+		 */
+		bool write(const atlas_slot& slot, std::span<const unsigned char> pixels, unsigned int channels);
+
+		/**
+		 * @brief Clears a slot and frees it for reuse.
+		 *
+		 * @return true if the slot was freed, false if it was not reserved.
+		 */
+		bool release(const atlas_slot& slot);
+
+		/**
+		 * @brief Returns the region of a page written or cleared since the last call, and resets it.
+		 *
+		 * @return true if `region` was set, false if nothing on the page changed.
+		 */
+		bool take_dirty_region(unsigned int page, atlas_rect& region);
+
+		/// Returns the number of pages added so far.
+		unsigned int get_page_count() const;
+
+		/// Returns a page's pixels, `get_row_pitch()` bytes per row (empty if the page does not exist). The span stays valid while the atlas exists, even as pages are added.
+		std::span<const unsigned char> get_page_pixels(unsigned int page) const;
+
+		/// Returns the area of a page's slots divided by the page area, from 0 to 1.
+		double get_occupancy(unsigned int page) const;
+
+		inline unsigned int get_page_width() const { return settings_.page_width; }		// returns the width of every page in pixels.
+		inline unsigned int get_page_height() const { return settings_.page_height; }	// returns the height of every page in pixels.
+		inline unsigned int get_channels() const { return settings_.channels; }			// returns the bytes per pixel, 4 or 1.
+		inline std::size_t get_row_pitch() const { return static_cast<std::size_t>(settings_.page_width) * settings_.channels; }	// returns the bytes per page row.
+	};
+
+	/**
+	 * @brief
+	 * The slots one owner holds in an `Atlas`, released when it is destroyed.
+	 *
+	 * @details A `Font` built into a shared atlas keeps one, so its glyphs leave the atlas with it.
+	 * Moving the allocation moves the ownership.
+	 */
+	class atlas_allocation
+	{
+		Atlas* atlas_{};					// The atlas the slots are in, or null.
+		std::vector<atlas_slot> slots_{};	// The slots held.
+
+	public:
+		atlas_allocation() = default;
+		explicit atlas_allocation(Atlas* atlas);
+		atlas_allocation(atlas_allocation&& other) noexcept;
+		atlas_allocation& operator=(atlas_allocation&& other) noexcept;
+		atlas_allocation(const atlas_allocation&) = delete;
+		atlas_allocation& operator=(const atlas_allocation&) = delete;
+		~atlas_allocation();
+
+		/**
+		 * @brief Reserves a slot with `Atlas::allocate` and holds it.
+		 *
+		 * @return true if the slot was reserved, false if there is no atlas or it has no room.
+		 */
+		bool allocate(unsigned int width, unsigned int height, atlas_slot& slot);
+
+		/// Releases every slot held.
+		void reset();
+
+		inline Atlas* get_atlas() const { return atlas_; }										// returns the atlas, or null.
+		inline const std::vector<atlas_slot>& get_slots() const { return slots_; }				// returns the slots held.
+	};
+}
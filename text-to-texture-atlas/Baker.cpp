@@ -0,0 +1,311 @@
+#include "Baker.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <ranges>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "Hash.hpp"
+
+namespace
+{
+	// Bump whenever the baker's output changes for identical inputs, so old stamps stop matching.
+	constexpr std::uint32_t baker_output_version{ 1 };
+
+	std::string to_hex(const std::uint64_t value)
+	{
+		std::ostringstream stream{};
+		stream << std::hex << std::setw(16) << std::setfill('0') << value;
+		return stream.str();
+	}
+
+	std::string json_escape(const std::string_view text)
+	{
+		std::string escaped{};
+		escaped.reserve(text.size());
+		for (const char c : text)
+		{
+			switch (c)
+			{
+			case '"': escaped += "\\\""; break;
+			case '\\': escaped += "\\\\"; break;
+			case '\n': escaped += "\\n"; break;
+			case '\t': escaped += "\\t"; break;
+			default: escaped += c; break;
+			}
+		}
+		return escaped;
+	}
+
+	std::filesystem::path with_suffix(const std::filesystem::path& output, const std::string_view suffix)
+	{
+		return std::filesystem::path{ output.string() + std::string{ suffix } };
+	}
+
+	// A temporary file suffix no other write uses: the process id tells concurrent bakers apart,
+	// and the counter every write within this one.
+	std::string make_temporary_suffix()
+	{
+		static std::atomic<std::uint64_t> counter{};
+#ifdef _WIN32
+		const auto process{ static_cast<std::uint64_t>(GetCurrentProcessId()) };
+#else
+		const auto process{ static_cast<std::uint64_t>(getpid()) };
+#endif
+		return ".tmp" + std::to_string(process) + "-" + std::to_string(counter.fetch_add(1, std::memory_order_relaxed));
+	}
+
+	// Writes to a temporary file of its own and renames it into place, so readers and concurrent
+	// bakers never observe a half-written file.
+	bool write_file_atomically(const std::filesystem::path& path, const std::function<void(std::ostream&)>& write)
+	{
+		std::error_code error{};
+		std::filesystem::create_directories(path.parent_path(), error);
+
+		const auto temporary{ with_suffix(path, make_temporary_suffix()) };
+		{
+			std::ofstream file{ temporary, std::ios::binary | std::ios::trunc };
+			if (!file)
+			{
+				return false;
+			}
+			write(file);
+			if (!file.flush())
+			{
+				return false;
+			}
+		}
+
+		std::filesystem::rename(temporary, path, error);
+		if (error)
+		{
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+		return true;
+	}
+
+	bool read_stamp(const std::filesystem::path& path, std::uint64_t& input_hash, std::uint64_t& content_hash)
+	{
+		std::ifstream file{ path };
+		std::string input_key{};
+		std::string content_key{};
+		file >> input_key >> std::hex >> input_hash >> content_key >> content_hash;
+		return file && input_key == "input" && content_key == "content";
+	}
+
+	void write_pam(std::ostream& out, const unsigned char* pixels, const unsigned int width, const unsigned int height, const unsigned int channels)
+	{
+		out << "P7\nWIDTH " << width << "\nHEIGHT " << height << "\nDEPTH " << channels
+			<< "\nMAXVAL 255\nTUPLTYPE " << (channels == 4 ? "RGB_ALPHA" : "GRAYSCALE") << "\nENDHDR\n";
+		out.write(reinterpret_cast<const char*>(pixels), static_cast<std::streamsize>(static_cast<size_t>(width) * height * channels));
+	}
+
+	void write_metrics(std::ostream& out, text_to_texture_atlas::Font& font, const text_to_texture_atlas::baker::manifest_entry& entry, const std::uint64_t input_hash)
+	{
+		const auto& atlas{ font.get_main_atlas() };
+
+		std::vector<char32_t> codepoints{};
+		codepoints.reserve(font.get_characters().size());
+		for (const auto& codepoint : font.get_characters() | std::views::keys)
+		{
+			codepoints.push_back(codepoint);
+		}
+		std::ranges::sort(codepoints);
+
+		out << std::setprecision(9);
+		out << "{\n";
+		out << "  \"name\": \"" << json_escape(entry.name) << "\",\n";
+		out << "  \"font\": \"" << json_escape(entry.font.generic_string()) << "\",\n";
+		out << "  \"input_hash\": \"" << to_hex(input_hash) << "\",\n";
+		out << "  \"content_hash\": \"" << to_hex(font.get_content_hash()) << "\",\n";
+		out << "  \"atlas\": { \"file\": \"" << json_escape(with_suffix(entry.output, ".pam").filename().generic_string())
+			<< "\", \"width\": " << atlas.width << ", \"height\": " << atlas.height << ", \"channels\": " << atlas.channels << " },\n";
+		out << "  \"glyphs\": [";
+
+		bool first{ true };
+		for (const auto codepoint : codepoints)
+		{
+			const auto& glyph{ *font.find_character(codepoint) };
+			out << (first ? "\n" : ",\n");
+			out << "    { \"codepoint\": " << static_cast<std::uint32_t>(codepoint)
+				<< ", \"width\": " << glyph.width_ << ", \"height\": " << glyph.height_
+				<< ", \"bearing_x\": " << glyph.x_bearing_ << ", \"bearing_y\": " << glyph.y_bearing_
+				<< ", \"advance_x\": " << glyph.advance_x_ << ", \"advance_y\": " << glyph.advance_y_;
+			if (entry.vertical_metrics)
+			{
+				out << ", \"vertical_bearing_x\": " << glyph.vertical_x_bearing_ << ", \"vertical_bearing_y\": " << glyph.vertical_y_bearing_;
+			}
+			out << ", \"x\": " << glyph.top_left.x << ", \"y\": " << glyph.top_left.y
+				<< ", \"u0\": " << glyph.tex_coords_top_left.x << ", \"v0\": " << glyph.tex_coords_top_left.y
+				<< ", \"u1\": " << glyph.tex_coords_bottom_right.x << ", \"v1\": " << glyph.tex_coords_bottom_right.y << " }";
+			first = false;
+		}
+		out << "\n  ]\n}\n";
+	}
+}
+
+#pragma region bake_entry
+text_to_texture_atlas::baker::bake_result text_to_texture_atlas::baker::bake_entry
+(
+	const manifest_entry& entry,
+	const bake_settings& settings,
+	const unsigned int blit_threads
+)
+{
+	const auto start{ std::chrono::steady_clock::now() };
+	bake_result result{};
+	result.name = entry.name;
+
+	const auto finish = [&](const bake_status status)
+	{
+		result.status = status;
+		result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return result;
+	};
+
+	if (!hash_file(entry.font, result.font_hash))
+	{
+		result.error = "cannot read font '" + entry.font.string() + "'";
+		return finish(bake_status::failed);
+	}
+
+	content_hasher input_hasher{};
+	input_hasher.update_value(baker_output_version);
+	input_hasher.update_value(result.font_hash);
+	input_hasher.update_value(hash_entry_settings(entry));
+	result.input_hash = input_hasher.digest();
+
+	const auto image_path{ with_suffix(entry.output, ".pam") };
+	const auto metrics_path{ with_suffix(entry.output, ".json") };
+	const auto stamp_path{ with_suffix(entry.output, ".stamp") };
+
+	if (!settings.force)
+	{
+		std::uint64_t stamped_input{};
+		std::uint64_t stamped_content{};
+		if (read_stamp(stamp_path, stamped_input, stamped_content) && stamped_input == result.input_hash
+			&& std::filesystem::exists(image_path) && std::filesystem::exists(metrics_path))
+		{
+			result.content_hash = stamped_content;
+			return finish(bake_status::skipped);
+		}
+	}
+
+	auto options{ to_build_options(entry) };
+	options.blit_threads = blit_threads;
+	options.cache = settings.cache;
+	options.pack = settings.pack;
+
+	auto font = entry.size.unit == size_unit::pt
+		? Font::Font_Pt(entry.font.string(), entry.size.pt_size, entry.size.width_dpi, entry.size.height_dpi, options)
+		: Font::Font_Px(entry.font.string(), entry.size.height_px, entry.size.width_px, options);
+	if (!font)
+	{
+		const auto& issues{ font.get_issues() };
+		const auto failure{ std::ranges::find(issues, issue_severity::error, &build_issue::severity) };
+		result.error = failure != issues.end() ? "font build failed: " + describe(*failure) : "font build failed";
+		return finish(bake_status::failed);
+	}
+
+	const auto& atlas{ font.get_main_atlas() };
+	result.content_hash = font.get_content_hash();
+	result.width = atlas.width;
+	result.height = atlas.height;
+	result.glyph_count = font.get_characters().size();
+
+	const bool written{
+		write_file_atomically(image_path, [&](std::ostream& out) { write_pam(out, atlas.atlas_buffer.data(), atlas.width, atlas.height, atlas.channels); })
+		&& write_file_atomically(metrics_path, [&](std::ostream& out) { write_metrics(out, font, entry, result.input_hash); })
+		&& write_file_atomically(stamp_path, [&](std::ostream& out) { out << "input " << to_hex(result.input_hash) << "\ncontent " << to_hex(result.content_hash) << "\n"; })
+	};
+	if (!written)
+	{
+		result.error = "cannot write outputs to '" + entry.output.string() + "'";
+		return finish(bake_status::failed);
+	}
+
+	return finish(bake_status::built);
+}
+#pragma endregion
+
+#pragma region bake_manifest
+std::vector<text_to_texture_atlas::baker::bake_result> text_to_texture_atlas::baker::bake_manifest
+(
+	const manifest& source,
+	const bake_settings& settings,
+	std::ostream& out
+)
+{
+	const auto start{ std::chrono::steady_clock::now() };
+	std::vector<bake_result> results(source.entries.size());
+
+	unsigned int jobs{ settings.jobs ? settings.jobs : std::max(1u, std::thread::hardware_concurrency()) };
+	jobs = std::min<unsigned int>(jobs, static_cast<unsigned int>(std::max<size_t>(source.entries.size(), 1)));
+
+	// With several entries in flight the entries already fill the machine, so each atlas blits on one thread.
+	const unsigned int blit_threads{ jobs > 1 ? 1u : 0u };
+
+	std::atomic<size_t> next_entry{};
+	std::mutex output_mutex{};
+
+	const auto worker = [&]
+	{
+		for (size_t i = next_entry++; i < source.entries.size(); i = next_entry++)
+		{
+			results[i] = bake_entry(source.entries[i], settings, blit_threads);
+			const auto& result{ results[i] };
+
+			std::lock_guard lock{ output_mutex };
+			out << std::left << std::fixed << std::setprecision(2);
+			switch (result.status)
+			{
+			case bake_status::built:
+				out << "[built]   " << std::setw(24) << result.name << std::right << std::setw(10) << result.milliseconds << " ms  "
+					<< result.width << "x" << result.height << "  " << result.glyph_count << " glyphs  " << to_hex(result.content_hash) << "\n";
+				break;
+			case bake_status::skipped:
+				out << "[skipped] " << std::setw(24) << result.name << std::right << std::setw(10) << result.milliseconds << " ms  unchanged  "
+					<< to_hex(result.content_hash) << "\n";
+				break;
+			case bake_status::failed:
+				out << "[failed]  " << std::setw(24) << result.name << std::right << std::setw(10) << result.milliseconds << " ms  "
+					<< result.error << "\n";
+				break;
+			}
+		}
+	};
+
+	{
+		std::vector<std::jthread> workers{};
+		for (unsigned int i = 1; i < jobs; i++)
+		{
+			workers.emplace_back(worker);
+		}
+		worker();
+	}
+
+	const auto count = [&](const bake_status status)
+	{
+		return std::ranges::count(results, status, &bake_result::status);
+	};
+	out << "built " << count(bake_status::built) << ", skipped " << count(bake_status::skipped) << ", failed " << count(bake_status::failed)
+		<< " in " << std::fixed << std::setprecision(2)
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms (" << jobs << " jobs)\n";
+	return results;
+}
+#pragma endregion
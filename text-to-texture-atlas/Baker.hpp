@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Manifest.hpp"
+
+namespace text_to_texture_atlas::baker
+{
+	/**
+	 * @brief
+	 * Settings for a whole bake run.
+	 */
+	struct bake_settings
+	{
+		unsigned int jobs{ 0 };		///< Number of entries built at the same time (0 = one per hardware thread).
+		bool force{ false };		///< Rebuild every entry even if its inputs are unchanged.
+		glyph_cache* cache{ nullptr };	///< Rasterized glyphs shared between entries and bakes (null = no caching).
+		glyph_pack* pack{ nullptr };	///< An open on-disk glyph pack shared with other bakers (null = none).
+	};
+
+	/**
+	 * @brief
+	 * What happened to a single entry.
+	 */
+	enum class bake_status
+	{
+		built,		///< The atlas was built and written.
+		skipped,	///< The inputs matched the previous bake, the existing outputs were kept.
+		failed		///< The entry could not be built or written, see `bake_result::error`.
+	};
+
+	/**
+	 * @brief
+	 * The outcome and timing of a single entry.
+	 */
+	struct bake_result
+	{
+		std::string name{};				///< The entry name.
+		bake_status status{ bake_status::failed };	///< What happened.
+		double milliseconds{};			///< Wall time spent on the entry, including hashing and writing.
+		std::uint64_t font_hash{};		///< Hash of the font file contents (0 if it could not be read).
+		std::uint64_t input_hash{};		///< Hash of the font file and every setting of the entry.
+		std::uint64_t content_hash{};	///< `Font::get_content_hash()` of the result (from the stamp when skipped).
+		unsigned int width{};			///< Atlas width in pixels (0 when skipped or failed).
+		unsigned int height{};			///< Atlas height in pixels (0 when skipped or failed).
+		std::size_t glyph_count{};		///< Number of characters loaded (0 when skipped or failed).
+		std::string error{};			///< A description of the failure, empty otherwise.
+	};
+
+	/**
+	 * @brief
+	 * Bakes one manifest entry into `<output>.pam`, `<output>.json` and `<output>.stamp`.
+	 *
+	 * @details
+	 * The input hash covers the font file contents and every setting of the entry. When the
+	 * stamp of a previous bake holds the same input hash and both outputs still exist, the
+	 * entry is skipped. Every file is written to a temporary name and renamed into place, and
+	 * the stamp is written last, so an interrupted bake is never mistaken for a finished one.
+	 *
+	 * - `.pam` is a Netpbm PAM image (`RGB_ALPHA` or `GRAYSCALE`), readable by most image tools.
+	 * - `.json` holds the atlas size, content hash and per-character metrics and coordinates.
+	 *
+	 * @param entry The entry to bake.
+	 * @param settings `force`, `cache` and `pack` apply; `jobs` is ignored.
+	 * @param blit_threads Passed to `build_options::blit_threads`.
+	 *
+	 * @return The outcome of the entry.
+	 */
+	bake_result bake_entry(const manifest_entry& entry, const bake_settings& settings = {}, unsigned int blit_threads = 0);
+
+	/**
+	 * @brief
+	 * **Bakes every entry of a manifest in parallel and prints a line per entry.**
+	 *
+	 * @code
+	 * text_to_texture_atlas::baker::manifest manifest{};
+	 * std::string error{};
+	 * if (!text_to_texture_atlas::baker::parse_manifest("atlases.ini", manifest, error)) {
+	 *     std::cerr << error << "\n";
+	 *     return 2;
+	 * }
+	 * auto results = text_to_texture_atlas::baker::bake_manifest(manifest, { .jobs = 8 });
+	 * @endcode
+	 *
+	 * @param source The parsed manifest.
+	 * @param settings Parallelism and rebuild settings.
+	 * @param out The stream progress lines and the summary are written to.
+	 *
+	 * @return One result per entry, in manifest order.
+	 */
+	std::vector<bake_result> bake_manifest(const manifest& source, const bake_settings& settings = {}, std::ostream& out = std::cout);
+}
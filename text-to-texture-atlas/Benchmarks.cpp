@@ -0,0 +1,610 @@
+#include "Benchmarks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <sstream>
+
+#include <freetype/freetype.h>
+#include FT_FREETYPE_H
+
+#include "OnlinePacker.hpp"
+#include "Rasterizer.hpp"
+
+namespace
+{
+	using text_to_texture_atlas::atlas_rect;
+	using text_to_texture_atlas::benchmarks::packed_page;
+	using text_to_texture_atlas::benchmarks::packed_rects;
+
+	// Wraps a single-page packer that places rects in place: one page, whatever its size.
+	template <typename Pack>
+	bool pack_single_page(const std::span<const atlas_rect> sizes, packed_rects& result, Pack&& pack)
+	{
+		result.rects.assign(sizes.begin(), sizes.end());
+		result.pages.assign(sizes.size(), 0);
+		packed_page page{};
+		if (!pack(std::span<atlas_rect>{ result.rects }, page.width, page.height))
+		{
+			return false;
+		}
+		result.page_sizes = { page };
+		return true;
+	}
+
+	bool pack_grid_heuristic(const std::span<const atlas_rect> sizes, unsigned int, const unsigned int spacing, packed_rects& result)
+	{
+		unsigned int cell_width{};
+		unsigned int cell_height{};
+		for (const auto& size : sizes)
+		{
+			cell_width = std::max(cell_width, size.width);
+			cell_height = std::max(cell_height, size.height);
+		}
+		return pack_single_page(sizes, result, [&](const std::span<atlas_rect> rects, unsigned int& width, unsigned int& height)
+		{
+			return text_to_texture_atlas::pack_grid(rects, cell_width, cell_height, width, height, spacing);
+		});
+	}
+
+	bool pack_shelf_heuristic(const std::span<const atlas_rect> sizes, unsigned int, const unsigned int spacing, packed_rects& result)
+	{
+		return pack_single_page(sizes, result, [&](const std::span<atlas_rect> rects, unsigned int& width, unsigned int& height)
+		{
+			return text_to_texture_atlas::pack_shelf(rects, width, height, spacing);
+		});
+	}
+
+	// Tallest first, then widest first, as `placement_order::size` orders characters.
+	std::vector<std::size_t> get_order_by_height(const std::span<const atlas_rect> sizes)
+	{
+		std::vector<std::size_t> order(sizes.size());
+		std::iota(order.begin(), order.end(), std::size_t{});
+		std::ranges::stable_sort(order, [&](const std::size_t a, const std::size_t b)
+		{
+			if (sizes[a].height != sizes[b].height) { return sizes[a].height > sizes[b].height; }
+			return sizes[a].width > sizes[b].width;
+		});
+		return order;
+	}
+
+	bool pack_sorted_shelf_heuristic(const std::span<const atlas_rect> sizes, unsigned int, const unsigned int spacing, packed_rects& result)
+	{
+		const auto order{ get_order_by_height(sizes) };
+		std::vector<atlas_rect> sorted(sizes.size());
+		for (std::size_t i = 0; i < order.size(); i++)
+		{
+			sorted[i] = sizes[order[i]];
+		}
+		packed_page page{};
+		text_to_texture_atlas::pack_shelf(sorted, page.width, page.height, spacing);
+
+		result.rects.resize(sizes.size());
+		for (std::size_t i = 0; i < order.size(); i++)
+		{
+			result.rects[order[i]] = sorted[i];
+		}
+		result.pages.assign(sizes.size(), 0);
+		result.page_sizes = { page };
+		return true;
+	}
+
+	// The width `pack_shelf` would choose (roughly square), capped at the page limit.
+	unsigned int get_page_width(const std::span<const atlas_rect> sizes, const unsigned int max_page_size, const unsigned int spacing)
+	{
+		unsigned long long total_area{};
+		unsigned int max_width{};
+		for (const auto& size : sizes)
+		{
+			total_area += static_cast<unsigned long long>(size.width + spacing) * (size.height + spacing);
+			max_width = std::max(max_width, size.width);
+		}
+		return std::min(max_page_size, std::max(
+			static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<double>(total_area)))) + spacing,
+			max_width + spacing * 2));
+	}
+
+	// Skyline bottom-left: the top edge of everything placed is kept as a list of horizontal
+	// segments, and each rect (tallest first) goes where its top ends lowest. A rect that fits
+	// nowhere starts a new page.
+	bool pack_skyline_heuristic(const std::span<const atlas_rect> sizes, const unsigned int max_page_size, const unsigned int spacing, packed_rects& result)
+	{
+		struct segment
+		{
+			unsigned int x{};
+			unsigned int y{};
+			unsigned int width{};
+		};
+
+		const unsigned int page_width{ get_page_width(sizes, max_page_size, spacing) };
+		const unsigned int page_height{ max_page_size };
+
+		result.rects.assign(sizes.begin(), sizes.end());
+		result.pages.assign(sizes.size(), 0);
+		result.page_sizes.clear();
+
+		std::vector<segment> skyline{};
+		packed_page used{};
+		const auto start_page = [&]
+		{
+			skyline = { { .x = spacing, .y = spacing, .width = page_width - spacing } };
+			used = {};
+		};
+		const auto close_page = [&]
+		{
+			result.page_sizes.push_back(used);
+		};
+		start_page();
+
+		for (const std::size_t index : get_order_by_height(sizes))
+		{
+			auto& rect{ result.rects[index] };
+			const unsigned int padded_width{ rect.width + spacing };
+			const unsigned int padded_height{ rect.height + spacing };
+			if (rect.width + spacing * 2 > page_width || rect.height + spacing * 2 > page_height)
+			{
+				return false;
+			}
+
+			for (int attempt = 0; attempt < 2; attempt++)
+			{
+				std::size_t best{ skyline.size() };
+				unsigned int best_y{};
+				unsigned int best_top{ std::numeric_limits<unsigned int>::max() };
+				for (std::size_t i = 0; i < skyline.size() && skyline[i].x + padded_width <= page_width; i++)
+				{
+					// The rect rests on the highest segment it spans.
+					unsigned int y{};
+					unsigned int spanned{};
+					for (std::size_t j = i; j < skyline.size() && spanned < padded_width; j++)
+					{
+						y = std::max(y, skyline[j].y);
+						spanned += skyline[j].width;
+					}
+					if (y + padded_height <= page_height && y + padded_height < best_top)
+					{
+						best = i;
+						best_y = y;
+						best_top = y + padded_height;
+					}
+				}
+
+				if (best == skyline.size())
+				{
+					close_page();
+					start_page();
+					continue;
+				}
+
+				rect.x = skyline[best].x;
+				rect.y = best_y;
+				result.pages[index] = static_cast<unsigned int>(result.page_sizes.size());
+				used.width = std::max(used.width, rect.x + rect.width + spacing);
+				used.height = std::max(used.height, rect.y + rect.height + spacing);
+
+				// Raise the spanned segments to the rect's top, trimming the last one it covers part of.
+				const unsigned int right{ rect.x + padded_width };
+				std::size_t end{ best };
+				while (end < skyline.size() && skyline[end].x + skyline[end].width <= right)
+				{
+					end++;
+				}
+				if (end < skyline.size() && skyline[end].x < right)
+				{
+					skyline[end].width -= right - skyline[end].x;
+					skyline[end].x = right;
+				}
+				skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(best), skyline.begin() + static_cast<std::ptrdiff_t>(end));
+				skyline.insert(skyline.begin() + static_cast<std::ptrdiff_t>(best), { .x = rect.x, .y = best_top, .width = padded_width });
+
+				// Neighbours at the same height become one segment.
+				for (std::size_t i = best > 0 ? best - 1 : 0; i + 1 < skyline.size() && i <= best; )
+				{
+					if (skyline[i].y == skyline[i + 1].y)
+					{
+						skyline[i].width += skyline[i + 1].width;
+						skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(i) + 1);
+					}
+					else
+					{
+						i++;
+					}
+				}
+				break;
+			}
+		}
+		if (used.width || used.height)
+		{
+			close_page();
+		}
+		return true;
+	}
+
+	// Inserts the rects one at a time, in the order given, into `online_packer` pages: what a
+	// runtime atlas filled on demand would produce. A rect that does not fit starts a new page.
+	// Pages are as wide as the skyline packer's, so the two compare on the same shape.
+	bool pack_online_heuristic(const std::span<const atlas_rect> sizes, const unsigned int max_page_size, const unsigned int spacing, packed_rects& result)
+	{
+		const text_to_texture_atlas::online_packer_settings settings{ .spacing = spacing };
+		const unsigned int page_width{ get_page_width(sizes, max_page_size, spacing) };
+		std::vector<text_to_texture_atlas::online_packer> pages{};
+		result.rects.assign(sizes.begin(), sizes.end());
+		result.pages.assign(sizes.size(), 0);
+		for (std::size_t i = 0; i < sizes.size(); i++)
+		{
+			if (pages.empty() || !pages.back().insert(sizes[i].width, sizes[i].height, result.rects[i]))
+			{
+				pages.emplace_back(page_width, max_page_size, settings);
+				if (!pages.back().insert(sizes[i].width, sizes[i].height, result.rects[i]))
+				{
+					return false;
+				}
+			}
+			result.pages[i] = static_cast<unsigned int>(pages.size() - 1);
+		}
+
+		// Pages are reported cropped to what they use, like the other packers'.
+		result.page_sizes.assign(pages.size(), {});
+		for (std::size_t i = 0; i < sizes.size(); i++)
+		{
+			auto& page{ result.page_sizes[result.pages[i]] };
+			page.width = std::max(page.width, result.rects[i].x + result.rects[i].width + spacing);
+			page.height = std::max(page.height, result.rects[i].y + result.rects[i].height + spacing);
+		}
+		return true;
+	}
+
+	// Checks every rect lies inside its page and overlaps no other, with one coverage bitmap per page.
+	bool validate_packing(const packed_rects& packing)
+	{
+		if (packing.rects.size() != packing.pages.size())
+		{
+			return false;
+		}
+		for (unsigned int page = 0; page < packing.page_sizes.size(); page++)
+		{
+			const auto [width, height] { packing.page_sizes[page] };
+			std::vector<bool> covered(static_cast<std::size_t>(width) * height);
+			for (std::size_t i = 0; i < packing.rects.size(); i++)
+			{
+				const auto& rect{ packing.rects[i] };
+				if (packing.pages[i] != page)
+				{
+					continue;
+				}
+				if (rect.x + rect.width > width || rect.y + rect.height > height)
+				{
+					return false;
+				}
+				for (unsigned int y = rect.y; y < rect.y + rect.height; y++)
+				{
+					for (unsigned int x = rect.x; x < rect.x + rect.width; x++)
+					{
+						const std::size_t pixel{ static_cast<std::size_t>(y) * width + x };
+						if (covered[pixel])
+						{
+							return false;
+						}
+						covered[pixel] = true;
+					}
+				}
+			}
+		}
+		return std::ranges::all_of(packing.pages, [&](const unsigned int page) { return page < packing.page_sizes.size(); });
+	}
+}
+
+#pragma region run_rasterizer_benchmark
+bool text_to_texture_atlas::benchmarks::run_rasterizer_benchmark
+(
+	const std::string& font_path,
+	const std::vector<unsigned int>& pixel_heights,
+	const unsigned int iterations,
+	std::ostream& out
+)
+{
+	constexpr int char_range_min{ 32 };
+	constexpr int char_range_max{ 126 };
+
+	FT_Library library{};
+	FT_Face face{};
+	if (FT_Init_FreeType(&library))
+	{
+		return false;
+	}
+	if (FT_New_Face(library, font_path.c_str(), 0, &face))
+	{
+		FT_Done_FreeType(library);
+		return false;
+	}
+
+	Rasterizer rasterizer{};
+	using clock = std::chrono::steady_clock;
+
+	out << std::left << std::setw(8) << "px"
+		<< std::setw(16) << "freetype (ms)"
+		<< std::setw(16) << "scanline (ms)"
+		<< std::setw(10) << "speedup"
+		<< std::setw(14) << "size diffs"
+		<< "mean abs diff\n";
+
+	for (const auto pixel_height : pixel_heights)
+	{
+		if (FT_Set_Pixel_Sizes(face, 0, pixel_height))
+		{
+			continue;
+		}
+
+		// Timing: FreeType's smooth rasterizer.
+		const auto freetype_start{ clock::now() };
+		for (unsigned int n = 0; n < iterations; n++)
+		{
+			for (int i = char_range_min; i <= char_range_max; i++)
+			{
+				if (FT_Load_Glyph(face, FT_Get_Char_Index(face, i), FT_LOAD_DEFAULT)) { continue; }
+				FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL);
+			}
+		}
+		const std::chrono::duration<double, std::milli> freetype_time{ clock::now() - freetype_start };
+
+		// Timing: the built-in scanline rasterizer.
+		const auto scanline_start{ clock::now() };
+		for (unsigned int n = 0; n < iterations; n++)
+		{
+			for (int i = char_range_min; i <= char_range_max; i++)
+			{
+				if (FT_Load_Glyph(face, FT_Get_Char_Index(face, i), FT_LOAD_DEFAULT)) { continue; }
+				if (face->glyph->format == FT_GLYPH_FORMAT_OUTLINE)
+				{
+					rasterizer.render(face->glyph->outline);
+				}
+			}
+		}
+		const std::chrono::duration<double, std::milli> scanline_time{ clock::now() - scanline_start };
+
+		// Quality: compare the two outputs glyph by glyph.
+		unsigned int size_mismatches{};
+		unsigned long long total_difference{};
+		unsigned long long compared_pixels{};
+		for (int i = char_range_min; i <= char_range_max; i++)
+		{
+			const auto glyph_index{ FT_Get_Char_Index(face, i) };
+			if (FT_Load_Glyph(face, glyph_index, FT_LOAD_DEFAULT) || face->glyph->format != FT_GLYPH_FORMAT_OUTLINE)
+			{
+				continue;
+			}
+			if (!rasterizer.render(face->glyph->outline))
+			{
+				size_mismatches++;
+				continue;
+			}
+			if (FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL))
+			{
+				continue;
+			}
+
+			const FT_Bitmap& expected{ face->glyph->bitmap };
+			const FT_Bitmap& actual{ rasterizer.get_bitmap() };
+			if (expected.width != actual.width || expected.rows != actual.rows)
+			{
+				size_mismatches++;
+				continue;
+			}
+			for (unsigned int y = 0; y < expected.rows; y++)
+			{
+				for (unsigned int x = 0; x < expected.width; x++)
+				{
+					const int a{ expected.buffer[y * expected.pitch + x] };
+					const int b{ actual.buffer[y * actual.pitch + x] };
+					total_difference += static_cast<unsigned long long>(std::abs(a - b));
+				}
+			}
+			compared_pixels += static_cast<unsigned long long>(expected.width) * expected.rows;
+		}
+
+		const double mean_difference{ compared_pixels ? static_cast<double>(total_difference) / static_cast<double>(compared_pixels) : 0.0 };
+		out << std::left << std::fixed << std::setprecision(2)
+			<< std::setw(8) << pixel_height
+			<< std::setw(16) << freetype_time.count()
+			<< std::setw(16) << scanline_time.count()
+			<< std::setw(10) << (scanline_time.count() > 0.0 ? freetype_time.count() / scanline_time.count() : 0.0)
+			<< std::setw(14) << size_mismatches
+			<< mean_difference << "\n";
+	}
+
+	FT_Done_Face(face);
+	FT_Done_FreeType(library);
+	return true;
+}
+#pragma endregion
+
+#pragma region record_glyph_rects
+bool text_to_texture_atlas::benchmarks::record_glyph_rects
+(
+	const std::string& font_path,
+	const unsigned int pixel_height,
+	const std::vector<codepoint_range>& charset,
+	glyph_rect_set& set
+)
+{
+	FT_Library library{};
+	FT_Face face{};
+	if (FT_Init_FreeType(&library))
+	{
+		return false;
+	}
+	if (FT_New_Face(library, font_path.c_str(), 0, &face) || FT_Set_Pixel_Sizes(face, 0, pixel_height))
+	{
+		FT_Done_Face(face);
+		FT_Done_FreeType(library);
+		return false;
+	}
+
+	set.rects.clear();
+	for (const auto& range : charset)
+	{
+		for (char32_t codepoint = range.first; codepoint <= range.last && codepoint >= range.first; codepoint++)
+		{
+			const FT_UInt glyph_index{ FT_Get_Char_Index(face, codepoint) };
+			if (glyph_index == 0 || FT_Load_Glyph(face, glyph_index, FT_LOAD_RENDER))
+			{
+				continue;
+			}
+			const FT_Bitmap& bitmap{ face->glyph->bitmap };
+			if (bitmap.buffer && bitmap.width && bitmap.rows)
+			{
+				set.rects.push_back({ .width = bitmap.width, .height = bitmap.rows });
+			}
+		}
+	}
+
+	FT_Done_Face(face);
+	FT_Done_FreeType(library);
+	return true;
+}
+#pragma endregion
+
+#pragma region write_rect_sets
+void text_to_texture_atlas::benchmarks::write_rect_sets
+(
+	const std::span<const glyph_rect_set> sets,
+	std::ostream& out
+)
+{
+	for (const auto& set : sets)
+	{
+		out << "set " << set.name << "\n";
+		for (const auto& rect : set.rects)
+		{
+			out << rect.width << " " << rect.height << "\n";
+		}
+	}
+}
+#pragma endregion
+
+#pragma region read_rect_sets
+bool text_to_texture_atlas::benchmarks::read_rect_sets
+(
+	std::istream& in,
+	std::vector<glyph_rect_set>& sets
+)
+{
+	std::string line{};
+	while (std::getline(in, line))
+	{
+		if (line.empty())
+		{
+			continue;
+		}
+		if (line.starts_with("set "))
+		{
+			sets.push_back({ .name = line.substr(4) });
+			continue;
+		}
+
+		std::istringstream fields{ line };
+		atlas_rect rect{};
+		if (sets.empty() || !(fields >> rect.width >> rect.height) || !(fields >> std::ws).eof())
+		{
+			return false;
+		}
+		sets.back().rects.push_back(rect);
+	}
+	return in.eof();
+}
+#pragma endregion
+
+#pragma region get_packer_heuristics
+std::vector<text_to_texture_atlas::benchmarks::packer_heuristic> text_to_texture_atlas::benchmarks::get_packer_heuristics()
+{
+	return {
+		{ .name = "grid", .pack = pack_grid_heuristic },
+		{ .name = "shelf", .pack = pack_shelf_heuristic },
+		{ .name = "shelf-by-height", .pack = pack_sorted_shelf_heuristic },
+		{ .name = "skyline", .pack = pack_skyline_heuristic },
+		{ .name = "online-shelf", .pack = pack_online_heuristic } };
+}
+#pragma endregion
+
+#pragma region run_packer_benchmark
+std::vector<text_to_texture_atlas::benchmarks::packer_result> text_to_texture_atlas::benchmarks::run_packer_benchmark
+(
+	const std::span<const glyph_rect_set> sets,
+	const std::span<const packer_heuristic> packers,
+	const unsigned int max_page_size,
+	const unsigned int iterations,
+	std::ostream& out
+)
+{
+	constexpr unsigned int spacing{ 5 };	// The gap `Font` leaves between glyphs.
+	using clock = std::chrono::steady_clock;
+
+	out << std::left << std::setw(32) << "set"
+		<< std::setw(18) << "packer"
+		<< std::setw(12) << "pack (ms)"
+		<< std::setw(12) << "occupancy %"
+		<< std::setw(14) << "largest page"
+		<< std::setw(8) << "pages"
+		<< "check\n";
+
+	std::vector<packer_result> results{};
+	for (const auto& set : sets)
+	{
+		if (set.rects.empty())
+		{
+			continue;
+		}
+		unsigned long long glyph_area{};
+		for (const auto& rect : set.rects)
+		{
+			glyph_area += static_cast<unsigned long long>(rect.width) * rect.height;
+		}
+
+		for (const auto& packer : packers)
+		{
+			packer_result result{ .set = set.name, .packer = packer.name };
+			packed_rects packing{};
+			const auto start{ clock::now() };
+			for (unsigned int n = 0; n < std::max(iterations, 1u); n++)
+			{
+				packing = {};
+				result.packed = packer.pack(set.rects, max_page_size, spacing, packing);
+			}
+			const std::chrono::duration<double, std::milli> elapsed{ clock::now() - start };
+			result.milliseconds = elapsed.count() / std::max(iterations, 1u);
+
+			unsigned long long page_area{};
+			for (const auto& page : packing.page_sizes)
+			{
+				page_area += static_cast<unsigned long long>(page.width) * page.height;
+				if (static_cast<unsigned long long>(page.width) * page.height >= static_cast<unsigned long long>(result.width) * result.height)
+				{
+					result.width = page.width;
+					result.height = page.height;
+				}
+			}
+			result.page_count = packing.page_sizes.size();
+			result.occupancy = page_area ? static_cast<double>(glyph_area) / static_cast<double>(page_area) : 0.0;
+			result.within_page_limit = std::ranges::all_of(packing.page_sizes, [&](const packed_page& page) { return page.width <= max_page_size && page.height <= max_page_size; });
+			result.valid = result.packed && validate_packing(packing);
+
+			std::ostringstream size{};
+			size << result.width << "x" << result.height;
+			out << std::left << std::fixed << std::setprecision(3)
+				<< std::setw(32) << result.set
+				<< std::setw(18) << result.packer
+				<< std::setw(12) << result.milliseconds
+				<< std::setprecision(1) << std::setw(12) << result.occupancy * 100.0
+				<< std::setw(14) << size.str()
+				<< std::setw(8) << result.page_count
+				<< (!result.packed ? "failed" : !result.valid ? "invalid" : !result.within_page_limit ? "over page limit" : "ok") << "\n";
+			results.push_back(std::move(result));
+		}
+	}
+	return results;
+}
+#pragma endregion
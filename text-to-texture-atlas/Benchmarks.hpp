@@ -0,0 +1,182 @@
+#pragma once
+#include <functional>
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Font.hpp"
+#include "Packers.hpp"
+
+namespace text_to_texture_atlas::benchmarks
+{
+	/**
+	 * @brief
+	 * Compares the built-in `Rasterizer` against FreeType's `FT_Render_Glyph`.
+	 *
+	 * @details
+	 * For every requested pixel height the printable ASCII range (32-126) is loaded and
+	 * rendered `iterations` times with each backend. Both timings include `FT_Load_Glyph`,
+	 * which costs the same for either backend, so the difference is the rasterization cost.
+	 * The report also lists how many bitmaps differ in size and the mean absolute coverage
+	 * difference between the two backends, so speed is never compared without quality.
+	 *
+	 * @param font_path The full path to the font file (e.g., "C:/Windows/Fonts/arial.ttf").
+	 * @param pixel_heights The pixel heights to benchmark, passed to `FT_Set_Pixel_Sizes`.
+	 * @param iterations How many times each backend renders the full character range per size.
+	 * @param out The stream the report is written to.
+	 *
+	 * @return true if the benchmark ran, false if FreeType could not load the font.
+	 *
+	 * @code
+	 * text_to_texture_atlas::benchmarks::run_rasterizer_benchmark("C:/Windows/Fonts/arial.ttf", { 32, 128, 600 }, 10);
+	 * @endcode
+	 */
+	bool run_rasterizer_benchmark(
+		const std::string& font_path,
+		const std::vector<unsigned int>& pixel_heights,
+		unsigned int iterations = 10,
+		std::ostream& out = std::cout
+	);
+
+	/**
+	 * @brief
+	 * The glyph bitmap sizes of one font, size and charset: the input every packer is compared on.
+	 */
+	struct glyph_rect_set
+	{
+		std::string name{};					///< A label for reports, e.g. "DejaVuSans latin-1 32px".
+		std::vector<atlas_rect> rects{};	///< One rect per glyph with a bitmap, in codepoint order. Only the sizes are set.
+	};
+
+	/**
+	 * @brief
+	 * Records the bitmap size of every glyph of a charset, as `Font` would place them.
+	 *
+	 * @details Codepoints the font has no glyph for and glyphs without a bitmap (such as spaces) are
+	 * skipped, so the set can be empty, e.g. for a CJK charset of a Latin font.
+	 *
+	 * @return true if the font could be loaded at that size, false otherwise.
+	 */
+	bool record_glyph_rects(
+		const std::string& font_path,
+		unsigned int pixel_height,
+		const std::vector<codepoint_range>& charset,
+		glyph_rect_set& set
+	);
+
+	/**
+	 * @brief
+	 * Writes rect sets as text, so they can be recorded once and compared anywhere: a `set <name>`
+	 * line per set, followed by a `<width> <height>` line per rect.
+	 */
+	void write_rect_sets(std::span<const glyph_rect_set> sets, std::ostream& out);
+
+	/**
+	 * @brief
+	 * Reads rect sets written by `write_rect_sets`, appending them to `sets`.
+	 *
+	 * @return true if the whole stream was read, false on a malformed line.
+	 */
+	bool read_rect_sets(std::istream& in, std::vector<glyph_rect_set>& sets);
+
+	/**
+	 * @brief
+	 * The size of one page a packer filled.
+	 */
+	struct packed_page
+	{
+		unsigned int width{};	///< Page width in pixels.
+		unsigned int height{};	///< Page height in pixels.
+	};
+
+	/**
+	 * @brief
+	 * Where a packer put every rect.
+	 */
+	struct packed_rects
+	{
+		std::vector<atlas_rect> rects{};	///< The input rects with `x` and `y` set, in input order.
+		std::vector<unsigned int> pages{};	///< The page of every rect, in input order.
+		std::vector<packed_page> page_sizes{};	///< The size of every page used.
+	};
+
+	/**
+	 * @brief
+	 * A packing heuristic under test: places `sizes` on pages of at most `max_page_size` pixels per
+	 * side where it can (single-page packers may exceed it; the report flags that), leaving `spacing`
+	 * pixels between and around rects. Returns false if it could not place every rect.
+	 */
+	using packer_function = std::function<bool(std::span<const atlas_rect> sizes, unsigned int max_page_size, unsigned int spacing, packed_rects& result)>;
+
+	/**
+	 * @brief
+	 * A named packer for `run_packer_benchmark`.
+	 */
+	struct packer_heuristic
+	{
+		std::string name{};		///< The name shown in the report.
+		packer_function pack{};	///< The packer.
+	};
+
+	/**
+	 * @brief
+	 * Returns the packers compared by default: the grid and shelf packers `Font` uses (the shelf
+	 * also with the rects sorted by height, as `placement_order::size` does), a multi-page
+	 * skyline bottom-left packer as a candidate alternative, and `online_packer` fed one rect at
+	 * a time, as a runtime atlas would be.
+	 *
+	 * @details Append to the returned list to compare a new heuristic against them.
+	 */
+	std::vector<packer_heuristic> get_packer_heuristics();
+
+	/**
+	 * @brief
+	 * The outcome of one packer on one rect set.
+	 */
+	struct packer_result
+	{
+		std::string set{};				///< The rect set's name.
+		std::string packer{};			///< The packer's name.
+		bool packed{};					///< Whether the packer placed every rect.
+		bool valid{};					///< Whether every rect lies inside its page without overlapping another.
+		bool within_page_limit{};		///< Whether every page is at most `max_page_size` per side.
+		double milliseconds{};			///< The mean time of one pack.
+		double occupancy{};				///< The glyph area divided by the total page area, from 0 to 1.
+		unsigned int width{};			///< The width of the largest page.
+		unsigned int height{};			///< The height of the largest page.
+		std::size_t page_count{};		///< The number of pages used.
+	};
+
+	/**
+	 * @brief
+	 * Runs every packer on every rect set and reports pack time, occupancy, page size and page count.
+	 *
+	 * @details Every packer receives the same rects in the same (codepoint) order, and its output
+	 * is checked for rects outside their page or overlapping each other, so a fast packer that
+	 * cheats shows up as invalid. Empty sets are skipped.
+	 *
+	 * @param sets The rect sets, e.g. from `record_glyph_rects` or `read_rect_sets`.
+	 * @param packers The packers to compare, e.g. from `get_packer_heuristics`.
+	 * @param max_page_size The largest page side, e.g. the GPU's maximum texture size.
+	 * @param iterations How many times each packer packs each set; the mean time is reported.
+	 * @param out The stream the report is written to.
+	 *
+	 * @return One result per packer and non-empty set, in report order.
+	 *
+	 * @code
+	 * std::vector<text_to_texture_atlas::benchmarks::glyph_rect_set> sets(1);
+	 * text_to_texture_atlas::benchmarks::record_glyph_rects("C:/Windows/Fonts/arial.ttf", 32, { { 32, 255 } }, sets[0]);
+	 * auto packers = text_to_texture_atlas::benchmarks::get_packer_heuristics();
+	 * packers.push_back({ "my-packer", my_packer });
+	 * text_to_texture_atlas::benchmarks::run_packer_benchmark(sets, packers);
+	 * @endcode
+	 */
+	std::vector<packer_result> run_packer_benchmark(
+		std::span<const glyph_rect_set> sets,
+		std::span<const packer_heuristic> packers,
+		unsigned int max_page_size = 4096,
+		unsigned int iterations = 10,
+		std::ostream& out = std::cout
+	);
+}
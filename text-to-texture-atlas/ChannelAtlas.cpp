@@ -0,0 +1,104 @@
+#include "ChannelAtlas.hpp"
+
+#include <algorithm>
+#include <ranges>
+
+#include "Font.hpp"
+
+#pragma region pack
+bool text_to_texture_atlas::channel_atlas::pack
+(
+	const std::span<const Font* const> layers
+)
+{
+	constexpr unsigned int channels{ 4 };
+	if (layers.empty() || layers.size() > channels)
+	{
+		return false;
+	}
+
+	unsigned int width{};
+	unsigned int height{};
+	for (const Font* font : layers)
+	{
+		if (!font || !*font || !font->get_main_atlas().has_pixels())
+		{
+			return false;
+		}
+		width = std::max(width, font->get_main_atlas().width);
+		height = std::max(height, font->get_main_atlas().height);
+	}
+
+	std::vector<unsigned char> pixels(static_cast<std::size_t>(width) * height * channels);
+	std::array<std::vector<channel_glyph>, channels> glyph_layers{};
+	for (unsigned int channel = 0; channel < layers.size(); channel++)
+	{
+		const Font& font{ *layers[channel] };
+		const auto& source{ font.get_main_atlas() };
+
+		// Only the coverage channel is copied: alpha of RGBA8, or the single channel of R8.
+		const unsigned char* source_pixels{ source.get_pixels() + (source.channels - 1) };
+		for (unsigned int y = 0; y < source.height; y++)
+		{
+			const unsigned char* source_row{ source_pixels + y * source.row_pitch };
+			unsigned char* destination_row{ pixels.data() + (static_cast<std::size_t>(y) * width) * channels + channel };
+			for (unsigned int x = 0; x < source.width; x++)
+			{
+				destination_row[static_cast<std::size_t>(x) * channels] = source_row[static_cast<std::size_t>(x) * source.channels];
+			}
+		}
+
+		auto& glyphs{ glyph_layers[channel] };
+		glyphs.reserve(font.get_characters().size());
+		for (const auto& [codepoint, value] : font.get_characters())
+		{
+			glyphs.push_back({
+				.codepoint = codepoint,
+				.channel = channel,
+				.x = value.top_left.x,
+				.y = value.top_left.y,
+				.width = value.width_,
+				.height = value.height_,
+				.bearing_x = value.x_bearing_,
+				.bearing_y = value.y_bearing_,
+				.advance_x = value.advance_x_,
+				.advance_y = value.advance_y_,
+				.u0 = static_cast<float>(value.top_left.x) / static_cast<float>(width),
+				.v0 = static_cast<float>(value.top_left.y) / static_cast<float>(height),
+				.u1 = static_cast<float>(value.top_left.x + value.width_) / static_cast<float>(width),
+				.v1 = static_cast<float>(value.top_left.y + value.height_) / static_cast<float>(height) });
+		}
+		std::ranges::sort(glyphs, {}, &channel_glyph::codepoint);
+	}
+
+	pixels_ = std::move(pixels);
+	layers_ = std::move(glyph_layers);
+	width_ = width;
+	height_ = height;
+	layer_count_ = static_cast<unsigned int>(layers.size());
+	return true;
+}
+#pragma endregion
+
+#pragma region find
+const text_to_texture_atlas::channel_glyph* text_to_texture_atlas::channel_atlas::find
+(
+	const unsigned int channel,
+	const char32_t codepoint
+) const
+{
+	const auto glyphs{ get_glyphs(channel) };
+	const auto found{ std::ranges::lower_bound(glyphs, codepoint, {}, &channel_glyph::codepoint) };
+	return found != glyphs.end() && found->codepoint == codepoint ? &*found : nullptr;
+}
+#pragma endregion
+
+#pragma region get_glyphs
+std::span<const text_to_texture_atlas::channel_glyph> text_to_texture_atlas::channel_atlas::get_glyphs
+(
+	const unsigned int channel
+) const
+{
+	return channel < layer_count_ ? std::span<const channel_glyph>{ layers_[channel] } : std::span<const channel_glyph>{};
+}
+#pragma endregion
@@ -0,0 +1,105 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace text_to_texture_atlas
+{
+	class Font;
+
+	/**
+	 * @brief
+	 * One glyph of a `channel_atlas`: where it is, which channel holds it, and its metrics.
+	 */
+	struct channel_glyph
+	{
+		char32_t codepoint{};		///< The character's codepoint; each layer's glyphs are sorted by it.
+		unsigned int channel{};		///< The channel holding the glyph's coverage: 0 = R, 1 = G, 2 = B, 3 = A.
+		unsigned int x{};			///< Left edge of the glyph in the atlas, in pixels.
+		unsigned int y{};			///< Top edge of the glyph in the atlas, in pixels.
+		unsigned int width{};		///< Width of the glyph in pixels.
+		unsigned int height{};		///< Height of the glyph in pixels.
+		int bearing_x{};			///< Horizontal distance from the pen position to the left edge.
+		int bearing_y{};			///< Vertical distance from the baseline to the top edge.
+		int advance_x{};			///< Horizontal pen advance (in 1/64 pixels).
+		int advance_y{};			///< Vertical pen advance (in 1/64 pixels).
+		float u0{};					///< Left texture coordinate.
+		float v0{};					///< Top texture coordinate.
+		float u1{};					///< Right texture coordinate.
+		float v1{};					///< Bottom texture coordinate.
+	};
+
+	/**
+	 * @brief
+	 * **Packs up to four single-coverage atlases into the R, G, B and A channels of one RGBA texture.**
+	 *
+	 * @details
+	 * A glyph only needs one coverage value per texel, so an RGBA atlas of a single font leaves
+	 * three channels empty. This stores one layer per channel instead: each layer is an
+	 * independently built `Font` (a different face, size or charset), and its atlas becomes one
+	 * channel of a shared texture as large as the largest layer. Four layers cost the memory of
+	 * one RGBA atlas rather than four.
+	 *
+	 * Every glyph record carries its channel, so a shader selects the coverage with a dot product
+	 * or a per-vertex channel mask:
+	 *
+	 * @code
+	 * float coverage = dot(texture(atlas, uv), channel_mask);	// channel_mask = (1,0,0,0) for channel 0.
+	 * @endcode
+	 *
+	 * *Usage Example:*
+	 *
+	 * @code
+	 * text_to_texture_atlas::build_options options{};
+	 * options.format = text_to_texture_atlas::atlas_format::r8;
+	 * auto body = text_to_texture_atlas::Font::Font_Px("Inter-Regular.ttf", 16, 0, options);
+	 * auto heading = text_to_texture_atlas::Font::Font_Px("Inter-Bold.ttf", 32, 0, options);
+	 *
+	 * text_to_texture_atlas::channel_atlas atlas{};
+	 * const text_to_texture_atlas::Font* layers[]{ &body, &heading };
+	 * if (atlas.pack(layers)) {
+	 *     upload_rgba_texture(atlas.get_pixels().data(), atlas.get_width(), atlas.get_height());
+	 *     const auto* glyph = atlas.find(1, U'A');	// 'A' of the heading font, in the green channel.
+	 * }
+	 * @endcode
+	 *
+	 * @note Each layer contributes its coverage channel (alpha for RGBA8 fonts); other channels,
+	 * such as a packed outline effect, are not copied. The fonts can be destroyed after `pack`.
+	 */
+	class channel_atlas
+	{
+		std::vector<unsigned char> pixels_{};					// The RGBA texture, tightly pitched.
+		unsigned int width_{};									// Texture width in pixels.
+		unsigned int height_{};									// Texture height in pixels.
+		std::array<std::vector<channel_glyph>, 4> layers_{};	// Each channel's glyphs, sorted by codepoint.
+		unsigned int layer_count_{};							// The number of layers packed.
+
+	public:
+		/**
+		 * @brief Packs each font's atlas into one channel, in order: the first into R, the second into G...
+		 *
+		 * @param layers One to four built fonts whose atlas pixels have not been freed.
+		 *
+		 * @return true if the atlas was packed, false if there are no layers or more than four, or a
+		 * font failed or has no pixels (the previous atlas is kept).
+		 */
+		bool pack(std::span<const Font* const> layers);
+
+		/**
+		 * @brief Looks up a glyph of one layer by codepoint with a binary search.
+		 *
+		 * @return The glyph, or null if the layer does not exist or has no such codepoint.
+		 */
+		const channel_glyph* find(unsigned int channel, char32_t codepoint) const;
+
+		/// Returns a layer's glyphs, sorted by codepoint (empty if the layer does not exist).
+		std::span<const channel_glyph> get_glyphs(unsigned int channel) const;
+
+		inline const std::vector<unsigned char>& get_pixels() const { return pixels_; }	// returns the RGBA texture, `width * 4` bytes per row.
+		inline unsigned int get_width() const { return width_; }						// returns the texture width in pixels.
+		inline unsigned int get_height() const { return height_; }						// returns the texture height in pixels.
+		inline unsigned int get_layer_count() const { return layer_count_; }			// returns the number of channels in use.
+	};
+}
@@ -0,0 +1,194 @@
+#include "Compactor.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#pragma region plan
+bool text_to_texture_atlas::atlas_compactor::plan(const unsigned int spacing)
+{
+	std::ranges::sort(remap_, [](const rect_remap& a, const rect_remap& b)
+	{
+		if (a.from.height != b.from.height) { return a.from.height > b.from.height; }
+		if (a.from.width != b.from.width) { return a.from.width > b.from.width; }
+		return a.id < b.id;
+	});
+
+	unsigned int x_position{ spacing };
+	unsigned int y_position{ spacing };
+	unsigned int shelf_height{};
+
+	for (auto& move : remap_)
+	{
+		const auto& from{ move.from };
+		if (from.x + from.width > width_ || from.y + from.height > height_ || from.width + spacing * 2 > width_)
+		{
+			return false;
+		}
+
+		if (x_position + from.width + spacing > width_)
+		{
+			x_position = spacing;
+			y_position += shelf_height + spacing;
+			shelf_height = 0;
+		}
+		if (y_position + from.height + spacing > height_)
+		{
+			return false;
+		}
+
+		move.to = { .x = x_position, .y = y_position, .width = from.width, .height = from.height };
+		x_position += from.width + spacing;
+		shelf_height = std::max(shelf_height, from.height);
+	}
+
+	used_height_ = remap_.empty() ? 0 : y_position + shelf_height + spacing;
+	return true;
+}
+#pragma endregion
+
+#pragma region begin
+bool text_to_texture_atlas::atlas_compactor::begin
+(
+	const std::vector<std::pair<std::uint64_t, atlas_rect>>& live,
+	const unsigned int width,
+	const unsigned int height,
+	const unsigned int channels,
+	const unsigned char* source,
+	const std::size_t source_pitch,
+	unsigned char* destination,
+	const std::size_t destination_pitch,
+	const unsigned int spacing,
+	const bool clear_destination
+)
+{
+	remap_.clear();
+	remap_.reserve(live.size());
+	for (const auto& [id, rect] : live)
+	{
+		remap_.push_back({ .id = id, .from = rect, .to = {} });
+	}
+
+	source_ = source;
+	destination_ = destination;
+	source_pitch_ = source_pitch;
+	destination_pitch_ = destination_pitch;
+	width_ = width;
+	height_ = height;
+	channels_ = channels;
+	clear_destination_ = clear_destination;
+	cleared_rows_ = 0;
+	copied_ = 0;
+	used_height_ = 0;
+	done_bytes_ = 0;
+
+	const std::size_t row_bytes{ static_cast<std::size_t>(width) * channels };
+	if (!source || !destination || source == destination || source_pitch < row_bytes || destination_pitch < row_bytes || !plan(spacing))
+	{
+		remap_.clear();
+		total_bytes_ = 0;
+		return false;
+	}
+
+	total_bytes_ = clear_destination ? static_cast<std::uint64_t>(row_bytes) * height : 0;
+	for (const auto& move : remap_)
+	{
+		total_bytes_ += static_cast<std::uint64_t>(move.from.width) * move.from.height * channels;
+	}
+	return true;
+}
+#pragma endregion
+
+#pragma region step
+bool text_to_texture_atlas::atlas_compactor::step
+(
+	const std::chrono::microseconds budget,
+	std::vector<atlas_rect>& dirty
+)
+{
+	constexpr unsigned int clear_rows_per_check{ 16 };
+	const auto deadline{ std::chrono::steady_clock::now() + budget };
+	const std::size_t row_bytes{ static_cast<std::size_t>(width_) * channels_ };
+	bool processed{};
+
+	const auto out_of_time = [&]
+	{
+		return processed && std::chrono::steady_clock::now() >= deadline;
+	};
+
+	if (clear_destination_ && cleared_rows_ < height_)
+	{
+		const unsigned int first_row{ cleared_rows_ };
+		while (cleared_rows_ < height_ && !out_of_time())
+		{
+			const unsigned int rows{ std::min(clear_rows_per_check, height_ - cleared_rows_) };
+			for (unsigned int y = cleared_rows_; y < cleared_rows_ + rows; y++)
+			{
+				std::memset(destination_ + y * destination_pitch_, 0, row_bytes);
+			}
+			cleared_rows_ += rows;
+			done_bytes_ += static_cast<std::uint64_t>(rows) * row_bytes;
+			processed = true;
+		}
+		dirty.push_back({ .x = 0, .y = first_row, .width = width_, .height = cleared_rows_ - first_row });
+
+		// Rects are only copied onto fully cleared rows, so a later clear never erases them.
+		if (cleared_rows_ < height_)
+		{
+			return false;
+		}
+	}
+
+	const std::size_t first_dirty{ dirty.size() };
+	while (copied_ < remap_.size() && !out_of_time())
+	{
+		const auto& move{ remap_[copied_++] };
+		const std::size_t rect_bytes{ static_cast<std::size_t>(move.from.width) * channels_ };
+		for (unsigned int row = 0; row < move.from.height; row++)
+		{
+			std::memcpy(
+				destination_ + (move.to.y + row) * destination_pitch_ + static_cast<std::size_t>(move.to.x) * channels_,
+				source_ + (move.from.y + row) * source_pitch_ + static_cast<std::size_t>(move.from.x) * channels_,
+				rect_bytes);
+		}
+		done_bytes_ += static_cast<std::uint64_t>(rect_bytes) * move.from.height;
+		processed = true;
+
+		// Moves are in shelf order, so a rect on the same shelf as the last dirty region extends it.
+		if (dirty.size() > first_dirty && dirty.back().y == move.to.y)
+		{
+			auto& region{ dirty.back() };
+			region.width = move.to.x + move.to.width - region.x;
+			region.height = std::max(region.height, move.to.height);
+		}
+		else
+		{
+			dirty.push_back(move.to);
+		}
+	}
+
+	return is_finished();
+}
+#pragma endregion
+
+#pragma region finish
+void text_to_texture_atlas::atlas_compactor::finish(std::vector<atlas_rect>& dirty)
+{
+	while (!step(std::chrono::hours{ 1 }, dirty))
+	{
+	}
+}
+#pragma endregion
+
+#pragma region is_finished
+bool text_to_texture_atlas::atlas_compactor::is_finished() const
+{
+	return (!clear_destination_ || cleared_rows_ == height_) && copied_ == remap_.size();
+}
+#pragma endregion
+
+#pragma region get_progress
+float text_to_texture_atlas::atlas_compactor::get_progress() const
+{
+	return total_bytes_ ? static_cast<float>(static_cast<double>(done_bytes_) / static_cast<double>(total_bytes_)) : 1.0f;
+}
+#pragma endregion
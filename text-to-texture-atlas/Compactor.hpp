@@ -0,0 +1,146 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Packers.hpp"
+
+namespace text_to_texture_atlas
+{
+	/**
+	 * @brief
+	 * Where a live rect was and where compaction puts it.
+	 */
+	struct rect_remap
+	{
+		std::uint64_t id{};		///< The caller's id for the rect (a codepoint, glyph key hash, sprite id...).
+		atlas_rect from{};		///< The rect in the fragmented atlas.
+		atlas_rect to{};		///< The rect in the compacted atlas.
+	};
+
+	/**
+	 * @brief
+	 * **Repacks the live rects of a fragmented atlas into a compact layout, a few at a time.**
+	 *
+	 * @details
+	 * A long-lived atlas that evicts and inserts glyphs ends up with holes scattered between the
+	 * survivors, until a new glyph no longer fits even though the free area would hold it many
+	 * times over. Compaction moves every live rect onto tight shelves at the top of the atlas,
+	 * leaving all free space as one block below them.
+	 *
+	 * Compaction is double buffered: rects are copied from the current (source) pixels into a
+	 * second (destination) buffer of the same size, so the source stays valid for rendering until
+	 * the caller switches to the destination. The work is split in two:
+	 *
+	 * - `begin` plans the whole layout immediately and returns false if the live rects cannot fit.
+	 *   The remap is available from then on, so glyph tables can be prepared ahead of the swap.
+	 * - `step` clears and copies for at most the given time budget, then reports which regions of
+	 *   the destination it wrote, ready for `glTexSubImage2D` or a staging upload. Call it once per
+	 *   frame until it returns true, then swap buffers and apply the remap.
+	 *
+	 * Rects are placed tallest first, then widest first, then by ascending id, so the same live set
+	 * always compacts to the same layout.
+	 *
+	 * *Usage Example:*
+	 *
+	 * @code
+	 * text_to_texture_atlas::atlas_compactor compactor{};
+	 * std::vector<std::pair<std::uint64_t, text_to_texture_atlas::atlas_rect>> live = collect_live_glyphs();
+	 *
+	 * if (compactor.begin(live, width, height, 1, front.data(), width, back.data(), width)) {
+	 *     // Every frame:
+	 *     std::vector<text_to_texture_atlas::atlas_rect> dirty{};
+	 *     bool done = compactor.step(std::chrono::microseconds{ 500 }, dirty);
+	 *     upload(back, dirty);
+	 *     if (done) {
+	 *         std::swap(front, back);
+	 *         for (const auto& move : compactor.get_remap()) { update_glyph(move.id, move.to); }
+	 *     }
+	 * }
+	 * @endcode
+	 *
+	 * @warning The source and destination buffers must stay alive and unchanged until `step`
+	 * returns true. This class is not thread-safe.
+	 */
+	class atlas_compactor
+	{
+		std::vector<rect_remap> remap_{};		// The planned moves, in copy order.
+		const unsigned char* source_{};			// The fragmented atlas pixels.
+		unsigned char* destination_{};			// The compacted atlas pixels.
+		std::size_t source_pitch_{};			// Bytes per row of `source_`.
+		std::size_t destination_pitch_{};		// Bytes per row of `destination_`.
+		unsigned int width_{};					// Atlas width in pixels.
+		unsigned int height_{};					// Atlas height in pixels.
+		unsigned int channels_{};				// Bytes per pixel.
+		unsigned int used_height_{};			// Rows used by the compacted layout, including the bottom spacing.
+		unsigned int cleared_rows_{};			// Destination rows cleared so far.
+		std::size_t copied_{};					// Entries of `remap_` copied so far.
+		bool clear_destination_{};				// Whether the destination is cleared before copying.
+		std::uint64_t total_bytes_{};			// Bytes to clear and copy in total.
+		std::uint64_t done_bytes_{};			// Bytes cleared and copied so far.
+
+		bool plan(unsigned int spacing);		// Fills `remap_` with the compacted layout, returns false if it does not fit.
+
+	public:
+		/**
+		 * @brief Plans the compaction and prepares to copy.
+		 *
+		 * @param live The live rects and their ids. Ids should be unique.
+		 * @param width The atlas width in pixels, shared by source and destination.
+		 * @param height The atlas height in pixels, shared by source and destination.
+		 * @param channels Bytes per pixel (1 for R8, 4 for RGBA8).
+		 * @param source The fragmented atlas pixels.
+		 * @param source_pitch Bytes per source row (at least `width * channels`).
+		 * @param destination The buffer the compacted atlas is written to.
+		 * @param destination_pitch Bytes per destination row (at least `width * channels`).
+		 * @param spacing Gap left between rects and around the edges, as the atlas packers do.
+		 * @param clear_destination Zero the destination first. Skip it when the destination is
+		 * freshly zeroed memory; otherwise stale pixels would show up between glyphs.
+		 *
+		 * @return true if the compacted layout fits, false otherwise (nothing is copied).
+		 */
+		bool begin(
+			const std::vector<std::pair<std::uint64_t, atlas_rect>>& live,
+			unsigned int width,
+			unsigned int height,
+			unsigned int channels,
+			const unsigned char* source,
+			std::size_t source_pitch,
+			unsigned char* destination,
+			std::size_t destination_pitch,
+			unsigned int spacing = 5,
+			bool clear_destination = true
+		);
+
+		/**
+		 * @brief Clears and copies until the budget is spent. At least one row or rect is processed
+		 * per call, so compaction always makes progress.
+		 *
+		 * @param budget The time this call may spend.
+		 * @param dirty Receives the destination regions written by this call. Consecutive rects on
+		 * the same shelf are merged, so the list stays short.
+		 *
+		 * @return true once the destination holds the complete compacted atlas.
+		 */
+		bool step(std::chrono::microseconds budget, std::vector<atlas_rect>& dirty);
+
+		/**
+		 * @brief Runs `step` until it is finished.
+		 */
+		void finish(std::vector<atlas_rect>& dirty);
+
+		/// Returns true once every rect has been copied.
+		bool is_finished() const;
+
+		/// Returns the planned moves, valid from a successful `begin`.
+		inline const std::vector<rect_remap>& get_remap() const { return remap_; }
+
+		/// Returns the rows used by the compacted layout; everything below is one free block.
+		inline unsigned int get_used_height() const { return used_height_; }
+
+		/// Returns the fraction of the bytes cleared and copied so far, from 0 to 1.
+		float get_progress() const;
+	};
+}
@@ -1,29 +1,137 @@
 #include "Font.hpp"
 
 #include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <numeric>
 #include <ranges>
+#include <sstream>
+#include <thread>
 #include <utility>
 
+#include <freetype/ftglyph.h>
+#include <freetype/ftmm.h>
+#include <freetype/ftoutln.h>
+
+#include "Hash.hpp"
 #include "texture-operations/texture_operations.h"
 
-#include "spdlog/spdlog.h"
-#include <spdlog/sinks/stdout_color_sinks.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXT_TO_TEXTURE_ATLAS_SSE2
+#include <emmintrin.h>
+#endif
 
 //#define DEBUGGING
 
+namespace
+{
+	// Unicode whitespace. Whitespace characters keep their metrics but are never placed in the atlas.
+	bool is_space_codepoint(const char32_t codepoint)
+	{
+		return codepoint == U' ' || (codepoint >= 0x09 && codepoint <= 0x0D) || codepoint == 0x85 || codepoint == 0xA0
+			|| codepoint == 0x1680 || (codepoint >= 0x2000 && codepoint <= 0x200A) || codepoint == 0x2028
+			|| codepoint == 0x2029 || codepoint == 0x202F || codepoint == 0x205F || codepoint == 0x3000;
+	}
+
+	// Offsets a bitmap placed at `bitmap_left`/`bitmap_top` from the vertical pen position instead
+	// of the horizontal one. FreeType fills the vertical metrics on every load, synthesizing them
+	// when the font has none, so one load serves both directions.
+	void get_vertical_bearings(const FT_Glyph_Metrics& metrics, const int bitmap_left, const int bitmap_top, int& vertical_left, int& vertical_top)
+	{
+		vertical_left = bitmap_left + static_cast<int>((metrics.vertBearingX - metrics.horiBearingX + 32) >> 6);
+		vertical_top = static_cast<int>((metrics.vertBearingY + metrics.horiBearingY + 32) >> 6) - bitmap_top;
+	}
+
+	struct stroker_deleter { void operator()(FT_Stroker stroker) const { FT_Stroker_Done(stroker); } };
+	struct glyph_deleter { void operator()(FT_Glyph glyph) const { FT_Done_Glyph(glyph); } };
+
+	// Copies a rendered bitmap into a cached glyph. FreeType pads rows to `pitch`; the cache stores them tightly packed.
+	void copy_coverage(const FT_Bitmap& bitmap, text_to_texture_atlas::cached_glyph& glyph)
+	{
+		glyph.width = bitmap.width;
+		glyph.height = bitmap.rows;
+		glyph.coverage.clear();
+		if (bitmap.buffer)
+		{
+			glyph.coverage.resize(static_cast<size_t>(glyph.width) * glyph.height);
+			for (unsigned int y = 0; y < glyph.height; y++)
+			{
+				std::copy_n(bitmap.buffer + static_cast<ptrdiff_t>(y) * bitmap.pitch, glyph.width, glyph.coverage.data() + static_cast<size_t>(y) * glyph.width);
+			}
+		}
+	}
+
+	// Decodes the multi-byte UTF-8 sequence at `bytes` (whose first byte is not ASCII). A malformed
+	// sequence yields U+FFFD and consumes its maximal invalid subpart, so a bad byte never swallows
+	// the valid text after it. The lead byte fixes the range of the first continuation byte, which
+	// rules out overlong forms, surrogates and codepoints above U+10FFFF (Unicode Table 3-7).
+	char32_t decode_utf8_sequence(const unsigned char* bytes, const size_t available, size_t& length)
+	{
+		constexpr char32_t replacement{ 0xFFFD };
+		const unsigned char lead{ bytes[0] };
+		unsigned int continuations{};
+		unsigned char low{ 0x80 };
+		unsigned char high{ 0xBF };
+		char32_t codepoint{};
+		if (lead >= 0xC2 && lead <= 0xDF)
+		{
+			continuations = 1;
+			codepoint = lead & 0x1F;
+		}
+		else if (lead >= 0xE0 && lead <= 0xEF)
+		{
+			continuations = 2;
+			codepoint = lead & 0x0F;
+			low = lead == 0xE0 ? 0xA0 : low;
+			high = lead == 0xED ? 0x9F : high;
+		}
+		else if (lead >= 0xF0 && lead <= 0xF4)
+		{
+			continuations = 3;
+			codepoint = lead & 0x07;
+			low = lead == 0xF0 ? 0x90 : low;
+			high = lead == 0xF4 ? 0x8F : high;
+		}
+
+		length = 1;
+		if (!continuations)
+		{
+			return replacement;
+		}
+		for (unsigned int i = 0; i < continuations; i++, length++)
+		{
+			if (length >= available || bytes[length] < low || bytes[length] > high)
+			{
+				return replacement;
+			}
+			codepoint = (codepoint << 6) | (bytes[length] & 0x3F);
+			low = 0x80;
+			high = 0xBF;
+		}
+		return codepoint;
+	}
+}
+
 #pragma region character::output_raw
-void text_to_texture_atlas::Font::character::output_raw() const
+void text_to_texture_atlas::Font::character::output_raw(const atlas& source) const
 {
+	const auto channels{ source.channels };
+	const unsigned char* pixels{ source.get_pixels() };
+	if (!source.has_pixels() || top_left.y + height_ > source.height || top_left.x + width_ > source.width) { return; }
 	for (unsigned int y = 0; y < height_; y++)
 	{
 		for (unsigned int x = 0; x < width_; x++)
 		{
-			const auto flat{ (y * width_ + x) * 4 };
-			const auto r = raw_bitmap_buffer[flat + 0];
-			const auto g = raw_bitmap_buffer[flat + 1];
-			const auto b = raw_bitmap_buffer[flat + 2];
-			const auto a = raw_bitmap_buffer[flat + 3];
+			const auto flat{ (top_left.y + y) * source.row_pitch + static_cast<std::size_t>(top_left.x + x) * channels };
+			const auto r = channels == 4 ? pixels[flat + 0] : 0;
+			const auto g = channels == 4 ? pixels[flat + 1] : 0;
+			const auto b = channels == 4 ? pixels[flat + 2] : 0;
+			const auto a = pixels[flat + channels - 1];
 
 			if (r == 255) { std::cout << "r"; }
 			//else { std::cout << " "; }
@@ -51,11 +159,13 @@ void text_to_texture_atlas::Font::character::output_raw() const
 #pragma region init_library_
 bool text_to_texture_atlas::Font::init_library()
 {
-	ft_error_ = FT_Init_FreeType(&library_);
+	FT_Library library{};
+	ft_error_ = FT_Init_FreeType(&library);
 	if (ft_error_)
 	{
 		return false;
 	}
+	library_.reset(library);
 	return true;
 }
 #pragma endregion
@@ -63,24 +173,96 @@ bool text_to_texture_atlas::Font::init_library()
 #pragma region init_face_
 bool text_to_texture_atlas::Font::init_face()
 {
-	std::string font = windows_fonts_paths_ + selected_font_;
-	ft_error_ = FT_New_Face(library_, font.c_str(), 0, &face_);
+	const std::string font = std::filesystem::path(selected_font_).is_absolute() ? selected_font_ : fonts_path_ + selected_font_;
+	FT_Face face{};
+	ft_error_ = FT_New_Face(library_.get(), font.c_str(), 0, &face);
 	if (ft_error_)
 	{
 		return false;
 	}
+	face_.reset(face);
+
+	// Cached glyphs are keyed by the file contents rather than its path, so an edited font never hits stale glyphs.
+	if ((options_.cache || options_.pack) && !hash_file(font, face_key_))
+	{
+		return false;
+	}
 	return true;
 }
 #pragma endregion
 
+#pragma region init_variation
+bool text_to_texture_atlas::Font::init_variation()
+{
+	if (options_.variation.empty())
+	{
+		return true;
+	}
+
+	FT_MM_Var* master{};
+	ft_error_ = FT_Get_MM_Var(face_.get(), &master);
+	if (ft_error_)
+	{
+		return false;
+	}
+
+	// Axes that are not listed keep their default, so the coordinates always describe every axis.
+	const std::span<const FT_Var_Axis> axes{ master->axis, master->num_axis };
+	design_coordinates_.resize(axes.size());
+	std::ranges::transform(axes, design_coordinates_.begin(), &FT_Var_Axis::def);
+
+	bool known_axes{ true };
+	for (const auto& coordinate : options_.variation)
+	{
+		const auto axis{ std::ranges::find(axes, static_cast<FT_ULong>(coordinate.tag), &FT_Var_Axis::tag) };
+		if (axis == axes.end())
+		{
+			known_axes = false;
+			break;
+		}
+		const FT_Fixed value{ static_cast<FT_Fixed>(std::lround(static_cast<double>(coordinate.value) * 65536.0)) };
+		design_coordinates_[axis - axes.begin()] = std::clamp(value, axis->minimum, axis->maximum);
+	}
+	FT_Done_MM_Var(library_.get(), master);
+	if (!known_axes)
+	{
+		design_coordinates_.clear();
+		return false;
+	}
+
+	ft_error_ = FT_Set_Var_Design_Coordinates(face_.get(), static_cast<FT_UInt>(design_coordinates_.size()), design_coordinates_.data());
+	return !ft_error_;
+}
+#pragma endregion
+
+#pragma region init_char_range
+void text_to_texture_atlas::Font::init_char_range()
+{
+	if (options_.charset.empty())
+	{
+		return;
+	}
+
+	char32_t range_min{ options_.charset.front().first };
+	char32_t range_max{ options_.charset.front().last };
+	for (const auto& range : options_.charset)
+	{
+		range_min = std::min(range_min, range.first);
+		range_max = std::max(range_max, range.last);
+	}
+	char_range_min = static_cast<int>(range_min);
+	char_range_max = static_cast<int>(range_max);
+}
+#pragma endregion
+
 #pragma region init_char_size
 bool text_to_texture_atlas::Font::init_char_size()
 {
 	ft_error_ = FT_Set_Char_Size
 	(
-		face_,
+		face_.get(),
 		0,
-		char_pt_size_,
+		std::max(1l, std::lround(char_pt_size_ * static_cast<double>(resolution_scale_))),
 		char_width_dpi_,
 		char_height_dpi_
 	);
@@ -96,11 +278,16 @@ bool text_to_texture_atlas::Font::init_char_size()
 #pragma region init_pixel_size
 bool text_to_texture_atlas::Font::init_pixel_size()
 {
+	// A width of 0 means "same as the height" to FreeType, which scaling preserves.
+	const auto scale_pixels = [&](const unsigned int pixels)
+	{
+		return pixels ? std::max(1u, static_cast<unsigned int>(std::lround(pixels * static_cast<double>(resolution_scale_)))) : 0u;
+	};
 	ft_error_ = FT_Set_Pixel_Sizes
 	(
-		face_,
-		char_width_px_,
-		char_height_px_
+		face_.get(),
+		scale_pixels(char_width_px_),
+		scale_pixels(char_height_px_)
 	);
 	if (ft_error_)
 	{
@@ -115,398 +302,1751 @@ bool text_to_texture_atlas::Font::init_character_map()
 {
 
 	FT_UInt glyph_index{};
+	const unsigned int channels{ options_.format == atlas_format::r8 ? 1u : 4u };
 
-	character_map_.reserve(char_range_max - char_range_min + 1);
-
-	for (int i = char_range_min; i <= char_range_max; i++)
+	size_t charset_size{};
+	for (const auto& range : options_.charset)
 	{
-		//init_char_size();
+		charset_size += range.last >= range.first ? range.last - range.first + 1 : 0;
+	}
+	character_map_.reserve(charset_size);
+	const bool use_cache{ options_.cache || options_.pack };
+	const std::uint64_t size_key{ use_cache ? compute_size_key() : 0 };
 
-		glyph_index = FT_Get_Char_Index(face_, i);
-		ft_error_ = FT_Load_Glyph(face_, glyph_index, FT_LOAD_DEFAULT);
-		if (ft_error_)
+	const auto& effects{ options_.effects };
+	std::unique_ptr<FT_StrokerRec_, stroker_deleter> stroker{};
+	if (effects.outline > 0.0f)
+	{
+		if (effects.packing == effect_packing::channels && channels != 4)
 		{
-			std::cout << "error loading glyph!\n";
-			continue; 
+			report_issue({ .phase = build_phase::characters, .code = build_error::outline_needs_rgba });
+			return false;
 		}
-
-		ft_error_ = FT_Render_Glyph(face_->glyph, FT_RENDER_MODE_NORMAL);
+		FT_Stroker new_stroker{};
+		ft_error_ = FT_Stroker_New(library_.get(), &new_stroker);
 		if (ft_error_)
 		{
-			std::cout << "error rendering glyph!\n";
-			continue;
+			report_issue({ .phase = build_phase::characters, .code = build_error::stroker_failed, .ft_error = ft_error_ });
+			return false;
 		}
+		stroker.reset(new_stroker);
+		FT_Stroker_Set(stroker.get(), std::lround(effects.outline * resolution_scale_ * 64.0f), FT_STROKER_LINECAP_ROUND, FT_STROKER_LINEJOIN_ROUND, 0);
+	}
 
-		auto& bitmap{ face_->glyph->bitmap };
-		if (!bitmap.buffer && !isspace(static_cast<char>(i)))
+	for (const auto& range : options_.charset)
+	{
+		for (char32_t i = range.first; i <= range.last && i >= range.first; i++)
 		{
-			continue;
-		}
-		size_t flat_size{static_cast<size_t>(bitmap.rows * bitmap.width * 4)};
+			if (character_map_.contains(i))
+			{
+				continue;
+			}
 
-		character_map_[static_cast<char>(i)] = character{};
-		character& current_character = character_map_[static_cast<char>(i)];
+			// Codepoints the font has no glyph for would only render the .notdef box.
+			glyph_index = FT_Get_Char_Index(face_.get(), i);
+			if (glyph_index == 0)
+			{
+				continue;
+			}
 
-		current_character.height_ = bitmap.rows;
-		current_character.width_ = bitmap.width;
-		current_character.x_bearing_ = face_->glyph->bitmap_left;
-		current_character.y_bearing_ = face_->glyph->bitmap_top;
-		current_character.advance_x_ = face_->glyph->advance.x;
-		current_character.advance_y_ = face_->glyph->advance.y;
+			if (effects.is_active())
+			{
+				std::shared_ptr<const cached_glyph> fill{};
+				std::shared_ptr<const cached_glyph> outline{};
+				if (!load_effect_glyph(glyph_index, size_key, stroker.get(), fill, outline))
+				{
+					report_issue({ .phase = build_phase::characters, .code = build_error::glyph_render_failed, .severity = issue_severity::warning, .ft_error = ft_error_, .codepoint = i, .has_codepoint = true });
+					continue;
+				}
+				const bool separate{ outline && effects.packing == effect_packing::variants };
+				if (!emplace_effect_character(i, *fill, separate ? nullptr : outline.get(), channels)
+					|| (separate && !emplace_effect_character(outline_variant(i), *outline, nullptr, channels)))
+				{
+					report_issue({ .phase = build_phase::characters, .code = build_error::bitmap_conversion_failed, .ft_error = ft_error_, .codepoint = i, .has_codepoint = true });
+					return false;
+				}
+				continue;
+			}
 
-		current_character.raw_bitmap_buffer = std::vector<unsigned char>(flat_size);
+			const FT_Bitmap* rendered_bitmap{};
+			int bitmap_left{};
+			int bitmap_top{};
+			FT_Pos advance_x{};
+			FT_Pos advance_y{};
+			int vertical_left{};
+			int vertical_top{};
+			FT_Pos vertical_advance{};
+			std::shared_ptr<const cached_glyph> cached{};
+			FT_Bitmap cached_bitmap{};
+
+			if (use_cache)
+			{
+				if (!load_cached_glyph(glyph_index, size_key, cached))
+				{
+					report_issue({ .phase = build_phase::characters, .code = build_error::glyph_render_failed, .severity = issue_severity::warning, .ft_error = ft_error_, .codepoint = i, .has_codepoint = true });
+					continue;
+				}
+				cached_bitmap.rows = cached->height;
+				cached_bitmap.width = cached->width;
+				cached_bitmap.pitch = static_cast<int>(cached->width);
+				cached_bitmap.pixel_mode = FT_PIXEL_MODE_GRAY;
+				cached_bitmap.num_grays = 256;
+				cached_bitmap.buffer = cached->coverage.empty() ? nullptr : const_cast<unsigned char*>(cached->coverage.data());
+				rendered_bitmap = &cached_bitmap;
+				bitmap_left = cached->left;
+				bitmap_top = cached->top;
+				advance_x = cached->advance_x;
+				advance_y = cached->advance_y;
+				vertical_left = cached->vertical_left;
+				vertical_top = cached->vertical_top;
+				vertical_advance = cached->vertical_advance;
+			}
+			else
+			{
+				ft_error_ = FT_Load_Glyph(face_.get(), glyph_index, FT_LOAD_DEFAULT);
+				if (ft_error_)
+				{
+					report_issue({ .phase = build_phase::characters, .code = build_error::glyph_load_failed, .severity = issue_severity::warning, .ft_error = ft_error_, .codepoint = i, .has_codepoint = true });
+					continue;
+				}
+
+				if (!render_glyph(rendered_bitmap, bitmap_left, bitmap_top))
+				{
+					report_issue({ .phase = build_phase::characters, .code = build_error::glyph_render_failed, .severity = issue_severity::warning, .ft_error = ft_error_, .codepoint = i, .has_codepoint = true });
+					continue;
+				}
+				advance_x = face_->glyph->advance.x;
+				advance_y = face_->glyph->advance.y;
+				get_vertical_bearings(face_->glyph->metrics, bitmap_left, bitmap_top, vertical_left, vertical_top);
+				vertical_advance = face_->glyph->metrics.vertAdvance;
+			}
+
+			auto& bitmap{ *rendered_bitmap };
+			const bool is_space{ is_space_codepoint(i) };
+			if (!bitmap.buffer && !is_space)
+			{
+				continue;
+			}
+			size_t flat_size{ static_cast<size_t>(bitmap.rows) * bitmap.width * channels };
+
+			// The staging bitmap comes from the scratch resource, which only construction can choose.
+			character& current_character = character_map_.try_emplace(i, character{
+				.raw_bitmap_buffer = std::pmr::vector<unsigned char>(flat_size, get_scratch_resource()),
+				.channels_ = channels }).first->second;
+
+			current_character.height_ = bitmap.rows;
+			current_character.width_ = bitmap.width;
+			current_character.x_bearing_ = bitmap_left;
+			current_character.y_bearing_ = bitmap_top;
+			current_character.advance_x_ = advance_x;
+			current_character.advance_y_ = advance_y;
+			if (options_.vertical_metrics)
+			{
+				current_character.advance_y_ = vertical_advance;
+				current_character.vertical_x_bearing_ = vertical_left;
+				current_character.vertical_y_bearing_ = vertical_top;
+			}
+
+			if (is_space)
+			{
+				continue;
+			}
+
+			if (!convert_bitmap_to_channel_buffer(current_character.raw_bitmap_buffer, bitmap, bitmap.width, bitmap.rows, channels))
+			{
+				report_issue({ .phase = build_phase::characters, .code = build_error::bitmap_conversion_failed, .ft_error = ft_error_, .codepoint = i, .has_codepoint = true });
+				return false;
+			}
 
-		if (isspace(static_cast<char>(i)))
-		{
-			continue;
 		}
+	}
+	return add_sprites(channels);
+}
+#pragma endregion
 
-		if (!convert_bitmap_to_four_channel_buffer(current_character.raw_bitmap_buffer, bitmap.width, bitmap.rows))
+#pragma region add_sprites
+bool text_to_texture_atlas::Font::add_sprites(const unsigned int channels)
+{
+	for (const auto& sprite : options_.sprites)
+	{
+		const char32_t key{ sprite_key(sprite.id) };
+		const size_t row_bytes{ static_cast<size_t>(sprite.width) * sprite.channels };
+		const size_t row_pitch{ sprite.row_pitch ? sprite.row_pitch : row_bytes };
+		const bool valid_size{ sprite.width && sprite.height && row_pitch >= row_bytes
+			&& sprite.pixels.size() >= row_pitch * (sprite.height - 1) + row_bytes };
+		if (sprite.id >= sprite_bit || (sprite.channels != 1 && sprite.channels != 4) || !valid_size || character_map_.contains(key))
 		{
-			std::cout << "error converting bitmap to vector\n";
+			report_issue({ .phase = build_phase::characters, .code = build_error::sprite_invalid, .codepoint = key, .has_codepoint = true });
 			return false;
 		}
 
+		character& current_character = character_map_.try_emplace(key, character{
+			.raw_bitmap_buffer = std::pmr::vector<unsigned char>(static_cast<size_t>(sprite.width) * sprite.height * channels, get_scratch_resource()),
+			.channels_ = channels }).first->second;
+		current_character.width_ = sprite.width;
+		current_character.height_ = sprite.height;
+		current_character.x_bearing_ = sprite.bearing_x;
+		current_character.y_bearing_ = sprite.bearing_y;
+		current_character.advance_x_ = static_cast<FT_Pos>(sprite.advance ? sprite.advance : static_cast<int>(sprite.width)) * 64;
+
+		// Colour is kept only when both sides have it. Otherwise the sprite becomes coverage, stored
+		// the way glyph coverage is: alone in R8, in the alpha channel of RGBA8.
+		auto* destination{ current_character.raw_bitmap_buffer.data() };
+		for (unsigned int y = 0; y < sprite.height; y++)
+		{
+			const unsigned char* source_row{ sprite.pixels.data() + y * row_pitch };
+			if (sprite.channels == channels)
+			{
+				destination = std::copy_n(source_row, row_bytes, destination);
+				continue;
+			}
+			for (unsigned int x = 0; x < sprite.width; x++)
+			{
+				const unsigned char coverage{ source_row[static_cast<size_t>(x) * sprite.channels + (sprite.channels - 1)] };
+				if (channels == 4)
+				{
+					*destination++ = 0;
+					*destination++ = 0;
+					*destination++ = 0;
+				}
+				*destination++ = coverage;
+			}
+		}
 	}
 	return true;
 }
 #pragma endregion
 
-#pragma region convert_bitmap_to_vector
-bool text_to_texture_atlas::Font::convert_bitmap_to_four_channel_buffer
+#pragma region find_cached_glyph
+bool text_to_texture_atlas::Font::find_cached_glyph
 (
-	std::vector<unsigned char>& dst_vector,
-	unsigned int bitmap_width,
-	unsigned int bitmap_height
+	const glyph_key& key,
+	std::shared_ptr<const cached_glyph>& glyph
 ) const
 {
-	auto& bitmap{ face_->glyph->bitmap };
-	if (!bitmap.buffer) { return false; }
-	
-	for (unsigned int y = 0; y < bitmap_height; y++)
+	glyph = options_.cache ? options_.cache->find(key) : nullptr;
+	if (glyph)
 	{
-		for (unsigned int x = 0; x < bitmap_width; x++)
-		{
-			auto flat{ (y * bitmap_width + x) };
-			auto current{ bitmap.buffer[flat] };
-			auto dst_flat{ flat * 4 };
-			if (current == '\0')
-			{
-				dst_vector[dst_flat] = 0;
-				dst_vector[dst_flat + 1] = 0;
-				dst_vector[dst_flat + 2] = 0;
-				dst_vector[dst_flat + 3] = 0;
-				continue;
-			}
-			dst_vector[dst_flat] = 0;
-			dst_vector[dst_flat + 1] = 0;
-			dst_vector[dst_flat + 2] = 0;
-			dst_vector[dst_flat + 3] = current;
-		}
+		return true;
 	}
 
-	return true;
-	
+	cached_glyph packed{};
+	if (options_.pack && options_.pack->find(key, packed))
+	{
+		glyph = options_.cache ? options_.cache->insert(key, std::move(packed)) : std::make_shared<const cached_glyph>(std::move(packed));
+		return true;
+	}
+	return false;
 }
 #pragma endregion
 
-#pragma region get_total_buffer_size
-size_t text_to_texture_atlas::Font::get_total_buffer_size() const
+#pragma region store_cached_glyph
+std::shared_ptr<const text_to_texture_atlas::cached_glyph> text_to_texture_atlas::Font::store_cached_glyph
+(
+	const glyph_key& key,
+	cached_glyph&& glyph
+) const
 {
-	size_t total_size{};
-	for (const auto& val : character_map_ | std::views::values)
+	// A failed append only costs a re-render next time, so it does not fail the build.
+	if (options_.pack)
 	{
-		total_size += val.raw_bitmap_buffer.size();
+		options_.pack->insert(key, glyph);
 	}
-	return total_size;
+	return options_.cache ? options_.cache->insert(key, std::move(glyph)) : std::make_shared<const cached_glyph>(std::move(glyph));
 }
 #pragma endregion
 
-#pragma region get_max_character_width
-unsigned int text_to_texture_atlas::Font::get_max_character_width() const
+#pragma region load_cached_glyph
+bool text_to_texture_atlas::Font::load_cached_glyph
+(
+	const FT_UInt glyph_index,
+	const std::uint64_t size_key,
+	std::shared_ptr<const cached_glyph>& glyph
+)
 {
-	unsigned int max_size{};
-	for (const auto& val : character_map_ | std::views::values)
+	const glyph_key key{ .face = face_key_, .size = size_key, .glyph_index = glyph_index, .rasterizer = options_.rasterizer };
+	if (find_cached_glyph(key, glyph))
 	{
-		max_size = std::max(val.width_, max_size);
+		return true;
 	}
-	return max_size;
 
+	ft_error_ = FT_Load_Glyph(face_.get(), glyph_index, FT_LOAD_DEFAULT);
+	if (ft_error_)
+	{
+		return false;
+	}
+
+	const FT_Bitmap* bitmap{};
+	cached_glyph rendered{};
+	if (!render_glyph(bitmap, rendered.left, rendered.top))
+	{
+		return false;
+	}
+	copy_coverage(*bitmap, rendered);
+	rendered.advance_x = face_->glyph->advance.x;
+	rendered.advance_y = face_->glyph->advance.y;
+	get_vertical_bearings(face_->glyph->metrics, rendered.left, rendered.top, rendered.vertical_left, rendered.vertical_top);
+	rendered.vertical_advance = face_->glyph->metrics.vertAdvance;
+
+	glyph = store_cached_glyph(key, std::move(rendered));
+	return true;
 }
 #pragma endregion
 
-#pragma region get_max_character_height
-unsigned int text_to_texture_atlas::Font::get_max_character_height() const
+#pragma region load_effect_glyph
+bool text_to_texture_atlas::Font::load_effect_glyph
+(
+	const FT_UInt glyph_index,
+	const std::uint64_t size_key,
+	const FT_Stroker stroker,
+	std::shared_ptr<const cached_glyph>& fill,
+	std::shared_ptr<const cached_glyph>& outline
+)
 {
-	unsigned int max_size{};
-	for (const auto& val : character_map_ | std::views::values)
+	const bool use_cache{ options_.cache || options_.pack };
+	glyph_key fill_key{};
+	glyph_key outline_key{};
+	if (use_cache)
 	{
-		max_size = std::max(val.height_, max_size);
+		// The effects change the rendered glyph, so they are part of each layer's size key.
+		const auto& effects{ options_.effects };
+		content_hasher hasher{};
+		hasher.update_value(size_key);
+		hasher.update_value(std::bit_cast<std::uint32_t>(effects.embolden));
+		hasher.update_value(std::bit_cast<std::uint32_t>(effects.oblique));
+		fill_key = { .face = face_key_, .size = hasher.digest(), .glyph_index = glyph_index, .rasterizer = options_.rasterizer };
+		hasher.update_value(std::bit_cast<std::uint32_t>(effects.outline));
+		outline_key = { .face = face_key_, .size = hasher.digest(), .glyph_index = glyph_index, .rasterizer = options_.rasterizer };
+
+		outline = nullptr;
+		if (find_cached_glyph(fill_key, fill) && (!stroker || find_cached_glyph(outline_key, outline)))
+		{
+			return true;
+		}
 	}
-	return max_size;
 
+	cached_glyph rendered_fill{};
+	cached_glyph rendered_outline{};
+	if (!render_effect_layers(glyph_index, stroker, rendered_fill, rendered_outline))
+	{
+		return false;
+	}
+	if (use_cache)
+	{
+		fill = store_cached_glyph(fill_key, std::move(rendered_fill));
+		outline = stroker ? store_cached_glyph(outline_key, std::move(rendered_outline)) : nullptr;
+	}
+	else
+	{
+		fill = std::make_shared<const cached_glyph>(std::move(rendered_fill));
+		outline = stroker ? std::make_shared<const cached_glyph>(std::move(rendered_outline)) : nullptr;
+	}
+	return true;
 }
 #pragma endregion
 
-#pragma region constructors
-text_to_texture_atlas::Font::Font
+#pragma region render_effect_layers
+bool text_to_texture_atlas::Font::render_effect_layers
 (
-	std::string font_name,
-	const signed long char_pt_size,
-	const unsigned int char_width_dpi,
-	const unsigned int char_height_dpi
+	const FT_UInt glyph_index,
+	const FT_Stroker stroker,
+	cached_glyph& fill,
+	cached_glyph& outline
 )
-	: selected_font_(std::move(font_name)),
-	char_pt_size_(char_pt_size),
-	char_width_dpi_(char_width_dpi),
-	char_height_dpi_(char_height_dpi)
 {
-	const auto logger = spdlog::stdout_color_mt("console");
+	ft_error_ = FT_Load_Glyph(face_.get(), glyph_index, FT_LOAD_DEFAULT);
+	if (ft_error_)
+	{
+		return false;
+	}
 
-	if (!error_)
+	const auto slot{ face_->glyph };
+	const auto& effects{ options_.effects };
+	FT_Pos strength{};
+	std::unique_ptr<FT_GlyphRec_, glyph_deleter> border{};
+
+	// Bitmap-only glyphs have no outline to transform, so they are rendered as they are.
+	if (slot->format == FT_GLYPH_FORMAT_OUTLINE)
 	{
-		if (!init_library())
+		if (effects.oblique != 0.0f)
 		{
-			SPDLOG_LOGGER_ERROR(logger, "Error initializing freetype library");
-			error_ = true;
+			// Shears along x in proportion to the height above the baseline, like FT_GlyphSlot_Oblique.
+			const FT_Matrix shear{ .xx = 0x10000, .xy = static_cast<FT_Fixed>(std::lround(effects.oblique * 65536.0f)), .yx = 0, .yy = 0x10000 };
+			FT_Outline_Transform(&slot->outline, &shear);
 		}
-	}
-	if (!error_)
-	{
-		if (!init_face())
+		if (effects.embolden != 0.0f)
 		{
-			SPDLOG_LOGGER_ERROR(logger, "Error initializing freetype face");
-			error_ = true;
+			strength = std::lround(effects.embolden * resolution_scale_ * 64.0f);
+			ft_error_ = FT_Outline_EmboldenXY(&slot->outline, strength, strength);
+			if (ft_error_)
+			{
+				return false;
+			}
 		}
-	}
-	if (!error_)
-	{
-		if (!init_char_size())
+
+		// The border is stroked from a copy, before rendering replaces the slot's outline with a bitmap.
+		if (stroker)
 		{
-			SPDLOG_LOGGER_ERROR(logger, "Error initializing freetype character size");
-			error_ = true;
+			FT_Glyph glyph{};
+			ft_error_ = FT_Get_Glyph(slot, &glyph);
+			if (ft_error_)
+			{
+				return false;
+			}
+			ft_error_ = FT_Glyph_StrokeBorder(&glyph, stroker, false, true);
+			border.reset(glyph);
+			if (ft_error_)
+			{
+				return false;
+			}
 		}
 	}
-	if (!error_)
+
+	const FT_Bitmap* bitmap{};
+	if (!render_glyph(bitmap, fill.left, fill.top))
+	{
+		return false;
+	}
+	copy_coverage(*bitmap, fill);
+	fill.advance_x = slot->advance.x + strength;
+	fill.advance_y = slot->advance.y;
+	get_vertical_bearings(slot->metrics, fill.left, fill.top, fill.vertical_left, fill.vertical_top);
+	fill.vertical_advance = slot->metrics.vertAdvance + strength;
+
+	// The outline layer shares the fill's advances; without a border it stays empty.
+	outline.advance_x = fill.advance_x;
+	outline.advance_y = fill.advance_y;
+	outline.vertical_advance = fill.vertical_advance;
+	if (!border)
 	{
+		return true;
+	}
 
-		if (!init_character_map())
+	// The outside border is the glyph grown by the outline width, drawn underneath the fill.
+	if (options_.rasterizer == rasterizer_backend::scanline)
+	{
+		if (!rasterizer_.render(reinterpret_cast<FT_OutlineGlyph>(border.get())->outline))
 		{
-			SPDLOG_LOGGER_ERROR(logger, "Error initializing character map");
-			error_ = true;
+			ft_error_ = FT_Err_Invalid_Outline;
+			return false;
 		}
+		copy_coverage(rasterizer_.get_bitmap(), outline);
+		outline.left = rasterizer_.get_bitmap_left();
+		outline.top = rasterizer_.get_bitmap_top();
 	}
-	if (!error_)
+	else
 	{
-		if (!init_main_atlas_buffer())
+		FT_Glyph glyph{ border.release() };
+		ft_error_ = FT_Glyph_To_Bitmap(&glyph, FT_RENDER_MODE_NORMAL, nullptr, true);
+		border.reset(glyph);
+		if (ft_error_)
 		{
-			SPDLOG_LOGGER_ERROR(logger, "Error initializing atlas buffer");
-			error_ = true;
+			return false;
 		}
+		const auto rendered{ reinterpret_cast<FT_BitmapGlyph>(glyph) };
+		copy_coverage(rendered->bitmap, outline);
+		outline.left = rendered->left;
+		outline.top = rendered->top;
 	}
-
+	get_vertical_bearings(slot->metrics, outline.left, outline.top, outline.vertical_left, outline.vertical_top);
+	return true;
 }
+#pragma endregion
 
-text_to_texture_atlas::Font::Font(
-	std::string font_name,
-	const unsigned int char_height,
-	const unsigned int char_width
+#pragma region emplace_effect_character
+bool text_to_texture_atlas::Font::emplace_effect_character
+(
+	const char32_t codepoint,
+	const cached_glyph& fill,
+	const cached_glyph* outline,
+	const unsigned int channels
 )
-	: selected_font_(std::move(font_name)),
-		char_width_px_(char_width),
-		char_height_px_(char_height)
 {
-	const auto logger = spdlog::stdout_color_mt("console");
-	if (!error_)
+	// Each layer lands in its own channel: fill in alpha (or the only channel), outline in red.
+	const std::pair<const cached_glyph*, unsigned int> layers[]{
+		{ fill.coverage.empty() ? nullptr : &fill, channels - 1 },
+		{ outline && !outline->coverage.empty() ? outline : nullptr, 0 } };
+
+	// The character covers every layer; the border usually contains the fill.
+	int left{ fill.left };
+	int top{ fill.top };
+	int right{ left };
+	int bottom{ top };
+	bool first{ true };
+	for (const auto& [layer, channel] : layers)
 	{
-		if (!init_library())
+		if (!layer)
 		{
-			SPDLOG_LOGGER_ERROR(logger, "Error initializing freetype library");
-			error_ = true;
+			continue;
 		}
+		const int layer_right{ layer->left + static_cast<int>(layer->width) };
+		const int layer_bottom{ layer->top - static_cast<int>(layer->height) };
+		left = first ? layer->left : std::min(left, layer->left);
+		top = first ? layer->top : std::max(top, layer->top);
+		right = first ? layer_right : std::max(right, layer_right);
+		bottom = first ? layer_bottom : std::min(bottom, layer_bottom);
+		first = false;
 	}
-	if (!error_)
+	if (first && !is_space_codepoint(codepoint & ~outline_variant_bit))
 	{
-		if (!init_face())
-		{
-			SPDLOG_LOGGER_ERROR(logger, "Error initializing freetype face");
-			error_ = true;
-		}
+		return true;
 	}
-	if (!error_)
+
+	const auto width{ static_cast<unsigned int>(right - left) };
+	const auto height{ static_cast<unsigned int>(top - bottom) };
+	character& current_character = character_map_.try_emplace(codepoint, character{
+		.raw_bitmap_buffer = std::pmr::vector<unsigned char>(static_cast<size_t>(width) * height * channels, get_scratch_resource()),
+		.channels_ = channels }).first->second;
+
+	current_character.width_ = width;
+	current_character.height_ = height;
+	current_character.x_bearing_ = left;
+	current_character.y_bearing_ = top;
+	current_character.advance_x_ = fill.advance_x;
+	current_character.advance_y_ = fill.advance_y;
+	if (options_.vertical_metrics)
 	{
-		if (!init_pixel_size())
-		{
-			SPDLOG_LOGGER_ERROR(logger, "Error initializing freetype pixel size");
-			error_ = true;
+		current_character.advance_y_ = fill.vertical_advance;
+		current_character.vertical_x_bearing_ = fill.vertical_left + (left - fill.left);
+		current_character.vertical_y_bearing_ = fill.vertical_top + (fill.top - top);
+	}
+
+	for (const auto& [layer, channel] : layers)
+	{
+		if (!layer)
+		{
+			continue;
+		}
+		const auto offset_x{ static_cast<size_t>(layer->left - left) };
+		const auto offset_y{ static_cast<size_t>(top - layer->top) };
+		for (unsigned int y = 0; y < layer->height; y++)
+		{
+			for (unsigned int x = 0; x < layer->width; x++)
+			{
+				const size_t flat{ (offset_y + y) * width + offset_x + x };
+				current_character.raw_bitmap_buffer[flat * channels + channel] = layer->coverage[static_cast<size_t>(y) * layer->width + x];
+			}
+		}
+	}
+	return true;
+}
+#pragma endregion
+
+#pragma region render_glyph
+bool text_to_texture_atlas::Font::render_glyph
+(
+	const FT_Bitmap*& bitmap,
+	int& bitmap_left,
+	int& bitmap_top
+)
+{
+	const auto slot{ face_->glyph };
+
+	// Bitmap-only glyphs (embedded strikes, bitmap fonts) have no outline to rasterize.
+	if (options_.rasterizer == rasterizer_backend::scanline && slot->format == FT_GLYPH_FORMAT_OUTLINE)
+	{
+		if (!rasterizer_.render(slot->outline))
+		{
+			ft_error_ = FT_Err_Invalid_Outline;
+			return false;
+		}
+		bitmap = &rasterizer_.get_bitmap();
+		bitmap_left = rasterizer_.get_bitmap_left();
+		bitmap_top = rasterizer_.get_bitmap_top();
+		return true;
+	}
+
+	ft_error_ = FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
+	if (ft_error_)
+	{
+		return false;
+	}
+	bitmap = &slot->bitmap;
+	bitmap_left = slot->bitmap_left;
+	bitmap_top = slot->bitmap_top;
+	return true;
+}
+#pragma endregion
+
+#pragma region convert_bitmap_to_vector
+bool text_to_texture_atlas::Font::convert_bitmap_to_channel_buffer
+(
+	std::pmr::vector<unsigned char>& dst_vector,
+	const FT_Bitmap& bitmap,
+	unsigned int bitmap_width,
+	unsigned int bitmap_height,
+	unsigned int channels
+) const
+{
+	if (!bitmap.buffer) { return false; }
+	
+	for (unsigned int y = 0; y < bitmap_height; y++)
+	{
+		for (unsigned int x = 0; x < bitmap_width; x++)
+		{
+			auto flat{ (y * bitmap_width + x) };
+			auto current{ bitmap.buffer[y * bitmap.pitch + x] };
+			if (channels == 1)
+			{
+				dst_vector[flat] = current;
+				continue;
+			}
+			auto dst_flat{ flat * 4 };
+			dst_vector[dst_flat] = 0;
+			dst_vector[dst_flat + 1] = 0;
+			dst_vector[dst_flat + 2] = 0;
+			dst_vector[dst_flat + 3] = current;
+		}
+	}
+
+	return true;
+	
+}
+#pragma endregion
+
+#pragma region get_resource
+std::pmr::memory_resource* text_to_texture_atlas::Font::get_resource() const
+{
+	return options_.resource ? options_.resource : std::pmr::get_default_resource();
+}
+#pragma endregion
+
+#pragma region get_scratch_resource
+std::pmr::memory_resource* text_to_texture_atlas::Font::get_scratch_resource() const
+{
+	return options_.scratch_resource ? options_.scratch_resource : get_resource();
+}
+#pragma endregion
+
+#pragma region get_total_buffer_size
+size_t text_to_texture_atlas::Font::get_total_buffer_size() const
+{
+	size_t total_size{};
+	for (const auto& val : character_map_ | std::views::values)
+	{
+		total_size += val.raw_bitmap_buffer.size();
+	}
+	return total_size;
+}
+#pragma endregion
+
+#pragma region get_max_character_width
+unsigned int text_to_texture_atlas::Font::get_max_character_width() const
+{
+	unsigned int max_size{};
+	for (const auto& val : character_map_ | std::views::values)
+	{
+		max_size = std::max(val.width_, max_size);
+	}
+	return max_size;
+
+}
+#pragma endregion
+
+#pragma region get_max_character_height
+unsigned int text_to_texture_atlas::Font::get_max_character_height() const
+{
+	unsigned int max_size{};
+	for (const auto& val : character_map_ | std::views::values)
+	{
+		max_size = std::max(val.height_, max_size);
+	}
+	return max_size;
+
+}
+#pragma endregion
+
+#pragma region constructors
+text_to_texture_atlas::Font::Font
+(
+	std::string font_name,
+	const signed long char_pt_size,
+	const unsigned int char_width_dpi,
+	const unsigned int char_height_dpi,
+	const build_options& options
+)
+	: options_(options),
+	rasterizer_(get_scratch_resource()),
+	character_map_(get_resource()),
+	main_atlas_{ .atlas_buffer = std::pmr::vector<unsigned char>(get_resource()) },
+	reservation_(options.memory.shared),
+	extended_records_(get_resource()),
+	fonts_path_(options.font_directory),
+	selected_font_(std::move(font_name)),
+	char_pt_size_(char_pt_size),
+	char_width_dpi_(char_width_dpi),
+	char_height_dpi_(char_height_dpi)
+{
+	init_char_range();
+
+	if (!error_)
+	{
+		if (!init_library())
+		{
+			report_issue({ .phase = build_phase::library, .code = build_error::library_failed, .ft_error = ft_error_ });
+		}
+	}
+	if (!error_)
+	{
+		if (!init_face())
+		{
+			report_issue({ .phase = build_phase::face, .code = build_error::face_failed, .ft_error = ft_error_ });
+		}
+	}
+	if (!error_)
+	{
+		if (!init_variation())
+		{
+			report_issue({ .phase = build_phase::variation, .code = build_error::variation_failed, .ft_error = ft_error_ });
+		}
+	}
+	if (!error_)
+	{
+		if (!init_char_size())
+		{
+			report_issue({ .phase = build_phase::size, .code = build_error::size_failed, .ft_error = ft_error_ });
+		}
+	}
+	if (!error_)
+	{
+		if (!init_character_map())
+		{
+			error_ = true;
+		}
+	}
+	if (!error_)
+	{
+		if (!fit_memory_budget())
+		{
+			error_ = true;
+		}
+	}
+	if (!error_)
+	{
+		if (!init_main_atlas_buffer())
+		{
+			error_ = true;
+		}
+	}
+	if (!error_)
+	{
+		init_glyph_records();
+	}
+	if (!error_)
+	{
+		if (options_.release_staging)
+		{
+			free_character_buffers();
+			rasterizer_.release();
+		}
+		update_reservation();
+	}
+
+}
+
+text_to_texture_atlas::Font::Font(
+	std::string font_name,
+	const unsigned int char_height,
+	const unsigned int char_width,
+	const build_options& options
+)
+	: options_(options),
+		rasterizer_(get_scratch_resource()),
+		character_map_(get_resource()),
+		main_atlas_{ .atlas_buffer = std::pmr::vector<unsigned char>(get_resource()) },
+		reservation_(options.memory.shared),
+		extended_records_(get_resource()),
+		fonts_path_(options.font_directory),
+		selected_font_(std::move(font_name)),
+		char_width_px_(char_width),
+		char_height_px_(char_height),
+		pixel_sizing_(true)
+{
+	init_char_range();
+	if (!error_)
+	{
+		if (!init_library())
+		{
+			report_issue({ .phase = build_phase::library, .code = build_error::library_failed, .ft_error = ft_error_ });
+		}
+	}
+	if (!error_)
+	{
+		if (!init_face())
+		{
+			report_issue({ .phase = build_phase::face, .code = build_error::face_failed, .ft_error = ft_error_ });
+		}
+	}
+	if (!error_)
+	{
+		if (!init_variation())
+		{
+			report_issue({ .phase = build_phase::variation, .code = build_error::variation_failed, .ft_error = ft_error_ });
+		}
+	}
+	if (!error_)
+	{
+		if (!init_pixel_size())
+		{
+			report_issue({ .phase = build_phase::size, .code = build_error::size_failed, .ft_error = ft_error_ });
+		}
+	}
+	if (!error_)
+	{
+		if (!init_character_map())
+		{
+			error_ = true;
+		}
+	}
+	if (!error_)
+	{
+		if (!fit_memory_budget())
+		{
+			error_ = true;
+		}
+	}
+	if (!error_)
+	{
+		if (!init_main_atlas_buffer())
+		{
+			error_ = true;
+		}
+	}
+	if (!error_)
+	{
+		init_glyph_records();
+	}
+	if (!error_)
+	{
+		if (options_.release_staging)
+		{
+			free_character_buffers();
+			rasterizer_.release();
+		}
+		update_reservation();
+	}
+}
+
+text_to_texture_atlas::Font text_to_texture_atlas::Font::Font_Pt
+(const std::string& font_name, signed long char_pt_size, unsigned int char_width_dpi, unsigned int char_height_dpi, const build_options& options)
+{
+	return Font{ font_name, char_pt_size, char_width_dpi, char_height_dpi, options };
+}
+
+text_to_texture_atlas::Font text_to_texture_atlas::Font::Font_Px
+(const std::string& font_name, unsigned int char_height, unsigned int char_width, const build_options& options)
+{
+	return Font{ font_name, char_height, char_width, options };
+}
+#pragma endregion
+
+#pragma region report_issue
+void text_to_texture_atlas::Font::report_issue(const build_issue& issue)
+{
+	issues_.push_back(issue);
+	if (issue.severity == issue_severity::error)
+	{
+		error_ = true;
+	}
+	if (options_.on_issue)
+	{
+		options_.on_issue(issue);
+	}
+}
+#pragma endregion
+
+#pragma region describe
+std::string text_to_texture_atlas::describe(const build_issue& issue)
+{
+	constexpr std::string_view phase_names[]{ "library", "face", "variation", "size", "characters", "memory budget", "atlas" };
+	std::string_view message{};
+	switch (issue.code)
+	{
+	case build_error::library_failed: message = "FreeType could not be initialized"; break;
+	case build_error::face_failed: message = "the font file could not be opened or read"; break;
+	case build_error::variation_failed: message = "the variation coordinates could not be applied"; break;
+	case build_error::size_failed: message = "the character size was rejected"; break;
+	case build_error::stroker_failed: message = "the outline stroker could not be created"; break;
+	case build_error::outline_needs_rgba: message = "an outline packed into channels needs an rgba8 atlas"; break;
+	case build_error::glyph_load_failed: message = "could not be loaded"; break;
+	case build_error::glyph_render_failed: message = "could not be rendered"; break;
+	case build_error::bitmap_conversion_failed: message = "could not be converted to the atlas format"; break;
+	case build_error::sprite_invalid: message = "has a duplicate or too large id, no size, an unsupported channel count or too few pixels"; break;
+	case build_error::switched_to_shelf_packer: message = "over budget, switching to the shelf packer"; break;
+	case build_error::switched_to_r8: message = "over budget, switching to R8"; break;
+	case build_error::lowered_resolution: message = "over budget, rendering at a lower resolution"; break;
+	case build_error::budget_exceeded: message = "the build does not fit the memory budget"; break;
+	case build_error::placement_failed: message = "the characters could not be placed"; break;
+	case build_error::destination_invalid: message = "the atlas destination is missing, too small or misaligned"; break;
+	case build_error::blit_failed: message = "the glyphs could not be copied into the atlas"; break;
+	case build_error::atlas_full: message = "does not fit in the shared atlas"; break;
+	}
+
+	std::ostringstream stream{};
+	stream << phase_names[static_cast<size_t>(issue.phase)] << ": ";
+	if (issue.has_codepoint && (issue.codepoint & sprite_bit))
+	{
+		stream << "sprite " << static_cast<std::uint32_t>(issue.codepoint & ~sprite_bit) << " ";
+	}
+	else if (issue.has_codepoint)
+	{
+		stream << "glyph U+" << std::uppercase << std::hex << std::setfill('0') << std::setw(4) << static_cast<std::uint32_t>(issue.codepoint) << std::dec << " ";
+	}
+	stream << message;
+	if (issue.bytes)
+	{
+		stream << " (" << issue.bytes << " bytes estimated)";
+	}
+	if (issue.ft_error)
+	{
+		stream << " (FreeType error 0x" << std::hex << std::setfill('0') << std::setw(2) << issue.ft_error << std::dec << ")";
+	}
+	return stream.str();
+}
+#pragma endregion
+
+#pragma region free_character_buffers
+void text_to_texture_atlas::Font::free_character_buffers()
+{
+	for (auto& val : character_map_ | std::views::values)
+	{
+		val.raw_bitmap_buffer = std::pmr::vector<unsigned char>{ val.raw_bitmap_buffer.get_allocator() };
+	}
+	update_reservation();
+}
+#pragma endregion
+
+#pragma region free_atlas_buffer
+void text_to_texture_atlas::Font::free_atlas_buffer()
+{
+	main_atlas_.atlas_buffer = std::pmr::vector<unsigned char>{ main_atlas_.atlas_buffer.get_allocator() };
+	main_atlas_.destination = {};
+	update_reservation();
+}
+#pragma endregion
+
+#pragma region get_character
+text_to_texture_atlas::Font::character& text_to_texture_atlas::Font::get_character
+(
+	char character_
+)
+{
+	return character_map_[static_cast<unsigned char>(character_)];
+}
+#pragma endregion
+
+#pragma region find_character
+const text_to_texture_atlas::Font::character* text_to_texture_atlas::Font::find_character
+(
+	const char32_t codepoint
+) const
+{
+	const auto found{ character_map_.find(codepoint) };
+	return found != character_map_.end() ? &found->second : nullptr;
+}
+#pragma endregion
+
+#pragma region get_ascii_records
+std::size_t text_to_texture_atlas::Font::get_ascii_records
+(
+	const std::string_view text,
+	const std::span<const glyph_record*> records
+) const
+{
+	const std::size_t count{ std::min(text.size(), records.size()) };
+	for (std::size_t i = 0; i < count; i++)
+	{
+		records[i] = &get_ascii_record(text[i]);
+	}
+	return count;
+}
+#pragma endregion
+
+#pragma region lookup_utf8
+std::size_t text_to_texture_atlas::Font::lookup_utf8
+(
+	const std::string_view text,
+	std::vector<const glyph_record*>& records,
+	std::vector<glyph_miss>* misses
+) const
+{
+	const auto* bytes{ reinterpret_cast<const unsigned char*>(text.data()) };
+	const std::size_t size{ text.size() };
+	const std::size_t first{ records.size() };
+
+	// A codepoint takes at least one byte, so the text's length bounds the output.
+	records.resize(first + size);
+	const glyph_record** output{ records.data() + first };
+	std::size_t count{};
+	const auto emit = [&](const glyph_record& record, const char32_t codepoint)
+	{
+		if (!record.loaded && misses)
+		{
+			misses->push_back({ .index = first + count, .codepoint = codepoint });
+		}
+		output[count++] = &record;
+	};
+
+	std::size_t i{};
+	while (i < size)
+	{
+#ifdef TEXT_TO_TEXTURE_ATLAS_SSE2
+		// The sign bits of sixteen bytes say whether the block is all ASCII; a block that is not is
+		// mapped up to its first non-ASCII byte, which the scalar decoder below picks up.
+		for (; i + 16 <= size; i += 16)
+		{
+			const unsigned int mask{ static_cast<unsigned int>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i)))) };
+			const unsigned int ascii_run{ mask ? static_cast<unsigned int>(std::countr_zero(mask)) : 16u };
+			for (unsigned int k = 0; k < ascii_run; k++)
+			{
+				emit(ascii_records_[bytes[i + k]], bytes[i + k]);
+			}
+			if (mask)
+			{
+				i += ascii_run;
+				break;
+			}
+		}
+		if (i >= size)
+		{
+			break;
+		}
+#endif
+		if (bytes[i] < 0x80)
+		{
+			emit(ascii_records_[bytes[i]], bytes[i]);
+			i++;
+			continue;
+		}
+
+		std::size_t length{};
+		const char32_t codepoint{ decode_utf8_sequence(bytes + i, size - i, length) };
+		i += length;
+		const auto found{ extended_records_.find(codepoint) };
+		emit(found != extended_records_.end() ? found->second : ascii_records_[128], codepoint);
+	}
+
+	records.resize(first + count);
+	return count;
+}
+#pragma endregion
+
+#pragma region init_glyph_records
+void text_to_texture_atlas::Font::init_glyph_records()
+{
+	ascii_records_.fill(glyph_record{});
+	extended_records_.clear();
+	for (const auto& [codepoint, glyph] : character_map_)
+	{
+		const glyph_record record{
+			.u0 = glyph.tex_coords_top_left.x,
+			.v0 = glyph.tex_coords_top_left.y,
+			.u1 = glyph.tex_coords_bottom_right.x,
+			.v1 = glyph.tex_coords_bottom_right.y,
+			.advance_x = glyph.advance_x_,
+			.bearing_x = static_cast<std::int16_t>(glyph.x_bearing_),
+			.bearing_y = static_cast<std::int16_t>(glyph.y_bearing_),
+			.width = static_cast<std::uint16_t>(glyph.width_),
+			.height = static_cast<std::uint16_t>(glyph.height_),
+			.page = static_cast<std::uint8_t>(glyph.page_),
+			.loaded = true };
+		if (codepoint < 128)
+		{
+			ascii_records_[codepoint] = record;
+		}
+		else
+		{
+			extended_records_.emplace(codepoint, record);
 		}
 	}
-	if (!error_)
+}
+#pragma endregion
+
+#pragma region layout_text
+bool text_to_texture_atlas::Font::layout_text
+(
+	const std::u32string_view text,
+	const text_direction direction,
+	float& pen_x,
+	float& pen_y,
+	std::vector<glyph_quad>& quads
+) const
+{
+	const bool vertical{ direction == text_direction::vertical };
+	if (vertical && !options_.vertical_metrics)
 	{
+		return false;
+	}
 
-		if (!init_character_map())
+	// Metrics are in rendered pixels; the pen moves in requested pixels.
+	const float scale{ 1.0f / resolution_scale_ };
+	quads.reserve(quads.size() + text.size());
+	for (const char32_t codepoint : text)
+	{
+		const character* glyph{ find_character(codepoint) };
+		if (!glyph)
 		{
-			SPDLOG_LOGGER_ERROR(logger, "Error initializing character map");
-			error_ = true;
+			continue;
 		}
-	}
-	if (!error_)
-	{
-		if (!init_main_atlas_buffer())
+
+		if (glyph->width_ && glyph->height_)
 		{
-			SPDLOG_LOGGER_ERROR(logger, "Error initializing atlas buffer");
-			error_ = true;
+			const float left{ pen_x + static_cast<float>(vertical ? glyph->vertical_x_bearing_ : glyph->x_bearing_) * scale };
+			const float top{ vertical ? pen_y + static_cast<float>(glyph->vertical_y_bearing_) * scale : pen_y - static_cast<float>(glyph->y_bearing_) * scale };
+			quads.push_back(glyph_quad{
+				.codepoint = codepoint,
+				.x0 = left,
+				.y0 = top,
+				.x1 = left + static_cast<float>(glyph->width_) * scale,
+				.y1 = top + static_cast<float>(glyph->height_) * scale,
+				.u0 = glyph->tex_coords_top_left.x,
+				.v0 = glyph->tex_coords_top_left.y,
+				.u1 = glyph->tex_coords_bottom_right.x,
+				.v1 = glyph->tex_coords_bottom_right.y,
+				.page = glyph->page_ });
+		}
+
+		if (vertical)
+		{
+			pen_y += static_cast<float>(glyph->advance_y_) / 64.0f * scale;
+		}
+		else
+		{
+			pen_x += static_cast<float>(glyph->advance_x_) / 64.0f * scale;
 		}
 	}
+	return true;
 }
+#pragma endregion
 
-text_to_texture_atlas::Font text_to_texture_atlas::Font::Font_Pt
-(const std::string& font_name, signed long char_pt_size, unsigned int char_width_dpi, unsigned int char_height_dpi)
+#pragma region get_main_atlas
+text_to_texture_atlas::Font::atlas& text_to_texture_atlas::Font::get_main_atlas()
 {
-	return Font{ font_name, char_pt_size, char_width_dpi, char_height_dpi };
+	return main_atlas_;
 }
 
-text_to_texture_atlas::Font text_to_texture_atlas::Font::Font_Px
-(const std::string& font_name, unsigned int char_height, unsigned int char_width)
+const text_to_texture_atlas::Font::atlas& text_to_texture_atlas::Font::get_main_atlas() const
 {
-	return Font{ font_name, char_height, char_width };
+	return main_atlas_;
 }
 #pragma endregion
 
-#pragma region free_character_buffers
-void text_to_texture_atlas::Font::free_character_buffers()
+#pragma region init_main_atlas_buffer
+bool text_to_texture_atlas::Font::init_main_atlas_buffer()
 {
-	for (auto& val : character_map_ | std::views::values)
+	const unsigned int atlas_buffer_channels{ options_.format == atlas_format::r8 ? 1u : 4u };
+
+	// Placement pass: decide where every character goes. The copies themselves are independent
+	// once the rects are known, so they run afterwards in `blit_characters`.
+	std::pmr::vector<character*> placed_characters{ get_scratch_resource() };
+	placed_characters.reserve(character_map_.size());
+	for (auto& a : get_ordered_characters())
+	{
+		if (is_space_codepoint(a.first))
+		{
+			continue;
+		}
+		placed_characters.push_back(a.second);
+	}
+
+	if (options_.shared_atlas)
+	{
+		return place_in_shared_atlas(placed_characters);
+	}
+
+	unsigned int total_buffer_width{};
+	unsigned int total_buffer_height{};
+	const bool placed{ options_.packer == atlas_packer::shelf
+		? place_shelf(placed_characters, total_buffer_width, total_buffer_height)
+		: place_grid(placed_characters, total_buffer_width, total_buffer_height) };
+	if (!placed)
+	{
+		report_issue({ .phase = build_phase::atlas, .code = build_error::placement_failed });
+		return false;
+	}
+
+	const size_t row_bytes{ static_cast<size_t>(total_buffer_width) * atlas_buffer_channels };
+	if (options_.destination)
+	{
+		// The caller's memory replaces the atlas buffer entirely; nothing is staged in between.
+		const atlas_destination destination{ options_.destination(total_buffer_width, total_buffer_height, atlas_buffer_channels) };
+		const size_t row_pitch{ destination.row_pitch ? destination.row_pitch : row_bytes };
+		const size_t required_size{ total_buffer_height ? (total_buffer_height - 1) * row_pitch + row_bytes : 0 };
+		if (!destination.data || row_pitch < row_bytes || row_pitch % atlas_buffer_channels != 0 || destination.size < required_size)
+		{
+			report_issue({ .phase = build_phase::atlas, .code = build_error::destination_invalid });
+			return false;
+		}
+		main_atlas_.atlas_buffer = std::pmr::vector<unsigned char>{ main_atlas_.atlas_buffer.get_allocator() };
+		main_atlas_.destination = { destination.data, destination.size };
+		main_atlas_.row_pitch = row_pitch;
+	}
+	else
+	{
+		main_atlas_.atlas_buffer = std::pmr::vector<unsigned char>(row_bytes * total_buffer_height, main_atlas_.atlas_buffer.get_allocator());
+		main_atlas_.destination = {};
+		main_atlas_.row_pitch = row_bytes;
+	}
+	main_atlas_.width = total_buffer_width;
+	main_atlas_.height = total_buffer_height;
+	main_atlas_.channels = atlas_buffer_channels;
+
+	for (auto* current : placed_characters)
+	{
+		auto& current_character = *current;
+		const unsigned int x_position{ current_character.top_left.x };
+		const unsigned int y_position{ current_character.top_left.y };
+
+		// The X - Y position based on the buffer.
+		current_character.top_right = { .x = x_position + (current_character.width_), .y = y_position };
+		current_character.bottom_left = { .x = x_position, .y = y_position + current_character.height_ };
+		current_character.bottom_right = { .x = x_position + (current_character.width_), .y = y_position + current_character.height_ };
+
+		current_character.tex_coords_top_left = current_character.top_left.get_normalized(total_buffer_width, total_buffer_height);
+		current_character.tex_coords_top_right = current_character.top_right.get_normalized(total_buffer_width, total_buffer_height);
+		current_character.tex_coords_bottom_left = current_character.bottom_left.get_normalized(total_buffer_width, total_buffer_height);
+		current_character.tex_coords_bottom_right = current_character.bottom_right.get_normalized(total_buffer_width, total_buffer_height);
+	}
+
+	if (!blit_characters(placed_characters))
 	{
-		val.raw_bitmap_buffer.clear();
+		report_issue({ .phase = build_phase::atlas, .code = build_error::blit_failed });
+		return false;
 	}
+
+	content_hash_ = compute_content_hash();
+	return true;
+
 }
 #pragma endregion
 
-#pragma region free_atlas_buffer
-void text_to_texture_atlas::Font::free_atlas_buffer()
+#pragma region place_grid
+bool text_to_texture_atlas::Font::place_grid
+(
+	const std::pmr::vector<character*>& placed_characters,
+	unsigned int& atlas_width,
+	unsigned int& atlas_height
+) const
 {
-	main_atlas_.atlas_buffer.clear();
+	// The cells are sized by every loaded character, whitespace included.
+	auto rects{ get_placement_rects(placed_characters) };
+	if (!pack_grid(rects, get_max_character_width(), get_max_character_height(), atlas_width, atlas_height))
+	{
+		return false;
+	}
+	set_placement(placed_characters, rects);
+	return true;
 }
 #pragma endregion
 
-#pragma region get_character
-text_to_texture_atlas::Font::character& text_to_texture_atlas::Font::get_character
+#pragma region place_shelf
+bool text_to_texture_atlas::Font::place_shelf
 (
-	char character_
+	const std::pmr::vector<character*>& placed_characters,
+	unsigned int& atlas_width,
+	unsigned int& atlas_height
+) const
+{
+	auto rects{ get_placement_rects(placed_characters) };
+	if (!pack_shelf(rects, atlas_width, atlas_height))
+	{
+		return false;
+	}
+	set_placement(placed_characters, rects);
+	return true;
+}
+#pragma endregion
+
+#pragma region get_placement_rects
+std::pmr::vector<text_to_texture_atlas::atlas_rect> text_to_texture_atlas::Font::get_placement_rects
+(
+	const std::pmr::vector<character*>& placed_characters
+) const
+{
+	std::pmr::vector<atlas_rect> rects{ get_scratch_resource() };
+	rects.reserve(placed_characters.size());
+	for (const auto* current_character : placed_characters)
+	{
+		rects.push_back({ .width = current_character->width_, .height = current_character->height_ });
+	}
+	return rects;
+}
+#pragma endregion
+
+#pragma region set_placement
+void text_to_texture_atlas::Font::set_placement
+(
+	const std::pmr::vector<character*>& placed_characters,
+	const std::pmr::vector<atlas_rect>& rects
 )
 {
-	return character_map_[character_];
+	for (size_t i = 0; i < placed_characters.size(); i++)
+	{
+		placed_characters[i]->top_left = { .x = rects[i].x, .y = rects[i].y };
+	}
 }
 #pragma endregion
 
-#pragma region get_main_atlas
-text_to_texture_atlas::Font::atlas& text_to_texture_atlas::Font::get_main_atlas()
+#pragma region place_in_shared_atlas
+bool text_to_texture_atlas::Font::place_in_shared_atlas
+(
+	const std::pmr::vector<character*>& placed_characters
+)
 {
-	return main_atlas_;
+	Atlas& shared{ *options_.shared_atlas };
+	shared_slots_ = atlas_allocation{ &shared };
+	const unsigned int page_width{ shared.get_page_width() };
+	const unsigned int page_height{ shared.get_page_height() };
+
+	// The pixels live in the shared pages; the font's own atlas only records their size and format.
+	main_atlas_.atlas_buffer = std::pmr::vector<unsigned char>{ main_atlas_.atlas_buffer.get_allocator() };
+	main_atlas_.destination = {};
+	main_atlas_.width = page_width;
+	main_atlas_.height = page_height;
+	main_atlas_.channels = shared.get_channels();
+	main_atlas_.row_pitch = shared.get_row_pitch();
+
+	for (auto* current : placed_characters)
+	{
+		auto& current_character = *current;
+		atlas_slot slot{};
+		if (!shared_slots_.allocate(current_character.width_, current_character.height_, slot))
+		{
+			// Whatever was placed leaves the atlas again, so a failed font holds nothing.
+			shared_slots_.reset();
+			report_issue({ .phase = build_phase::atlas, .code = build_error::atlas_full });
+			return false;
+		}
+		if (!shared.write(slot, current_character.raw_bitmap_buffer, current_character.channels_))
+		{
+			shared_slots_.reset();
+			report_issue({ .phase = build_phase::atlas, .code = build_error::blit_failed });
+			return false;
+		}
+
+		const unsigned int x_position{ slot.rect.x };
+		const unsigned int y_position{ slot.rect.y };
+		current_character.page_ = slot.page;
+		current_character.top_left = { .x = x_position, .y = y_position };
+		current_character.top_right = { .x = x_position + current_character.width_, .y = y_position };
+		current_character.bottom_left = { .x = x_position, .y = y_position + current_character.height_ };
+		current_character.bottom_right = { .x = x_position + current_character.width_, .y = y_position + current_character.height_ };
+
+		current_character.tex_coords_top_left = current_character.top_left.get_normalized(page_width, page_height);
+		current_character.tex_coords_top_right = current_character.top_right.get_normalized(page_width, page_height);
+		current_character.tex_coords_bottom_left = current_character.bottom_left.get_normalized(page_width, page_height);
+		current_character.tex_coords_bottom_right = current_character.bottom_right.get_normalized(page_width, page_height);
+	}
+
+	content_hash_ = compute_content_hash();
+	return true;
 }
 #pragma endregion
 
-#pragma region init_main_atlas_buffer
-bool text_to_texture_atlas::Font::init_main_atlas_buffer()
+#pragma region blit_characters
+bool text_to_texture_atlas::Font::blit_characters
+(
+	const std::pmr::vector<character*>& placed_characters
+)
 {
+	const int character_channels{ static_cast<int>(main_atlas_.channels) };
+	const int atlas_buffer_channels{ static_cast<int>(main_atlas_.channels) };
+	const int character_stride = static_cast<int>(sizeof(unsigned char) * main_atlas_.channels);
+	const int atlas_buffer_stride = static_cast<int>(sizeof(unsigned char) * main_atlas_.channels);
+	constexpr unsigned int cache_line_size{ 64 };
+
+	const unsigned int atlas_width{ main_atlas_.width };
+	const unsigned int atlas_height{ main_atlas_.height };
+	unsigned char* const atlas_pixels{ main_atlas_.get_pixels() };
+	const size_t row_pitch{ main_atlas_.row_pitch };
+
+	// Rows are addressed through a blit width of whole pixels, so a padded pitch is the same as a wider atlas.
+	const unsigned int pitch_width{ static_cast<unsigned int>(row_pitch / main_atlas_.channels) };
+	const bool clear_rows{ !main_atlas_.destination.empty() };
+
+	unsigned int thread_count{ options_.blit_threads ? options_.blit_threads : std::thread::hardware_concurrency() };
+	thread_count = std::clamp(thread_count, 1u, std::max(atlas_height, 1u));
+
+	// Band edges are placed on rows that start a cache line, so the last row of one band and the
+	// first row of the next never share a line. Neither the atlas buffer nor a caller destination
+	// is guaranteed to be line-aligned, so those rows are found from the buffer's address; every
+	// `rows_per_cache_line`-th row from `first_aligned_row` starts a line. If none ever does, the
+	// bands still never write the same bytes, but neighbouring bands may share one line.
+	const unsigned int row_bytes{ atlas_width * main_atlas_.channels };
+	const unsigned int pitch_residue{ static_cast<unsigned int>(row_pitch % cache_line_size) };
+	const unsigned int rows_per_cache_line{ cache_line_size / std::gcd(row_pitch ? pitch_residue : 1u, cache_line_size) };
+	const auto base_residue{ static_cast<unsigned int>(reinterpret_cast<std::uintptr_t>(atlas_pixels) % cache_line_size) };
+	unsigned int first_aligned_row{};
+	while (first_aligned_row < rows_per_cache_line && (base_residue + first_aligned_row * pitch_residue) % cache_line_size != 0)
+	{
+		first_aligned_row++;
+	}
+	// Bands are laid out as if the atlas began `band_shift` rows earlier, so every edge lands on an aligned row.
+	const unsigned int band_shift{ first_aligned_row < rows_per_cache_line ? (rows_per_cache_line - first_aligned_row) % rows_per_cache_line : 0 };
+
+	// Bands must still cover the atlas with at most `thread_count` bands.
+	unsigned int band_height{ (atlas_height + band_shift + thread_count - 1) / thread_count };
+	band_height = (band_height + rows_per_cache_line - 1) / rows_per_cache_line * rows_per_cache_line;
+	const unsigned int band_count{ band_height ? (atlas_height + band_shift + band_height - 1) / band_height : 0 };
 
-	unsigned int max_character_height{ get_max_character_height() };
-	unsigned int max_character_width{ get_max_character_width() };
-	int character_range{ char_range_max - char_range_min };
-	unsigned int characters_per_w_and_h{static_cast<unsigned int>(std::ceil(sqrt(character_range)))};
-	unsigned int width_spacing = 5;
-	unsigned int height_spacing = 5;
-	double total_width_spacing = width_spacing * characters_per_w_and_h;
-	double total_height_spacing = height_spacing * characters_per_w_and_h;
+	using blit_result = decltype(texture_operations::SUCCESS);
+	std::vector<blit_result> band_results(band_count, texture_operations::SUCCESS);
+
+	// Each band copies only the rows of every character that fall inside it.
+	const auto blit_band = [&](const unsigned int band)
+	{
+		const unsigned int band_top{ band ? band * band_height - band_shift : 0 };
+		const unsigned int band_bottom{ std::min((band + 1) * band_height - band_shift, atlas_height) };
 
-	unsigned int initial_width_spacing = 5; // Where it should start. so it's not starting at (0,0)
-	unsigned int initial_height_spacing = 5;
+		// Caller memory may hold anything; each band clears its own rows (not the pitch padding) first.
+		if (clear_rows)
+		{
+			for (unsigned int y = band_top; y < band_bottom; y++)
+			{
+				std::memset(atlas_pixels + y * row_pitch, 0, row_bytes);
+			}
+		}
 
-	unsigned int total_buffer_width = static_cast<unsigned int>(characters_per_w_and_h * max_character_width + total_width_spacing + (initial_width_spacing * 2));
-	unsigned int total_buffer_height = static_cast<unsigned int>(characters_per_w_and_h * max_character_height + total_height_spacing + (initial_height_spacing * 2));
-	size_t total_buffer_size = static_cast<size_t>(total_buffer_width * total_buffer_height);
+		for (const auto* current_character : placed_characters)
+		{
+			const unsigned int character_top{ current_character->top_left.y };
+			const unsigned int character_bottom{ character_top + current_character->height_ };
+			const unsigned int first_row{ std::max(character_top, band_top) };
+			const unsigned int last_row{ std::min(character_bottom, band_bottom) };
+			if (first_row >= last_row)
+			{
+				continue;
+			}
 
-	unsigned int x_position{initial_width_spacing};
-	unsigned int y_position{initial_height_spacing};
+			const size_t source_offset{ static_cast<size_t>(first_row - character_top) * current_character->width_ * character_channels };
+			auto er = texture_operations::blit_texture
+			(
+				static_cast<int>(current_character->top_left.x),
+				static_cast<int>(first_row),
+				current_character->width_,
+				last_row - first_row,
+				character_channels,
+				static_cast<int>(pitch_width),
+				static_cast<int>(atlas_height),
+				atlas_buffer_channels,
+				current_character->raw_bitmap_buffer.data() + source_offset,
+				atlas_pixels,
+				character_stride,
+				atlas_buffer_stride
+			);
+
+			if (er != texture_operations::SUCCESS)
+			{
+				band_results[band] = er;
+				return;
+			}
+		}
+	};
 
-	int character_channels{ 4 };
-	int atlas_buffer_channels{ 4 };
-	int character_stride = sizeof(unsigned char) * 4;
-	int atlas_buffer_stride = sizeof(unsigned char) * 4;
+	{
+		// The calling thread takes the first band, the remaining bands each get a worker.
+		std::vector<std::jthread> workers{};
+		workers.reserve(band_count > 0 ? band_count - 1 : 0);
+		for (unsigned int band = 1; band < band_count; band++)
+		{
+			workers.emplace_back(blit_band, band);
+		}
+		if (band_count > 0)
+		{
+			blit_band(0);
+		}
+	}
 
-	unsigned int increment_x_size{ max_character_width + width_spacing };
-	unsigned int increment_y_size{ max_character_height + height_spacing };
+	for (const auto er : band_results)
+	{
+		if (er != texture_operations::SUCCESS)
+		{
+			return false;
+		}
+	}
 
+	return true;
+}
+#pragma endregion
 
-	main_atlas_.atlas_buffer = std::vector<unsigned char>(total_buffer_size * character_channels);
-	main_atlas_.width = total_buffer_width;
-	main_atlas_.height = total_buffer_height;
+#pragma region get_ordered_characters
+std::pmr::vector<std::pair<char32_t, text_to_texture_atlas::Font::character*>> text_to_texture_atlas::Font::get_ordered_characters()
+{
+	std::pmr::vector<std::pair<char32_t, character*>> ordered{ get_scratch_resource() };
+	ordered.reserve(character_map_.size());
+	for (auto& [key, value] : character_map_)
+	{
+		ordered.emplace_back(key, &value);
+	}
+
+	if (options_.order == placement_order::size)
+	{
+		std::ranges::sort(ordered, [](const auto& a, const auto& b)
+		{
+			if (a.second->height_ != b.second->height_) { return a.second->height_ > b.second->height_; }
+			if (a.second->width_ != b.second->width_) { return a.second->width_ > b.second->width_; }
+			return a.first < b.first;
+		});
+	}
+	else
+	{
+		std::ranges::sort(ordered, {}, &std::pair<char32_t, character*>::first);
+	}
+	return ordered;
+}
+#pragma endregion
+
+#pragma region compute_size_key
+std::uint64_t text_to_texture_atlas::Font::compute_size_key() const
+{
+	// The scaled metrics are what the outlines are actually scaled by, so point and pixel sizing
+	// that end up at the same scale share their glyphs.
+	const auto& metrics{ face_->size->metrics };
+	content_hasher hasher{};
+	hasher.update_value(metrics.x_ppem);
+	hasher.update_value(metrics.y_ppem);
+	hasher.update_value(static_cast<std::int64_t>(metrics.x_scale));
+	hasher.update_value(static_cast<std::int64_t>(metrics.y_scale));
+	// Every instance of a variable font has its own outlines; static fonts keep their existing keys.
+	for (const FT_Fixed coordinate : design_coordinates_)
+	{
+		hasher.update_value(static_cast<std::int64_t>(coordinate));
+	}
+	return hasher.digest();
+}
+#pragma endregion
+
+#pragma region compute_content_hash
+std::uint64_t text_to_texture_atlas::Font::compute_content_hash() const
+{
+	content_hasher hasher{};
+	hasher.update_value(main_atlas_.width);
+	hasher.update_value(main_atlas_.height);
+	hasher.update_value(main_atlas_.channels);
+	if (main_atlas_.has_pixels())
+	{
+		// Row by row, so padding in a caller's pitch never changes the hash.
+		const size_t row_bytes{ static_cast<size_t>(main_atlas_.width) * main_atlas_.channels };
+		for (unsigned int y = 0; y < main_atlas_.height; y++)
+		{
+			hasher.update(main_atlas_.get_pixels() + y * main_atlas_.row_pitch, row_bytes);
+		}
+	}
 
+	// Metrics are hashed in codepoint order, independent of the placement order and map layout.
+	std::pmr::vector<std::pair<char32_t, const character*>> sorted{ get_scratch_resource() };
+	sorted.reserve(character_map_.size());
+	for (const auto& [key, value] : character_map_)
+	{
+		sorted.emplace_back(key, &value);
+	}
+	std::ranges::sort(sorted, {}, &std::pair<char32_t, const character*>::first);
 
-	int index{};
-	for (auto& a : character_map_)
+	for (const auto& [codepoint, current_character] : sorted)
 	{
-		if (std::isspace(a.first))
+		hasher.update_value(static_cast<std::uint32_t>(codepoint));
+		hasher.update_value(current_character->width_);
+		hasher.update_value(current_character->height_);
+		hasher.update_value(current_character->x_bearing_);
+		hasher.update_value(current_character->y_bearing_);
+		hasher.update_value(current_character->advance_x_);
+		hasher.update_value(current_character->advance_y_);
+		if (options_.vertical_metrics)
 		{
-			continue;
+			hasher.update_value(current_character->vertical_x_bearing_);
+			hasher.update_value(current_character->vertical_y_bearing_);
+		}
+		if (options_.shared_atlas)
+		{
+			hasher.update_value(current_character->page_);
 		}
+		hasher.update_value(current_character->top_left.x);
+		hasher.update_value(current_character->top_left.y);
+	}
+	return hasher.digest();
+}
+#pragma endregion
 
+#pragma region fit_memory_budget
+bool text_to_texture_atlas::Font::fit_memory_budget()
+{
+	const auto& policy{ options_.memory };
+	if (!policy.limit && !policy.shared)
+	{
+		return true;
+	}
 
-		if (x_position + a.second.width_ > total_buffer_width)
+	size_t estimate{};
+	const auto fits = [&]
+	{
+		const unsigned int channels{ options_.format == atlas_format::r8 ? 1u : 4u };
+		estimate = estimate_build_bytes(options_.packer, channels);
+		return (!policy.limit || estimate <= policy.limit) && reservation_.resize(estimate);
+	};
+	// What can still be spent: the per-font limit, capped by what the shared budget has left.
+	const auto available = [&]
+	{
+		size_t bytes{ policy.limit ? policy.limit : std::numeric_limits<size_t>::max() };
+		if (policy.shared)
 		{
-			x_position = initial_width_spacing;
-			y_position += increment_y_size;
+			bytes = std::min(bytes, policy.shared->get_available() + reservation_.get_bytes());
 		}
+		return bytes;
+	};
 
-		
+	if (fits())
+	{
+		return true;
+	}
 
-		auto er = texture_operations::blit_texture
-		(
-			static_cast<int>(x_position),
-			static_cast<int>(y_position),
-			a.second.width_,
-			a.second.height_,
-			character_channels,
-			static_cast<int>(total_buffer_width),
-			static_cast<int>(total_buffer_height),
-			atlas_buffer_channels,
-			a.second.raw_bitmap_buffer.data(),
-			main_atlas_.atlas_buffer.data(),
-			character_stride,
-			atlas_buffer_stride
-		);
+	if (policy.allow_shelf_packer && options_.packer == atlas_packer::grid)
+	{
+		options_.packer = atlas_packer::shelf;
+		report_issue({ .phase = build_phase::memory_budget, .code = build_error::switched_to_shelf_packer, .severity = issue_severity::warning, .bytes = estimate });
+		if (fits())
+		{
+			return true;
+		}
+	}
 
-		if (er != texture_operations::SUCCESS)
+	// An outline packed into the red channel, or a sprite's colour, would be lost in R8.
+	const bool packs_channels{ options_.effects.outline > 0.0f && options_.effects.packing == effect_packing::channels };
+	const bool has_color_sprites{ std::ranges::any_of(options_.sprites, [](const atlas_sprite& sprite) { return sprite.channels == 4; }) };
+	if (policy.allow_r8 && options_.format == atlas_format::rgba8 && !packs_channels && !has_color_sprites)
+	{
+		options_.format = atlas_format::r8;
+		convert_characters_to_r8();
+		report_issue({ .phase = build_phase::memory_budget, .code = build_error::switched_to_r8, .severity = issue_severity::warning, .bytes = estimate });
+		if (fits())
 		{
-			unsigned char logbuffer[255];
-			texture_operations::get_info_log(er, logbuffer, 255);
-			std::cout << logbuffer << "\n";
+			return true;
+		}
+	}
 
-			error_ = true;
-			return false;
+	// Sprites have no outlines to render again, so a lower resolution would only shrink the glyphs around them.
+	if (policy.allow_lower_resolution && options_.sprites.empty())
+	{
+		// Memory scales with area, so the square root of the overshoot is the first guess. Glyph
+		// rounding and packing make that inexact, so a few more steps may follow.
+		constexpr int max_attempts{ 8 };
+		for (int attempt = 0; attempt < max_attempts && resolution_scale_ > policy.min_resolution_scale; attempt++)
+		{
+			const double ratio{ static_cast<double>(available()) / static_cast<double>(std::max<size_t>(estimate, 1)) };
+			const float scale{ std::max(policy.min_resolution_scale, static_cast<float>(resolution_scale_ * std::min(0.95, std::sqrt(ratio) * 0.97))) };
+			report_issue({ .phase = build_phase::memory_budget, .code = build_error::lowered_resolution, .severity = issue_severity::warning, .bytes = estimate });
+			if (!rebuild_at_scale(scale))
+			{
+				// A failed character map has already reported why.
+				if (!error_)
+				{
+					report_issue({ .phase = build_phase::memory_budget, .code = build_error::size_failed, .ft_error = ft_error_, .bytes = estimate });
+				}
+				return false;
+			}
+			if (fits())
+			{
+				return true;
+			}
 		}
+	}
 
-		auto& current_character = a.second;
+	report_issue({ .phase = build_phase::memory_budget, .code = build_error::budget_exceeded, .bytes = estimate });
+	return false;
+}
+#pragma endregion
 
-		// The X - Y position based on the buffer.
-		// Was * 4 on the width (but GPT told me it was wrong)
-		current_character.top_left = {.x = x_position, .y = y_position };
-		current_character.top_right = { .x = x_position + (a.second.width_), .y = y_position };
-		current_character.bottom_left = { .x = x_position, .y = y_position + a.second.height_ };
-		current_character.bottom_right = { .x = x_position + (a.second.width_), .y = y_position + a.second.height_ };
+#pragma region estimate_build_bytes
+size_t text_to_texture_atlas::Font::estimate_build_bytes
+(
+	const atlas_packer packer,
+	const unsigned int channels
+)
+{
+	size_t staging_pixels{};
+	std::pmr::vector<character*> placed_characters{ get_scratch_resource() };
+	placed_characters.reserve(character_map_.size());
+	for (auto& [codepoint, value] : get_ordered_characters())
+	{
+		staging_pixels += static_cast<size_t>(value->width_) * value->height_;
+		if (!is_space_codepoint(codepoint))
+		{
+			placed_characters.push_back(value);
+		}
+	}
 
-		current_character.tex_coords_top_left = current_character.top_left.get_normalized(total_buffer_width, total_buffer_height);
-		current_character.tex_coords_top_right = current_character.top_right.get_normalized(total_buffer_width, total_buffer_height);
-		current_character.tex_coords_bottom_left = current_character.bottom_left.get_normalized(total_buffer_width, total_buffer_height);
-		current_character.tex_coords_bottom_right = current_character.bottom_right.get_normalized(total_buffer_width, total_buffer_height);
+	// The placement is redone by `init_main_atlas_buffer`, so overwriting positions here is harmless.
+	unsigned int atlas_width{};
+	unsigned int atlas_height{};
+	const bool placed{ packer == atlas_packer::shelf
+		? place_shelf(placed_characters, atlas_width, atlas_height)
+		: place_grid(placed_characters, atlas_width, atlas_height) };
+	// A caller's destination or a shared atlas is not memory the font holds.
+	const size_t atlas_bytes{ placed && !options_.destination && !options_.shared_atlas ? static_cast<size_t>(atlas_width) * atlas_height * channels : 0 };
+
+	return atlas_bytes + staging_pixels * channels + get_character_map_bytes() + rasterizer_.get_memory_usage();
+}
+#pragma endregion
 
-		x_position += increment_x_size;
-		index++;
+#pragma region convert_characters_to_r8
+void text_to_texture_atlas::Font::convert_characters_to_r8()
+{
+	for (auto& value : character_map_ | std::views::values)
+	{
+		if (value.channels_ != 4)
+		{
+			continue;
+		}
+		const size_t pixels{ static_cast<size_t>(value.width_) * value.height_ };
+		std::pmr::vector<unsigned char> coverage(std::min(pixels, value.raw_bitmap_buffer.size() / 4), value.raw_bitmap_buffer.get_allocator());
+		for (size_t i = 0; i < coverage.size(); i++)
+		{
+			coverage[i] = value.raw_bitmap_buffer[i * 4 + 3];
+		}
+		value.raw_bitmap_buffer = std::move(coverage);
+		value.channels_ = 1;
 	}
+}
+#pragma endregion
 
+#pragma region rebuild_at_scale
+bool text_to_texture_atlas::Font::rebuild_at_scale(const float scale)
+{
+	resolution_scale_ = scale;
+	character_map_.clear();
+	return (pixel_sizing_ ? init_pixel_size() : init_char_size()) && init_character_map();
+}
+#pragma endregion
 
-	return true;
+#pragma region get_character_map_bytes
+size_t text_to_texture_atlas::Font::get_character_map_bytes() const
+{
+	// A node holds the key/value pair, the next pointer and the cached hash.
+	constexpr size_t node_bytes{ sizeof(std::pair<const char32_t, character>) + sizeof(void*) + sizeof(size_t) };
+	constexpr size_t record_node_bytes{ sizeof(std::pair<const char32_t, glyph_record>) + sizeof(void*) + sizeof(size_t) };
+	return character_map_.size() * node_bytes + character_map_.bucket_count() * sizeof(void*)
+		+ extended_records_.size() * record_node_bytes + extended_records_.bucket_count() * sizeof(void*);
+}
+#pragma endregion
 
+#pragma region update_reservation
+void text_to_texture_atlas::Font::update_reservation()
+{
+	// Growing can only fail if buffers grew after the build, which they never do; keep the old reservation then.
+	reservation_.resize(get_memory_report().total());
+}
+#pragma endregion
+
+#pragma region get_memory_report
+text_to_texture_atlas::memory_report text_to_texture_atlas::Font::get_memory_report() const
+{
+	memory_report report{};
+	report.atlas_bytes = main_atlas_.atlas_buffer.capacity();
+	for (const auto& value : character_map_ | std::views::values)
+	{
+		report.staging_bytes += value.raw_bitmap_buffer.capacity();
+	}
+	report.character_map_bytes = get_character_map_bytes();
+	report.scratch_bytes = rasterizer_.get_memory_usage();
+	return report;
 }
-#pragma endregion
\ No newline at end of file
+#pragma endregion
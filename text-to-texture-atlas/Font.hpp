@@ -1,11 +1,27 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <freetype/freetype.h>
+#include <freetype/ftstroke.h>
 #include FT_FREETYPE_H
 
+#include "Atlas.hpp"
+#include "GlyphCache.hpp"
+#include "GlyphPack.hpp"
+#include "MemoryBudget.hpp"
+#include "Packers.hpp"
+#include "Rasterizer.hpp"
+
 /**
  * @mainpage
  *
@@ -15,6 +31,554 @@
  */
 namespace text_to_texture_atlas
 {
+	/**
+	 * @brief
+	 * Selects the order in which characters are placed into the atlas.
+	 *
+	 * @details
+	 * Both orders are fully deterministic, so the same font, size and options always produce
+	 * a bit-identical atlas regardless of hash map iteration order or thread count.
+	 */
+	enum class placement_order
+	{
+		codepoint,	///< Ascending codepoint.
+		size		///< Tallest first, then widest first, ties broken by ascending codepoint.
+	};
+
+	/**
+	 * @brief
+	 * Selects the pixel layout of the atlas buffer.
+	 */
+	enum class atlas_format
+	{
+		rgba8,	///< Four channels per pixel, coverage in alpha and zero colour (the original layout).
+		r8		///< One coverage channel per pixel, a quarter of the memory of `rgba8`.
+	};
+
+	/**
+	 * @brief
+	 * Selects the algorithm that places characters inside the atlas.
+	 */
+	enum class atlas_packer
+	{
+		grid,	///< A square grid of equally sized cells, each as large as the largest character.
+		shelf	///< Rows ("shelves") filled left to right; tightest when combined with `placement_order::size`.
+	};
+
+	/**
+	 * @brief
+	 * Selects how a glyph's outline effect is stored in the atlas.
+	 */
+	enum class effect_packing
+	{
+		channels,	///< One RGBA character per codepoint: fill coverage in alpha, outline coverage in red (needs `atlas_format::rgba8`).
+		variants	///< Separate characters: the fill at the codepoint, the outline at `outline_variant(codepoint)`.
+	};
+
+	/**
+	 * @brief
+	 * Synthetic styles applied to every glyph outline before it is rasterized.
+	 *
+	 * @details
+	 * Sizes are in requested pixels. Emboldening and slanting change the glyph itself; the
+	 * outline is stroked around the result, so one build yields bold, italic and outlined text
+	 * from a regular face. Bitmap-only glyphs are rendered without effects.
+	 *
+	 * With `effect_packing::channels` a shader draws outlined text in a single pass:
+	 *
+	 * @code
+	 * vec4 texel = texture(atlas, uv);
+	 * vec4 color = mix(vec4(outline_color, texel.r), vec4(fill_color, 1.0), texel.a);
+	 * @endcode
+	 */
+	struct glyph_effects
+	{
+		float embolden{ 0.0f };		///< Pixels every stroke is thickened by (`FT_Outline_EmboldenXY`); the advances grow by the same amount.
+		float oblique{ 0.0f };		///< Horizontal shear per pixel of height, e.g. 0.2 for a synthetic italic.
+		float outline{ 0.0f };		///< Width in pixels of a border around the glyph, stroked with `FT_Stroker` (0 = none).
+		effect_packing packing{ effect_packing::channels };	///< How the outline is stored.
+
+		/// Returns true if any effect changes the glyphs.
+		inline bool is_active() const { return embolden != 0.0f || oblique != 0.0f || outline > 0.0f; }
+	};
+
+	/// The bit that marks a character key as the outline variant of a codepoint.
+	constexpr char32_t outline_variant_bit{ 0x40000000 };
+
+	/**
+	 * @brief Returns the key the outline of `codepoint` is stored under with `effect_packing::variants`.
+	 */
+	constexpr char32_t outline_variant(const char32_t codepoint) { return codepoint | outline_variant_bit; }
+
+	/// The bit that marks a character key as a sprite rather than a codepoint.
+	constexpr char32_t sprite_bit{ 0x20000000 };
+
+	/**
+	 * @brief Returns the key a sprite is stored under in the character map, e.g. for `Font::find_character`.
+	 */
+	constexpr char32_t sprite_key(const std::uint32_t id) { return static_cast<char32_t>(id) | sprite_bit; }
+
+	/**
+	 * @brief
+	 * An image packed into a font's atlas next to its glyphs, such as an icon drawn inline with text.
+	 *
+	 * @details Metrics are in pixels like a glyph's, so a sprite can be laid out as one: with
+	 * `bearing_y = height` it stands on the baseline, with `bearing_y = ascender` it hangs from
+	 * the top of the line.
+	 */
+	struct atlas_sprite
+	{
+		std::uint32_t id{};							///< The caller's id, below `sprite_bit`. Must be unique within the font.
+		unsigned int width{};						///< Width in pixels.
+		unsigned int height{};						///< Height in pixels.
+		unsigned int channels{ 4 };					///< 4 for RGBA8 pixels, 1 for grayscale coverage like a glyph's.
+		std::span<const unsigned char> pixels{};	///< The pixels, top row first. Must stay valid until the font is built.
+		std::size_t row_pitch{};					///< Bytes from one row to the next (0 = `width * channels`).
+		int bearing_x{};							///< Horizontal distance from the pen position to the left edge.
+		int bearing_y{};							///< Vertical distance from the baseline to the top edge.
+		int advance{};								///< Horizontal pen advance in pixels (0 = `width`).
+	};
+
+	/**
+	 * @brief
+	 * A position on one design axis of a variable font, such as `{ axis_tag("wght"), 650.0f }`.
+	 */
+	struct variation_coordinate
+	{
+		/// The axis's four-character OpenType tag, from `axis_tag`.
+		std::uint32_t tag{};
+		/// The position in the axis's design units (e.g. 100-900 for `wght`).
+		float value{};
+	};
+
+	/**
+	 * @brief Packs a four-character OpenType axis tag such as `"wght"` or `"wdth"` into its numeric form.
+	 */
+	constexpr std::uint32_t axis_tag(const char (&name)[5])
+	{
+		return static_cast<std::uint32_t>(static_cast<unsigned char>(name[0])) << 24
+			| static_cast<std::uint32_t>(static_cast<unsigned char>(name[1])) << 16
+			| static_cast<std::uint32_t>(static_cast<unsigned char>(name[2])) << 8
+			| static_cast<std::uint32_t>(static_cast<unsigned char>(name[3]));
+	}
+
+	/**
+	 * @brief
+	 * Selects the direction `Font::layout_text` advances the pen in.
+	 */
+	enum class text_direction
+	{
+		horizontal,	///< Left to right along a baseline, using the horizontal metrics.
+		vertical	///< Top to bottom down a centre line, using the vertical metrics (needs `build_options::vertical_metrics`).
+	};
+
+	/**
+	 * @brief
+	 * One positioned glyph produced by `Font::layout_text`: a screen rectangle and the atlas
+	 * rectangle to sample.
+	 *
+	 * @details Positions are in the same y-down space as the pen, scaled by
+	 * `1 / Font::get_resolution_scale()`, so they are in requested pixels.
+	 */
+	struct glyph_quad
+	{
+		char32_t codepoint{};	///< The character drawn.
+		float x0{};				///< Left edge.
+		float y0{};				///< Top edge.
+		float x1{};				///< Right edge.
+		float y1{};				///< Bottom edge.
+		float u0{};				///< Left texture coordinate.
+		float v0{};				///< Top texture coordinate.
+		float u1{};				///< Right texture coordinate.
+		float v1{};				///< Bottom texture coordinate.
+		unsigned int page{};	///< The `build_options::shared_atlas` page to sample; 0 for a font's own atlas.
+	};
+
+	/**
+	 * @brief
+	 * A compact, read-only copy of what drawing one glyph needs, for the ASCII fast path.
+	 *
+	 * @details Metrics are in rendered pixels like `Font::character`'s. Lookups of glyphs that
+	 * were not loaded return a sentinel record with `loaded == false` and zero size and advance,
+	 * so a text loop can draw it unconditionally.
+	 */
+	struct glyph_record
+	{
+		float u0{};					///< Left texture coordinate.
+		float v0{};					///< Top texture coordinate.
+		float u1{};					///< Right texture coordinate.
+		float v1{};					///< Bottom texture coordinate.
+		std::int32_t advance_x{};	///< Horizontal pen advance (in 1/64 pixels).
+		std::int16_t bearing_x{};	///< Horizontal distance from the pen position to the left edge.
+		std::int16_t bearing_y{};	///< Vertical distance from the baseline to the top edge.
+		std::uint16_t width{};		///< Width of the bitmap in pixels.
+		std::uint16_t height{};		///< Height of the bitmap in pixels.
+		std::uint8_t page{};		///< The `build_options::shared_atlas` page holding the glyph; 0 for a font's own atlas.
+		bool loaded{};				///< False for the sentinel returned for missing glyphs.
+	};
+	static_assert(sizeof(glyph_record) <= 32, "glyph_record should stay within half a cache line");
+
+	/**
+	 * @brief
+	 * A codepoint `Font::lookup_utf8()` found no glyph for, and where its sentinel record was written.
+	 */
+	struct glyph_miss
+	{
+		std::size_t index{};		///< The index of the sentinel in the `records` vector passed to `lookup_utf8()`.
+		char32_t codepoint{};		///< The decoded codepoint; U+FFFD for a malformed UTF-8 sequence.
+	};
+
+	/**
+	 * @brief
+	 * An inclusive range of Unicode codepoints, e.g. `{ 32, 126 }` for printable ASCII.
+	 */
+	struct codepoint_range
+	{
+		/// The first codepoint in the range.
+		char32_t first{};
+		/// The last codepoint in the range (inclusive).
+		char32_t last{};
+	};
+
+	/**
+	 * @brief
+	 * Limits how much memory a `Font` may hold, and how it may degrade to stay under the limit.
+	 *
+	 * @details
+	 * Before the atlas is allocated, the font estimates its peak (atlas, staging buffers and
+	 * character map). If that exceeds `limit` or what is left of `shared`, it applies the allowed
+	 * degradations in order until the estimate fits:
+	 *
+	 * 1. `allow_shelf_packer`: switch from the grid packer to the tighter shelf packer (lossless).
+	 * 2. `allow_r8`: switch from RGBA8 to R8, a quarter of the memory (the caller must upload a single-channel texture).
+	 * 3. `allow_lower_resolution`: re-render at a smaller size, down to `min_resolution_scale`.
+	 *    `Font::get_resolution_scale()` tells the renderer how much to scale quads and metrics up.
+	 *
+	 * If nothing fits, construction fails. `Font::get_build_options()` reports the format and
+	 * packer that were actually used.
+	 */
+	struct memory_policy
+	{
+		/// The most bytes this font may hold (0 = no per-font limit).
+		std::size_t limit{ 0 };
+
+		/// A budget shared with other fonts (null = none). The font keeps a reservation on it while alive.
+		memory_budget* shared{ nullptr };
+
+		/// Allow switching the grid packer to the shelf packer.
+		bool allow_shelf_packer{ true };
+
+		/// Allow switching an RGBA8 atlas to R8.
+		bool allow_r8{ true };
+
+		/// Allow rendering at a lower resolution.
+		bool allow_lower_resolution{ true };
+
+		/// The smallest resolution scale lower resolution may go down to.
+		float min_resolution_scale{ 0.25f };
+	};
+
+	/**
+	 * @brief
+	 * The bytes a `Font` currently holds, by category.
+	 */
+	struct memory_report
+	{
+		std::size_t atlas_bytes{};			///< The atlas buffer.
+		std::size_t staging_bytes{};		///< Every character's `raw_bitmap_buffer`.
+		std::size_t character_map_bytes{};	///< An estimate of the character and glyph record maps' nodes and buckets.
+		std::size_t scratch_bytes{};		///< The built-in rasterizer's scratch buffers.
+
+		/// Returns the sum of every category.
+		inline std::size_t total() const { return atlas_bytes + staging_bytes + character_map_bytes + scratch_bytes; }
+	};
+
+	/**
+	 * @brief
+	 * Caller-owned memory the atlas is written into directly, such as a mapped pixel buffer
+	 * object, a staging buffer, shared memory or a memory-mapped file.
+	 */
+	struct atlas_destination
+	{
+		unsigned char* data{ nullptr };	///< The first byte of the top row.
+		std::size_t size{};				///< The writable bytes from `data`.
+		std::size_t row_pitch{};		///< The bytes from one row to the next (0 = `width * channels`). Must be a multiple of the channel count.
+	};
+
+	/**
+	 * @brief
+	 * Called once the atlas size is known to get the memory to write it into.
+	 *
+	 * @details Receives the atlas width and height in pixels and its channel count, and returns
+	 * at least `(height - 1) * row_pitch + width * channels` writable bytes, or an empty
+	 * destination to fail the build.
+	 */
+	using atlas_destination_provider = std::function<atlas_destination(unsigned int width, unsigned int height, unsigned int channels)>;
+
+	/**
+	 * @brief
+	 * The step of a `Font` build a `build_issue` was raised in.
+	 */
+	enum class build_phase
+	{
+		library,		///< Initializing FreeType.
+		face,			///< Opening the font file.
+		variation,		///< Applying `build_options::variation`.
+		size,			///< Setting the character size.
+		characters,		///< Loading and rendering the charset's glyphs.
+		memory_budget,	///< Fitting the build into `build_options::memory`.
+		atlas			///< Placing and copying the glyphs into the atlas.
+	};
+
+	/**
+	 * @brief
+	 * What a `build_issue` reports. `describe()` turns it into a readable message.
+	 */
+	enum class build_error
+	{
+		library_failed,				///< FreeType could not be initialized.
+		face_failed,				///< The font file could not be opened or read.
+		variation_failed,			///< The font is not variable, has no such axis, or rejected the coordinates.
+		size_failed,				///< The font rejected the character size.
+		stroker_failed,				///< The outline effect's stroker could not be created.
+		outline_needs_rgba,			///< An outline packed into channels needs an RGBA8 atlas.
+		glyph_load_failed,			///< A glyph could not be loaded; it is skipped.
+		glyph_render_failed,		///< A glyph (or one of its effect layers) could not be rendered; it is skipped.
+		bitmap_conversion_failed,	///< A rendered glyph could not be converted to the atlas format.
+		sprite_invalid,				///< A sprite has a duplicate or too large id, no size, an unsupported channel count or too few pixels.
+		switched_to_shelf_packer,	///< The build was over budget and switched to the shelf packer.
+		switched_to_r8,				///< The build was over budget and switched to R8.
+		lowered_resolution,			///< The build was over budget and is rendered at a lower resolution.
+		budget_exceeded,			///< The build does not fit the memory budget, even degraded.
+		placement_failed,			///< The characters could not be placed in the atlas.
+		destination_invalid,		///< `build_options::destination` returned memory that is missing, too small or misaligned.
+		blit_failed,				///< Copying the glyphs into the atlas failed.
+		atlas_full					///< `build_options::shared_atlas` has no room left for a glyph.
+	};
+
+	/**
+	 * @brief
+	 * Whether a `build_issue` failed the build.
+	 */
+	enum class issue_severity
+	{
+		error,		///< The build failed; the font converts to false.
+		warning		///< The build went on without a glyph, or degraded to fit its budget.
+	};
+
+	/**
+	 * @brief
+	 * One problem met while building a `Font`, in place of a console message.
+	 *
+	 * @details Issues are plain values with no strings attached, so reporting one never
+	 * allocates or does I/O; `describe()` formats one on demand.
+	 */
+	struct build_issue
+	{
+		build_phase phase{};								///< The step the issue was raised in.
+		build_error code{};									///< What went wrong.
+		issue_severity severity{ issue_severity::error };	///< Whether the build failed.
+		FT_Error ft_error{};								///< The FreeType error behind the issue, or 0.
+		char32_t codepoint{};								///< The character concerned, if `has_codepoint`.
+		bool has_codepoint{};								///< Whether the issue concerns one character.
+		std::size_t bytes{};								///< For memory budget issues, the estimated build size in bytes.
+	};
+
+	/**
+	 * @brief
+	 * Formats a `build_issue` as a one-line message, e.g. `characters: glyph U+00E9 could not be
+	 * rendered (FreeType error 0x14)`.
+	 */
+	std::string describe(const build_issue& issue);
+
+	/**
+	 * @brief
+	 * Called with every `build_issue` as it is raised, on the thread building the font.
+	 */
+	using build_issue_handler = std::function<void(const build_issue& issue)>;
+
+	/**
+	 * @brief
+	 * Optional settings that control how a `Font` builds its characters and atlas.
+	 *
+	 * @details
+	 * Every field has a default that reproduces the original behaviour, so callers only
+	 * need to set the fields they care about.
+	 *
+	 * @code
+	 * text_to_texture_atlas::build_options options{};
+	 * options.rasterizer = text_to_texture_atlas::rasterizer_backend::scanline;
+	 *
+	 * auto font = text_to_texture_atlas::Font::Font_Px("arial.ttf", 600, 0, options);
+	 * @endcode
+	 */
+	struct build_options
+	{
+		/// The rasterizer used to turn glyph outlines into coverage. Bitmap-only glyphs always use FreeType.
+		rasterizer_backend rasterizer{ rasterizer_backend::freetype };
+
+		/**
+		 * @brief The number of threads that copy glyphs into the atlas (0 = one per hardware thread).
+		 *
+		 * @details The atlas is split into horizontal row bands, one per thread, so no two threads
+		 * ever write the same row. Band edges fall on rows that start a cache line whenever the
+		 * buffer's address and row pitch allow it, so bands do not share lines either. The result
+		 * is bit-identical for any thread count.
+		 */
+		unsigned int blit_threads{ 0 };
+
+		/// The order characters are placed into the atlas in.
+		placement_order order{ placement_order::codepoint };
+
+		/// The algorithm that places characters inside the atlas.
+		atlas_packer packer{ atlas_packer::grid };
+
+		/// The pixel layout of the atlas buffer and of every `raw_bitmap_buffer`.
+		atlas_format format{ atlas_format::rgba8 };
+
+		/// The codepoints to load. Codepoints the font has no glyph for are skipped.
+		std::vector<codepoint_range> charset{ { 32, 126 } };
+
+		/// The directory relative font names are resolved against. Absolute font paths are used as-is.
+		std::string font_directory{ "C:/Windows/Fonts/" };
+
+		/**
+		 * @brief An optional cache of rasterized glyphs shared between builds (null = no caching).
+		 *
+		 * @details Glyphs found in the cache are neither loaded nor rendered; glyphs that are not
+		 * are rendered and added to it. The cache is keyed by the font file contents, so it is
+		 * safe to keep across edits to the font file. It must outlive the build.
+		 */
+		glyph_cache* cache{ nullptr };
+
+		/**
+		 * @brief An optional on-disk glyph pack shared between processes and runs (null = none).
+		 *
+		 * @details Consulted after `cache` and before rendering; rendered glyphs are appended to it.
+		 * It must be open and outlive the build.
+		 */
+		glyph_pack* pack{ nullptr };
+
+		/// Memory limits and the degradations allowed to meet them. No limit by default.
+		memory_policy memory{};
+
+		/**
+		 * @brief Release every character's staging bitmap and the rasterizer's scratch buffers as
+		 * soon as the atlas is built.
+		 *
+		 * @details The staging bitmaps are a second copy of every glyph, as large as the packed
+		 * glyphs themselves, and are only needed while the atlas is being blitted. Set this to
+		 * false to keep them, e.g. to inspect `raw_bitmap_buffer` while debugging.
+		 */
+		bool release_staging{ true };
+
+		/**
+		 * @brief The memory resource for everything the font keeps: the atlas buffer and the
+		 * character map (null = `std::pmr::get_default_resource()`).
+		 *
+		 * @details Point it at huge pages or pinned upload memory so the atlas can be uploaded
+		 * without another copy, or at a tracked arena to account for it. It must outlive the font.
+		 */
+		std::pmr::memory_resource* resource{ nullptr };
+
+		/**
+		 * @brief The memory resource for build scratch: the staging bitmaps, the rasterizer's
+		 * buffers and the placement lists (null = `resource`).
+		 *
+		 * @details Everything allocated from it is freed by the end of construction when
+		 * `release_staging` is set, so a `std::pmr::monotonic_buffer_resource` can be reset as
+		 * soon as the font is built. It must outlive the font's construction, or the font itself
+		 * when `release_staging` is false.
+		 */
+		std::pmr::memory_resource* scratch_resource{ nullptr };
+
+		/**
+		 * @brief Writes the atlas straight into caller-owned memory instead of `atlas_buffer`
+		 * (empty = the font allocates `atlas_buffer`).
+		 *
+		 * @details Glyphs are blitted into the returned memory, which is zeroed first, so an upload
+		 * buffer can be filled without an intermediate copy. `atlas_buffer` stays empty and
+		 * `atlas::destination` points at the memory, which must outlive the font's use of it.
+		 *
+		 * @code
+		 * options.destination = [&](unsigned int width, unsigned int height, unsigned int channels) {
+		 *     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+		 *     glBufferData(GL_PIXEL_UNPACK_BUFFER, width * height * channels, nullptr, GL_STREAM_DRAW);
+		 *     auto* data = static_cast<unsigned char*>(glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY));
+		 *     return text_to_texture_atlas::atlas_destination{ data, std::size_t{ width } * height * channels };
+		 * };
+		 * @endcode
+		 */
+		atlas_destination_provider destination{};
+
+		/**
+		 * @brief Places the glyphs in an atlas shared with other fonts instead of the font's own
+		 * (null = the font builds its own atlas).
+		 *
+		 * @details Every glyph reserves a slot in the `Atlas` and is copied into it, converted to
+		 * the atlas's channels if the formats differ. The font keeps only the mapping:
+		 * `character::page_`, `top_left` and texture coordinates relative to the page. The atlas
+		 * holds the pixels, so `get_main_atlas()` has none and `destination` is not used. The
+		 * slots are released when the font is destroyed; the atlas must outlive it.
+		 */
+		Atlas* shared_atlas{ nullptr };
+
+		/**
+		 * @brief Also store every character's vertical metrics, for vertical text such as CJK.
+		 *
+		 * @details Fills `advance_y_` with the vertical advance and sets `vertical_x_bearing_` and
+		 * `vertical_y_bearing_`, so `layout_text` can lay text out in columns. The bitmaps are the
+		 * same in both directions, so one atlas serves horizontal and vertical text. Fonts without
+		 * vertical metrics get FreeType's synthesized ones (centred, a line height apart).
+		 */
+		bool vertical_metrics{ false };
+
+		/**
+		 * @brief Design-axis coordinates for a variable font, e.g. `{ { axis_tag("wght"), 650.0f } }`
+		 * (empty = the font's default instance).
+		 *
+		 * @details Applied with `FT_Set_Var_Design_Coordinates` before any glyph is loaded. Axes
+		 * that are not listed keep their default, and values are clamped to the axis's range.
+		 * Construction fails if the font is not a variable font or has no such axis. Glyph cache
+		 * and pack keys include the instance, so instances never share stale glyphs.
+		 *
+		 * @see variable_font to build and cache atlases for many instances.
+		 */
+		std::vector<variation_coordinate> variation{};
+
+		/// Synthetic bold, italic and outline effects baked into the glyphs (none by default).
+		glyph_effects effects{};
+
+		/**
+		 * @brief Called with every issue as it is raised (empty = issues are only collected).
+		 *
+		 * @details The font itself never writes to the console: every issue is also kept in
+		 * `Font::get_issues()`. The handler runs on the building thread, so fonts built
+		 * concurrently each call it from their own thread.
+		 *
+		 * @code
+		 * options.on_issue = [&](const text_to_texture_atlas::build_issue& issue) {
+		 *     my_logger.log(issue.severity == text_to_texture_atlas::issue_severity::error, text_to_texture_atlas::describe(issue));
+		 * };
+		 * @endcode
+		 */
+		build_issue_handler on_issue{};
+
+		/**
+		 * @brief Images packed into the atlas together with the glyphs (none by default).
+		 *
+		 * @details Each sprite becomes a character under `sprite_key(id)`, so it is placed, copied
+		 * and hashed exactly like a glyph and found with `Font::find_sprite`. Text and icons then
+		 * draw from one texture in one batch. RGBA sprites keep their colour in an RGBA8 atlas;
+		 * in an R8 atlas only their alpha is kept. Grayscale sprites are stored like glyph
+		 * coverage. A large sprite makes every grid cell as large, so prefer `atlas_packer::shelf`.
+		 *
+		 * @note A font with sprites is never rendered at a lower resolution to fit its memory
+		 * budget, and one with RGBA sprites never falls back to R8, as either would change the sprites.
+		 */
+		std::vector<atlas_sprite> sprites{};
+	};
+
 	/**
 	 *
 	 * @brief
@@ -52,7 +616,7 @@ namespace text_to_texture_atlas
 	 * auto atlas_height = font.main_atlas_.height;			// The height of the atlas.
 	 *
 	 * auto char_a = arial.get_character('a');
-	 * 	char_a.output_raw();				 // Outputs a raw representation to the terminal.
+	 * 	char_a.output_raw(arial.get_main_atlas());	 // Outputs a raw representation to the terminal.
 	 *	char_a.output_buffer_positions();	 // Outputs the characters buffer position relative to the atlas.
 	 *  char_a.output_texture_coordinates(); // Outputs the characters texture coordinates relative to the atlas.
 	 *
@@ -68,6 +632,8 @@ namespace text_to_texture_atlas
 	class Font
 	{
 		#pragma region internal
+		struct atlas;
+
 		/**
 		 * @brief
 		 * Holds all rendering metrics and positioning data for a single character.
@@ -147,10 +713,18 @@ namespace text_to_texture_atlas
 			/// The horizontal distance to advance the cursor for the next character. (in 1/64 pixels)
 			int advance_x_{};
 			/// The vertical distance to advance the cursor (for vertical layouts). (in 1/64 pixels)
+			/// 0 unless the font was built with `build_options::vertical_metrics`.
 			int advance_y_{};
 
+			/// The horizontal distance from the vertical cursor's origin (the glyph's centre line) to the left edge of the bitmap.
+			int vertical_x_bearing_{};
+			/// The distance down from the vertical cursor's origin to the top edge of the bitmap.
+			int vertical_y_bearing_{};
+
 			//--- Atlas Positioning ---//
 
+			/// The page of `build_options::shared_atlas` holding the character; 0 for the font's own atlas.
+			unsigned int page_{};
 			/// The top-left pixel coordinate of the character within the main atlas texture.
 			vector2 top_left{};
 			/// The top-right pixel coordinate of the character within the main atlas texture.
@@ -175,13 +749,16 @@ namespace text_to_texture_atlas
 
 			/**
 			 * @brief
-			 * The raw 4-channel (RGBA) bitmap data for this character.
+			 * The raw bitmap data for this character, in the atlas format (RGBA or R8).
 			 * 
 			 * @note
-			 * This buffer is temporary and is used to build the main atlas. It can be cleared
-			 * by calling `Font::free_character_buffers()` to save memory after the atlas is created.
+			 * This buffer is temporary and is used to build the main atlas. It is released once the
+			 * atlas is built unless `build_options::release_staging` is false, in which case it can
+			 * be released later with `Font::free_character_buffers()`.
 			 */
-			std::vector<unsigned char> raw_bitmap_buffer{};
+			std::pmr::vector<unsigned char> raw_bitmap_buffer{};
+			/// The number of channels per pixel in `raw_bitmap_buffer` (4 for RGBA, 1 for R8).
+			unsigned int channels_{ 4 };
 
 			//--- Debug Methods ---//
 
@@ -209,13 +786,16 @@ namespace text_to_texture_atlas
 
 			/**
 			 * @brief
-			 * Prints a visual representation of the character's raw bitmap to the console.
+			 * Prints a visual representation of the character's pixels to the console, read from
+			 * its rect in the atlas.
+			 *
+			 * @param source The atlas the character was placed in, from `Font::get_main_atlas()`.
 			 * 
 			 * @warning
-			 * This function will produce no output if the buffer has been cleared by
-			 * `Font::free_character_buffers()`.
+			 * This function will produce no output if the atlas has been cleared by
+			 * `Font::free_atlas_buffer()`.
 			 */
-			void output_raw() const;
+			void output_raw(const atlas& source) const;
 		};
 		/**
 		 * @brief
@@ -234,31 +814,65 @@ namespace text_to_texture_atlas
 			 * The raw pixel data for the entire texture atlas.
 			 *
 			 * @details
-			 * This buffer contains a tightly packed, 4-channel (RGBA) bitmap. The alpha
-			 * channel represents the glyph's shape and antialiasing. The data can be
-			 * passed directly to graphics APIs like OpenGL's `glTexImage2D`.
+			 * This buffer contains a tightly packed, 4-channel (RGBA) bitmap by default. The alpha
+			 * channel represents the glyph's shape and antialiasing. With `atlas_format::r8` it
+			 * holds a single coverage channel instead. The data can be passed directly to graphics
+			 * APIs like OpenGL's `glTexImage2D`. It is allocated from `build_options::resource`.
+			 *
+			 * @note Empty when the atlas was written into `build_options::destination`.
 			 */
-			std::vector<unsigned char> atlas_buffer{};
+			std::pmr::vector<unsigned char> atlas_buffer{};
+
+			/// The caller-owned memory the atlas was written into, or empty when it is in `atlas_buffer`.
+			std::span<unsigned char> destination{};
+			/// The bytes from one row to the next: `width * channels` unless the destination chose a larger pitch.
+			std::size_t row_pitch{};
 
 			/// The total width of the atlas texture in pixels.
 			unsigned int width{};
 			/// The total height of the atlas texture in pixels.
 			unsigned int height{};
+			/// The number of channels per pixel (4 for RGBA, 1 for R8).
+			unsigned int channels{ 4 };
+
+			/// Returns the first byte of the top row, in `destination` or `atlas_buffer`.
+			inline unsigned char* get_pixels() { return destination.empty() ? atlas_buffer.data() : destination.data(); }
+			/// Returns the first byte of the top row, in `destination` or `atlas_buffer`.
+			inline const unsigned char* get_pixels() const { return destination.empty() ? atlas_buffer.data() : destination.data(); }
+			/// Returns true if the atlas holds pixels (it was built and not freed).
+			inline bool has_pixels() const { return !destination.empty() || !atlas_buffer.empty(); }
 		};
 		#pragma endregion
 
+		// Freetype object ownership
+		struct library_deleter { void operator()(FT_Library library) const { FT_Done_FreeType(library); } };
+		struct face_deleter { void operator()(FT_Face face) const { FT_Done_Face(face); } };
+
 		// Freetype objects
-		FT_Library library_{};	// Freetype library.
-		FT_Face face_{};		// Font face object.
+		std::unique_ptr<FT_LibraryRec_, library_deleter> library_{};	// Freetype library.
+		std::unique_ptr<FT_FaceRec_, face_deleter> face_{};			// Font face object, released before the library.
 		FT_Error ft_error_{};	// Last freetype error code.
 		bool error_{};			// For capturing any errors during construction.
+		std::vector<build_issue> issues_{};	// Every issue raised while building, in order.
+
+		// Build configuration
+		build_options options_{};	// The options the font was created with.
+		Rasterizer rasterizer_{};	// The built-in rasterizer, used when `options_.rasterizer` is `scanline`.
 
 		// Character and atlas storage
-		std::unordered_map<char, character> character_map_{};	// Holds each character and it's relative character data.
+		std::pmr::unordered_map<char32_t, character> character_map_{};	// Holds each character (by codepoint) and it's relative character data.
 		atlas main_atlas_{};									// Holds the main atlas for the specified font.
+		std::uint64_t content_hash_{};							// Hash of the atlas pixels and character metrics, set once the atlas is built.
+		budget_reservation reservation_{};						// This font's reservation on `options_.memory.shared`.
+		float resolution_scale_{ 1.0f };						// The size actually rendered, relative to the requested size.
+		std::uint64_t face_key_{};								// Hash of the font file, the face part of every `glyph_key` (set only with a cache or pack).
+		std::vector<FT_Fixed> design_coordinates_{};			// Every axis's design coordinate (16.16) when `options_.variation` is set, in axis order.
+		std::array<glyph_record, 129> ascii_records_{};			// Bytes 0-127, then the sentinel every other byte maps to.
+		std::pmr::unordered_map<char32_t, glyph_record> extended_records_{};	// Records of the loaded characters above ASCII.
+		atlas_allocation shared_slots_{};						// The slots held in `options_.shared_atlas`, released with the font.
 
 		// Font configuration
-		std::string windows_fonts_paths_{ "C:/Windows/Fonts/" };	// Windows font paths.
+		std::string fonts_path_{ "C:/Windows/Fonts/" };			// Directory relative font names are resolved against.
 		std::string selected_font_;									// The font chosen by the user.
 
 		// Font Sizing
@@ -267,24 +881,92 @@ namespace text_to_texture_atlas
 		unsigned int char_height_dpi_{ 600 };		// The font DPI height.
 		unsigned int char_width_px_{ 0 };			// The font width in pixels.
 		unsigned int char_height_px_{ 600 };		// The font height in pixels.
+		bool pixel_sizing_{};						// Whether the font was created with pixel sizes rather than points.
 
 		// Character Processing Range
-		int char_range_min{ 32 };		// First printable character.
-		int char_range_max{ 126 };		// Last Printable character.
+		int char_range_min{ 32 };		// Lowest codepoint in the charset.
+		int char_range_max{ 126 };		// Highest codepoint in the charset.
 
 		// Font and Atlas initialization
 		bool init_library();						// initializes the `library_` and returns false if unsuccessful.
 		bool init_face();							// initializes  the 'face_' and returns false if unsuccessful.
+		bool init_variation();						// applies `options_.variation` to the face, returns false if unsuccessful.
+		void init_char_range();						// initializes `char_range_min` and `char_range_max` from the charset.
 		bool init_char_size();						// initializes the character pt sizes, returns false if unsuccessful.
 		bool init_pixel_size();						// initializes the character px sizes, returns false if unsuccessful.
 		bool init_character_map();					// initializes the character_map_, returns false if unsuccessful.
 		bool init_main_atlas_buffer();				// initializes the atlas buffer, ensuring the buffer is large enough to account for all characters.
-		bool convert_bitmap_to_four_channel_buffer	// Converts the raw bitmap buffer into a four channel buffer.
-			(std::vector<unsigned char>& dst_vector,
+		void report_issue(const build_issue& issue);	// records an issue, passes it to `options_.on_issue` and fails the build on an error.
+		bool add_sprites(unsigned int channels);	// adds `options_.sprites` to the character map, returns false if one is invalid.
+		void init_glyph_records();					// copies the loaded characters into `ascii_records_` and `extended_records_`.
+		bool fit_memory_budget();					// Degrades the build per `options_.memory` until its estimated peak fits, returns false if it cannot.
+		size_t estimate_build_bytes					// Estimates the peak bytes of building the atlas with the given packer and channel count.
+			(atlas_packer packer,
+				unsigned int channels);
+		void convert_characters_to_r8();			// Reduces every staged RGBA character bitmap to its coverage channel.
+		bool rebuild_at_scale(float scale);			// Re-renders every character at `scale` times the requested size.
+		size_t get_character_map_bytes() const;		// Estimates the bytes held by the character map's nodes and buckets.
+		void update_reservation();					// Resizes `reservation_` to the bytes currently held.
+		bool place_grid								// Places characters in a square grid and returns the atlas size.
+			(const std::pmr::vector<character*>& placed_characters,
+				unsigned int& atlas_width,
+				unsigned int& atlas_height) const;
+		bool place_shelf							// Places characters on shelves and returns the atlas size.
+			(const std::pmr::vector<character*>& placed_characters,
+				unsigned int& atlas_width,
+				unsigned int& atlas_height) const;
+		std::pmr::vector<atlas_rect>				// Returns each placed character's size as a rect, for the packers.
+			get_placement_rects(const std::pmr::vector<character*>& placed_characters) const;
+		static void set_placement					// Copies the packed rects' positions back to the characters.
+			(const std::pmr::vector<character*>& placed_characters,
+				const std::pmr::vector<atlas_rect>& rects);
+		bool place_in_shared_atlas					// Reserves a slot per character in `options_.shared_atlas` and copies it there.
+			(const std::pmr::vector<character*>& placed_characters);
+		bool blit_characters						// Copies every placed character into the atlas buffer, split across row bands.
+			(const std::pmr::vector<character*>& placed_characters);
+		std::pmr::vector<std::pair<char32_t, character*>>	// Returns the characters in the deterministic `options_.order`.
+			get_ordered_characters();
+		std::uint64_t compute_content_hash() const;	// Hashes the atlas pixels and every character's metrics and placement.
+		std::uint64_t compute_size_key() const;		// Hashes the face's current scaled size and instance, the size part of every `glyph_key`.
+		bool find_cached_glyph						// Looks a glyph up in `options_.cache`, then `options_.pack`, returns false if neither has it.
+			(const glyph_key& key,
+				std::shared_ptr<const cached_glyph>& glyph) const;
+		std::shared_ptr<const cached_glyph>			// Adds a rendered glyph to `options_.pack` and `options_.cache`, returns the shared glyph.
+			store_cached_glyph(const glyph_key& key,
+				cached_glyph&& glyph) const;
+		bool load_cached_glyph						// Fetches a glyph from `options_.cache` or `options_.pack`, or renders it, as a format-independent coverage bitmap.
+			(FT_UInt glyph_index,
+				std::uint64_t size_key,
+				std::shared_ptr<const cached_glyph>& glyph);
+		bool load_effect_glyph						// Like `load_cached_glyph`, but with `options_.effects` applied; `outline` is null without an outline effect.
+			(FT_UInt glyph_index,
+				std::uint64_t size_key,
+				FT_Stroker stroker,
+				std::shared_ptr<const cached_glyph>& fill,
+				std::shared_ptr<const cached_glyph>& outline);
+		bool render_effect_layers					// Loads a glyph, applies `options_.effects` and renders its fill and outline, returns false if unsuccessful.
+			(FT_UInt glyph_index,
+				FT_Stroker stroker,
+				cached_glyph& fill,
+				cached_glyph& outline);
+		bool emplace_effect_character				// Adds a character from rendered layers, with the outline in red when given, returns false if unsuccessful.
+			(char32_t codepoint,
+				const cached_glyph& fill,
+				const cached_glyph* outline,
+				unsigned int channels);
+		bool render_glyph(const FT_Bitmap*& bitmap,	// Renders the loaded glyph with the selected backend, returns false if unsuccessful.
+			int& bitmap_left,
+			int& bitmap_top);
+		bool convert_bitmap_to_channel_buffer		// Converts the raw bitmap buffer into a four or one channel buffer.
+			(std::pmr::vector<unsigned char>& dst_vector,
+				const FT_Bitmap& bitmap,
 				unsigned int bitmap_width,
-				unsigned int bitmap_height) const;
+				unsigned int bitmap_height,
+				unsigned int channels) const;
 
 		// Getters
+		std::pmr::memory_resource* get_resource() const;			// Returns `options_.resource`, or the default resource.
+		std::pmr::memory_resource* get_scratch_resource() const;	// Returns `options_.scratch_resource`, or `get_resource()`.
 		size_t get_total_buffer_size() const;				// Calculates the total buffer size needed for the atlas.
 		unsigned int get_max_character_width() const;		// Calculates the maximum width of a character from all characters in the map.
 		unsigned int get_max_character_height() const;		// Calculates the maximum height of a character from all characters in the map.
@@ -294,13 +976,15 @@ namespace text_to_texture_atlas
 			std::string font_name,
 			signed long char_pt_size = 64 * 64,
 			unsigned int char_width_dpi = 600,
-			unsigned int char_height_dpi = 600
+			unsigned int char_height_dpi = 600,
+			const build_options& options = {}
 		);
 		
 		explicit Font(								// Generates a font and atlas using pixel size.
 			std::string font_name,
 			unsigned int char_height = 0,
-			unsigned int char_width = 0
+			unsigned int char_width = 0,
+			const build_options& options = {}
 		);
 
 	public:
@@ -331,6 +1015,8 @@ namespace text_to_texture_atlas
 		 * @param char_height_dpi Vertical resolution in dots per inch (default: 600).
 		 *                        Should typically match char_width_dpi for proportional rendering.
 		 *
+		 * @param options Optional build settings such as the rasterizer backend (default: FreeType).
+		 *
 		 * @return Font object containing the complete texture atlas and character metrics.
 		 *         Use the bool conversion operator to check if construction was successful.
 		 *
@@ -368,7 +1054,8 @@ namespace text_to_texture_atlas
 			const std::string& font_name,
 			signed long char_pt_size = 64 * 64,
 			unsigned int char_width_dpi = 600,
-			unsigned int char_height_dpi = 600
+			unsigned int char_height_dpi = 600,
+			const build_options& options = {}
 		);
 		/**
 		 * @brief
@@ -392,6 +1079,8 @@ namespace text_to_texture_atlas
 		 *                   When set to 0, FreeType automatically determines the width based on
 		 *                   the font's internal metrics and maintains proper proportions.
 		 *
+		 * @param options Optional build settings such as the rasterizer backend (default: FreeType).
+		 *
 		 * @return Font object containing the complete texture atlas and character metrics.
 		 *         Use the bool conversion operator to check if construction was successful.
 		 *
@@ -429,7 +1118,8 @@ namespace text_to_texture_atlas
 		static Font Font_Px(
 			const std::string& font_name,
 			unsigned int char_height = 0,
-			unsigned int char_width = 0
+			unsigned int char_width = 0,
+			const build_options& options = {}
 		);
 
 		// Operators
@@ -463,14 +1153,29 @@ namespace text_to_texture_atlas
 			return !error_;
 		}
 
+		/**
+		 * @brief Returns every issue raised while building the font, in the order they were raised.
+		 *
+		 * @details Holds the errors that failed the build as well as warnings, such as glyphs that
+		 *          were skipped or degradations made to fit the memory budget.
+		 *
+		 * @code
+		 * auto font = text_to_texture_atlas::Font::Font_Px("arial.ttf", 32);
+		 * for (const auto& issue : font.get_issues()) {
+		 *     std::cerr << text_to_texture_atlas::describe(issue) << "\n";
+		 * }
+		 * @endcode
+		 */
+		inline const std::vector<build_issue>& get_issues() const { return issues_; }
+
 		// Cleanup
 		/**
 		 * @brief Releases memory used by individual character bitmaps after the main atlas is created.
 		 *
-		 * @details This function iterates through all loaded characters and clears their
-		 *          `raw_bitmap_buffer`. This is a memory optimization that should be called
-		 *          once the main texture atlas has been generated and the individual character
-		 *          bitmaps are no longer needed for processing or debugging.
+		 * @details This function iterates through all loaded characters and releases their
+		 *          `raw_bitmap_buffer`, returning the memory rather than only clearing it. The
+		 *          constructor already does this unless `build_options::release_staging` is false,
+		 *          so it is only needed by callers that kept the buffers for debugging.
 		 *
 		 *
 		 * @code
@@ -496,8 +1201,7 @@ namespace text_to_texture_atlas
 		 *
 		 * @warning After calling this function, the raw bitmap data for each character is permanently
 		 *          deleted. Any subsequent operations that require individual character bitmaps
-		 *          (e.g., `character::output_raw()`, re-generating the atlas) will fail or produce
-		 *          empty results.
+		 *          (e.g., re-generating the atlas) will fail or produce empty results.
 		 *
 		 * @see free_atlas_buffer() to release the main atlas memory.
 		 */
@@ -505,7 +1209,7 @@ namespace text_to_texture_atlas
 		/**
 		 * @brief Releases memory used by the main texture atlas buffer.
 		 *
-		 * @details This function clears the `atlas_buffer` within the `main_atlas_` struct.
+		 * @details This function releases the `atlas_buffer` within the `main_atlas_` struct.
 		 *          This is a significant memory optimization that should be called after the
 		 *          atlas texture has been uploaded to the GPU or is otherwise no longer needed
 		 *          in system memory.
@@ -547,7 +1251,8 @@ namespace text_to_texture_atlas
 		 *          rendering and metric information for the requested character, such as its
 		 *          size, bearing, advance, and texture coordinates within the main atlas.
 		 *
-		 * @param character_ The ASCII character to retrieve (e.g., 'A', 'b', '?').
+		 * @param character_ The character to retrieve (e.g., 'A', 'b', '?'). Bytes above 127 are
+		 *                   read as Latin-1 codepoints.
 		 *
 		 * @return A reference to the `character` struct. This allows for both reading and
 		 *         modification of the character's data, though modification is not advised.
@@ -583,10 +1288,96 @@ namespace text_to_texture_atlas
 		 *          contain empty or zeroed-out data, which may lead to unexpected rendering
 		 *          artifacts if not handled correctly.
 		 *
+		 * @see find_character() for a non-inserting lookup by codepoint.
 		 * @see get_main_atlas() to access the complete texture atlas.
 		 * @see Font::character for details on the returned struct.
 		 */
 		character& get_character(char character_);
+		/**
+		 * @brief Looks up a character by Unicode codepoint without modifying the map.
+		 *
+		 * @details Unlike `get_character()`, this never inserts anything. It is the lookup to use
+		 *          for charsets beyond ASCII, such as Latin-1 or CJK ranges set in `build_options::charset`.
+		 *
+		 * @param codepoint The Unicode codepoint to look up (e.g., U'A', U'\u00e9', U'\u4e2d').
+		 *
+		 * @return A pointer to the character, or nullptr if it was not loaded.
+		 *
+		 * @code
+		 * if (const auto* glyph = font.find_character(U'\u00e9')) {
+		 *     // Use glyph->tex_coords_* for UV mapping.
+		 * }
+		 * @endcode
+		 */
+		const character* find_character(char32_t codepoint) const;
+		/**
+		 * @brief Looks up a sprite added through `build_options::sprites` by its id.
+		 *
+		 * @code
+		 * if (const auto* icon = font.find_sprite(warning_icon_id)) {
+		 *     draw_quad(pen_x + icon->x_bearing_, pen_y - icon->y_bearing_, icon->width_, icon->height_,
+		 *         icon->tex_coords_top_left, icon->tex_coords_bottom_right);	// Same texture and batch as the text.
+		 *     pen_x += icon->advance_x_ / 64.0f;
+		 * }
+		 * @endcode
+		 *
+		 * @return The sprite, or null if the font has no sprite with that id.
+		 */
+		inline const character* find_sprite(const std::uint32_t id) const { return find_character(sprite_key(id)); }
+		/**
+		 * @brief Looks up an ASCII character in a fixed table, without hashing or branching.
+		 *
+		 * @details Meant for per-frame text loops. Bytes above 127 and characters that were not
+		 *          loaded return the sentinel record (`loaded == false`, zero size and advance);
+		 *          use `find_character()` for anything beyond ASCII.
+		 *
+		 * @code
+		 * for (const char c : text) {
+		 *     const auto& glyph = font.get_ascii_record(c);
+		 *     draw_quad(x + glyph.bearing_x, y - glyph.bearing_y, glyph.width, glyph.height, glyph.u0, glyph.v0, glyph.u1, glyph.v1);
+		 *     x += glyph.advance_x / 64.0f;
+		 * }
+		 * @endcode
+		 */
+		inline const glyph_record& get_ascii_record(const char character_) const
+		{
+			return ascii_records_[std::min(static_cast<unsigned int>(static_cast<unsigned char>(character_)), 128u)];
+		}
+		/**
+		 * @brief Maps every byte of `text` to its glyph record in one pass, like `get_ascii_record()`.
+		 *
+		 * @param text The ASCII text to look up.
+		 * @param records Receives a record per byte, in order. Never null; missing glyphs get the sentinel.
+		 *
+		 * @return The number of records written: the smaller of `text.size()` and `records.size()`.
+		 */
+		std::size_t get_ascii_records(std::string_view text, std::span<const glyph_record*> records) const;
+		/**
+		 * @brief Decodes UTF-8 text and maps every codepoint to its glyph record in one streaming pass.
+		 *
+		 * @details Runs of ASCII are found sixteen bytes at a time (SSE2 where available) and go
+		 *          straight through the ASCII table; other sequences are decoded and looked up among
+		 *          the loaded characters. Malformed sequences (overlong forms, surrogates, truncated or
+		 *          stray bytes) decode to U+FFFD, one per maximal invalid subpart, as Unicode recommends.
+		 *          Codepoints without a glyph get the sentinel record and, if `misses` is given, are
+		 *          reported with their position, so the caller can fill them from a fallback font.
+		 *
+		 * @code
+		 * std::vector<const text_to_texture_atlas::glyph_record*> records;
+		 * std::vector<text_to_texture_atlas::glyph_miss> misses;
+		 * font.lookup_utf8(u8_label, records, &misses);
+		 * for (const auto& miss : misses) {
+		 *     records[miss.index] = fallback_lookup(miss.codepoint);
+		 * }
+		 * @endcode
+		 *
+		 * @param text The UTF-8 text to decode.
+		 * @param records Receives a record per codepoint, appended in order. Never null.
+		 * @param misses If not null, receives every codepoint that got the sentinel, appended in order.
+		 *
+		 * @return The number of records appended, i.e. the number of codepoints decoded.
+		 */
+		std::size_t lookup_utf8(std::string_view text, std::vector<const glyph_record*>& records, std::vector<glyph_miss>* misses = nullptr) const;
 		/**
 		 * @brief Retrieves the main texture atlas containing all rendered characters.
 		 *
@@ -630,8 +1421,83 @@ namespace text_to_texture_atlas
 		 * @see Font::atlas for details on the returned struct.
 		 */
 		atlas& get_main_atlas();
-		inline int get_char_range_min() const { return char_range_min; }	// returns the character processing range minimum.
-		inline int get_char_range_max() const { return char_range_max; }	// returns the character processing range maximum.
+		const atlas& get_main_atlas() const;	// returns the main atlas of a const font.
+		/**
+		 * @brief Returns a content hash of the finished atlas and all character metrics.
+		 *
+		 * @details The hash covers the atlas dimensions and pixels plus every character's
+		 *          codepoint, size, bearings, advances and atlas position, fed in ascending
+		 *          codepoint order. Two fonts with the same hash produced bit-identical atlases
+		 *          and metrics, so the value can be used as a key in content-addressed caches.
+		 *
+		 * @code
+		 * auto font = text_to_texture_atlas::Font::Font_Px("arial.ttf", 32, 0);
+		 * if (font && !asset_cache.contains(font.get_content_hash())) {
+		 *     asset_cache.store(font.get_content_hash(), font.get_main_atlas());
+		 * }
+		 * @endcode
+		 *
+		 * @note The hash is computed once when the atlas is built and is unaffected by
+		 *       `free_atlas_buffer()` or `free_character_buffers()`. It is 0 if construction failed.
+		 */
+		inline std::uint64_t get_content_hash() const { return content_hash_; }
+		inline int get_char_range_min() const { return char_range_min; }	// returns the lowest codepoint in the charset.
+		inline int get_char_range_max() const { return char_range_max; }	// returns the highest codepoint in the charset.
+		inline const std::pmr::unordered_map<char32_t, character>& get_characters() const { return character_map_; }	// returns every loaded character by codepoint.
+
+		/**
+		 * @brief Lays out a line or column of text and appends a quad for every visible character.
+		 *
+		 * @details The pen is a y-down position. Horizontally it sits on the baseline and moves
+		 *          right by `advance_x_`; vertically it sits at the top of the column's centre
+		 *          line and moves down by `advance_y_`. Both directions sample the same atlas.
+		 *          Whitespace only advances the pen, and characters that were not loaded are skipped.
+		 *          There is no line breaking, kerning or shaping (such as vertical punctuation forms).
+		 *
+		 * @param text The codepoints to lay out.
+		 * @param direction The direction to advance the pen in.
+		 * @param pen_x The pen's x position, advanced past the text on return.
+		 * @param pen_y The pen's y position, advanced past the text on return.
+		 * @param quads Receives a quad per visible character, appended in text order.
+		 *
+		 * @return false if `direction` is vertical and the font was built without
+		 *         `build_options::vertical_metrics` (nothing is appended), true otherwise.
+		 *
+		 * @code
+		 * std::vector<text_to_texture_atlas::glyph_quad> quads{};
+		 * float x = 100.0f, y = 40.0f;
+		 * font.layout_text(U"\u7E26\u66F8\u304D", text_to_texture_atlas::text_direction::vertical, x, y, quads);
+		 * for (const auto& quad : quads) {
+		 *     draw_quad(quad.x0, quad.y0, quad.x1, quad.y1, quad.u0, quad.v0, quad.u1, quad.v1);
+		 * }
+		 * @endcode
+		 */
+		bool layout_text(std::u32string_view text, text_direction direction, float& pen_x, float& pen_y, std::vector<glyph_quad>& quads) const;
+
+		/**
+		 * @brief Returns the bytes this font currently holds, by category.
+		 *
+		 * @code
+		 * auto report = font.get_memory_report();
+		 * std::cout << "atlas " << report.atlas_bytes << ", staging " << report.staging_bytes
+		 *           << ", total " << report.total() << " bytes\n";
+		 * @endcode
+		 *
+		 * @note Buffer sizes are capacities, so they reflect what is actually allocated.
+		 */
+		memory_report get_memory_report() const;
+
+		/**
+		 * @brief Returns the size the characters were rendered at, relative to the requested size.
+		 *
+		 * @details 1 unless `memory_policy::allow_lower_resolution` had to shrink the build. Metrics
+		 *          and atlas coordinates are in rendered pixels; multiply quad sizes and advances
+		 *          by `1 / get_resolution_scale()` to draw text at the requested size.
+		 */
+		inline float get_resolution_scale() const { return resolution_scale_; }
+
+		/// returns the options the font was actually built with, after any memory budget degradation.
+		inline const build_options& get_build_options() const { return options_; }
 
 	};
 
@@ -0,0 +1,95 @@
+#include "GlyphCache.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <ranges>
+
+#include "Hash.hpp"
+
+#pragma region glyph_key_hash
+std::size_t text_to_texture_atlas::glyph_key_hash::operator()(const glyph_key& key) const noexcept
+{
+	content_hasher hasher{};
+	hasher.update_value(key.face);
+	hasher.update_value(key.size);
+	hasher.update_value(key.glyph_index);
+	hasher.update_value(key.rasterizer);
+	return static_cast<std::size_t>(hasher.digest());
+}
+#pragma endregion
+
+#pragma region find
+std::shared_ptr<const text_to_texture_atlas::cached_glyph> text_to_texture_atlas::glyph_cache::find
+(
+	const glyph_key& key
+) const
+{
+	std::shared_lock lock{ mutex_ };
+	const auto found{ glyphs_.find(key) };
+	if (found == glyphs_.end())
+	{
+		misses_++;
+		return nullptr;
+	}
+	hits_++;
+	return found->second;
+}
+#pragma endregion
+
+#pragma region insert
+std::shared_ptr<const text_to_texture_atlas::cached_glyph> text_to_texture_atlas::glyph_cache::insert
+(
+	const glyph_key& key,
+	cached_glyph glyph
+)
+{
+	auto shared{ std::make_shared<const cached_glyph>(std::move(glyph)) };
+	std::unique_lock lock{ mutex_ };
+	return glyphs_.try_emplace(key, std::move(shared)).first->second;
+}
+#pragma endregion
+
+#pragma region retain_faces
+std::size_t text_to_texture_atlas::glyph_cache::retain_faces
+(
+	const std::vector<std::uint64_t>& faces
+)
+{
+	std::unique_lock lock{ mutex_ };
+	return std::erase_if(glyphs_, [&](const auto& entry)
+	{
+		return std::ranges::find(faces, entry.first.face) == faces.end();
+	});
+}
+#pragma endregion
+
+#pragma region clear
+void text_to_texture_atlas::glyph_cache::clear()
+{
+	std::unique_lock lock{ mutex_ };
+	glyphs_.clear();
+	hits_ = 0;
+	misses_ = 0;
+}
+#pragma endregion
+
+#pragma region size
+std::size_t text_to_texture_atlas::glyph_cache::size() const
+{
+	std::shared_lock lock{ mutex_ };
+	return glyphs_.size();
+}
+#pragma endregion
+
+#pragma region get_memory_usage
+std::size_t text_to_texture_atlas::glyph_cache::get_memory_usage() const
+{
+	std::shared_lock lock{ mutex_ };
+	std::size_t total{};
+	for (const auto& glyph : glyphs_ | std::views::values)
+	{
+		total += glyph->coverage.size();
+	}
+	return total;
+}
+#pragma endregion
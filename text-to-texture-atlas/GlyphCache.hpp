@@ -0,0 +1,131 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Rasterizer.hpp"
+
+namespace text_to_texture_atlas
+{
+	/**
+	 * @brief
+	 * Identifies one rasterized glyph: which font file, at which size, which glyph, rendered how.
+	 */
+	struct glyph_key
+	{
+		std::uint64_t face{};		///< Hash of the font file contents (see `hash_file`).
+		std::uint64_t size{};		///< Hash of the face's scaled size metrics (ppem and 16.16 scales).
+		std::uint32_t glyph_index{};	///< The glyph index inside the face.
+		rasterizer_backend rasterizer{ rasterizer_backend::freetype };	///< The backend that produced the coverage.
+
+		bool operator==(const glyph_key&) const = default;
+	};
+
+	/**
+	 * @brief
+	 * Hashes a `glyph_key` for unordered containers.
+	 */
+	struct glyph_key_hash
+	{
+		std::size_t operator()(const glyph_key& key) const noexcept;
+	};
+
+	/**
+	 * @brief
+	 * A rasterized glyph, independent of the atlas format it ends up in.
+	 */
+	struct cached_glyph
+	{
+		unsigned int width{};				///< Bitmap width in pixels.
+		unsigned int height{};				///< Bitmap height in pixels.
+		int left{};							///< Same as `FT_GlyphSlot::bitmap_left`.
+		int top{};							///< Same as `FT_GlyphSlot::bitmap_top`.
+		long advance_x{};					///< Same as `FT_GlyphSlot::advance.x` (26.6).
+		long advance_y{};					///< Same as `FT_GlyphSlot::advance.y` (26.6).
+		int vertical_left{};				///< Horizontal distance from the vertical pen position to the bitmap's left edge.
+		int vertical_top{};					///< Distance down from the vertical pen position to the bitmap's top edge.
+		long vertical_advance{};			///< Same as `FT_Glyph_Metrics::vertAdvance` (26.6).
+		std::vector<unsigned char> coverage{};	///< `width * height` coverage bytes, top-down, no padding.
+	};
+
+	/**
+	 * @brief
+	 * **A thread-safe in-memory cache of rasterized glyphs, shared between `Font` builds.**
+	 *
+	 * @details
+	 * Rasterization dominates the cost of building an atlas. When several atlases use the same
+	 * font at the same size (a different charset, format or packer), or when the same atlas is
+	 * rebuilt after its manifest entry changed, the glyphs themselves have not changed. Passing a
+	 * cache through `build_options::cache` lets a `Font` reuse them instead of loading and
+	 * rendering every glyph again.
+	 *
+	 * Keys are content based: a font file that is edited gets a new face hash, so its stale
+	 * glyphs are never returned; they only occupy memory until `retain_faces` drops them.
+	 *
+	 * *Usage Example:*
+	 *
+	 * @code
+	 * text_to_texture_atlas::glyph_cache cache{};
+	 *
+	 * text_to_texture_atlas::build_options options{};
+	 * options.cache = &cache;
+	 *
+	 * auto ascii = text_to_texture_atlas::Font::Font_Px("arial.ttf", 32, 0, options);
+	 * options.format = text_to_texture_atlas::atlas_format::r8;
+	 * auto ascii_r8 = text_to_texture_atlas::Font::Font_Px("arial.ttf", 32, 0, options);	// Every glyph is a cache hit.
+	 * @endcode
+	 *
+	 * @note The cache must outlive every `Font` that is being built with it.
+	 */
+	class glyph_cache
+	{
+		mutable std::shared_mutex mutex_{};	// Guards `glyphs_`; lookups take it shared.
+		std::unordered_map<glyph_key, std::shared_ptr<const cached_glyph>, glyph_key_hash> glyphs_{};	// The cached glyphs.
+		mutable std::atomic<std::size_t> hits_{};		// Number of successful lookups.
+		mutable std::atomic<std::size_t> misses_{};		// Number of failed lookups.
+
+	public:
+		/**
+		 * @brief Looks up a glyph.
+		 *
+		 * @return The cached glyph, or null if it is not cached. The glyph stays valid even if
+		 * it is evicted afterwards.
+		 */
+		std::shared_ptr<const cached_glyph> find(const glyph_key& key) const;
+
+		/**
+		 * @brief Adds a glyph. If another build inserted the same key first, the existing glyph is kept.
+		 *
+		 * @return The glyph now cached under `key`.
+		 */
+		std::shared_ptr<const cached_glyph> insert(const glyph_key& key, cached_glyph glyph);
+
+		/**
+		 * @brief Drops every glyph whose face is not in `faces`, e.g. after font files were edited.
+		 *
+		 * @return The number of glyphs dropped.
+		 */
+		std::size_t retain_faces(const std::vector<std::uint64_t>& faces);
+
+		/**
+		 * @brief Drops every glyph and resets the statistics.
+		 */
+		void clear();
+
+		/// Returns the number of cached glyphs.
+		std::size_t size() const;
+
+		/// Returns the number of bytes of coverage held by the cache.
+		std::size_t get_memory_usage() const;
+
+		/// Returns the number of successful lookups since construction or `clear()`.
+		inline std::size_t get_hits() const { return hits_; }
+
+		/// Returns the number of failed lookups since construction or `clear()`.
+		inline std::size_t get_misses() const { return misses_; }
+	};
+}
@@ -0,0 +1,485 @@
+#include "GlyphPack.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Hash.hpp"
+
+namespace
+{
+	/**
+	 * @brief The header at the start of every pack file.
+	 */
+	struct pack_header
+	{
+		char magic[8]{ 'T', 'T', 'A', 'G', 'P', 'A', 'C', 'K' };
+		std::uint32_t version{ 2 };				// Bump whenever the record layout changes.
+		std::uint32_t byte_order{ 0x01020304 };	// Records are stored in native byte order; other hosts reject the file.
+		std::uint32_t record_header_size{ 88 };
+		std::uint32_t reserved{};
+		std::uint64_t reserved_2{};
+	};
+	static_assert(sizeof(pack_header) == 32, "pack_header is part of the file format");
+
+	constexpr std::uint32_t record_magic{ 0x46594C47 };	// "GLYF"
+
+	constexpr std::uint64_t padded_record_size(const std::uint64_t header_size, const std::uint64_t coverage_size)
+	{
+		return (header_size + coverage_size + 7) & ~std::uint64_t{ 7 };
+	}
+}
+
+#pragma region destructor
+text_to_texture_atlas::glyph_pack::~glyph_pack()
+{
+	close();
+}
+#pragma endregion
+
+#pragma region lock_file
+bool text_to_texture_atlas::glyph_pack::lock_file(const bool exclusive) const
+{
+#ifdef _WIN32
+	OVERLAPPED overlapped{};
+	return LockFileEx(static_cast<HANDLE>(file_), exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0, MAXDWORD, MAXDWORD, &overlapped) != 0;
+#else
+	int result{};
+	do
+	{
+		result = flock(fd_, exclusive ? LOCK_EX : LOCK_SH);
+	} while (result != 0 && errno == EINTR);
+	return result == 0;
+#endif
+}
+#pragma endregion
+
+#pragma region unlock_file
+void text_to_texture_atlas::glyph_pack::unlock_file() const
+{
+#ifdef _WIN32
+	OVERLAPPED overlapped{};
+	UnlockFileEx(static_cast<HANDLE>(file_), 0, MAXDWORD, MAXDWORD, &overlapped);
+#else
+	flock(fd_, LOCK_UN);
+#endif
+}
+#pragma endregion
+
+#pragma region get_file_size
+std::uint64_t text_to_texture_atlas::glyph_pack::get_file_size() const
+{
+#ifdef _WIN32
+	LARGE_INTEGER size{};
+	return GetFileSizeEx(static_cast<HANDLE>(file_), &size) ? static_cast<std::uint64_t>(size.QuadPart) : 0;
+#else
+	struct stat status{};
+	return fstat(fd_, &status) == 0 ? static_cast<std::uint64_t>(status.st_size) : 0;
+#endif
+}
+#pragma endregion
+
+#pragma region map
+bool text_to_texture_atlas::glyph_pack::map(const std::uint64_t size)
+{
+	unmap();
+	if (size == 0)
+	{
+		return false;
+	}
+#ifdef _WIN32
+	mapping_ = CreateFileMappingW(static_cast<HANDLE>(file_), nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping_)
+	{
+		return false;
+	}
+	view_ = static_cast<const unsigned char*>(MapViewOfFile(static_cast<HANDLE>(mapping_), FILE_MAP_READ, 0, 0, 0));
+#else
+	void* view{ mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_SHARED, fd_, 0) };
+	view_ = view == MAP_FAILED ? nullptr : static_cast<const unsigned char*>(view);
+#endif
+	if (!view_)
+	{
+		unmap();
+		return false;
+	}
+	view_size_ = size;
+	return true;
+}
+#pragma endregion
+
+#pragma region unmap
+void text_to_texture_atlas::glyph_pack::unmap()
+{
+#ifdef _WIN32
+	if (view_)
+	{
+		UnmapViewOfFile(view_);
+	}
+	if (mapping_)
+	{
+		CloseHandle(static_cast<HANDLE>(mapping_));
+		mapping_ = nullptr;
+	}
+#else
+	if (view_)
+	{
+		munmap(const_cast<unsigned char*>(view_), static_cast<size_t>(view_size_));
+	}
+#endif
+	view_ = nullptr;
+	view_size_ = 0;
+}
+#pragma endregion
+
+#pragma region write_at
+bool text_to_texture_atlas::glyph_pack::write_at
+(
+	std::uint64_t offset,
+	const void* data,
+	std::size_t length
+) const
+{
+	auto bytes{ static_cast<const unsigned char*>(data) };
+	while (length > 0)
+	{
+#ifdef _WIN32
+		OVERLAPPED overlapped{};
+		overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+		overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		DWORD written{};
+		if (!WriteFile(static_cast<HANDLE>(file_), bytes, static_cast<DWORD>(std::min<std::size_t>(length, 1u << 30)), &written, &overlapped) || written == 0)
+		{
+			return false;
+		}
+#else
+		const auto written{ pwrite(fd_, bytes, length, static_cast<off_t>(offset)) };
+		if (written < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (written <= 0)
+		{
+			return false;
+		}
+#endif
+		bytes += written;
+		offset += static_cast<std::uint64_t>(written);
+		length -= static_cast<std::size_t>(written);
+	}
+	return true;
+}
+#pragma endregion
+
+#pragma region truncate
+bool text_to_texture_atlas::glyph_pack::truncate(const std::uint64_t size)
+{
+	// Windows refuses to shrink a file while a view of it is mapped.
+	unmap();
+#ifdef _WIN32
+	LARGE_INTEGER position{};
+	position.QuadPart = static_cast<LONGLONG>(size);
+	const bool truncated{ SetFilePointerEx(static_cast<HANDLE>(file_), position, nullptr, FILE_BEGIN) && SetEndOfFile(static_cast<HANDLE>(file_)) };
+#else
+	const bool truncated{ ftruncate(fd_, static_cast<off_t>(size)) == 0 };
+#endif
+	return map(get_file_size()) && truncated;
+}
+#pragma endregion
+
+#pragma region compute_checksum
+std::uint64_t text_to_texture_atlas::glyph_pack::compute_checksum
+(
+	const record_header& header,
+	const unsigned char* coverage
+)
+{
+	record_header unchecked{ header };
+	unchecked.checksum = 0;
+	content_hasher hasher{};
+	hasher.update(&unchecked, sizeof(unchecked));
+	hasher.update(coverage, header.coverage_size);
+	return hasher.digest();
+}
+#pragma endregion
+
+#pragma region refresh
+bool text_to_texture_atlas::glyph_pack::refresh()
+{
+	// Another baker may have grown the file, or truncated a torn tail and appended a shorter record.
+	// A view that reaches past the end of the file faults when read, so it always matches the file.
+	const auto size{ get_file_size() };
+	if (size != view_size_ && !map(size))
+	{
+		return false;
+	}
+	if (scanned_end_ > size)
+	{
+		// Valid records are never truncated, so this only happens if the file was replaced; index it again.
+		index_.clear();
+		scanned_end_ = sizeof(pack_header);
+	}
+
+	while (scanned_end_ + sizeof(record_header) <= size)
+	{
+		record_header header{};
+		std::memcpy(&header, view_ + scanned_end_, sizeof(header));
+		const auto record_size{ padded_record_size(sizeof(record_header), header.coverage_size) };
+		if (header.magic != record_magic || scanned_end_ + record_size > size
+			|| compute_checksum(header, view_ + scanned_end_ + sizeof(record_header)) != header.checksum)
+		{
+			break;
+		}
+
+		const glyph_key key{ .face = header.face, .size = header.size, .glyph_index = header.glyph_index,
+			.rasterizer = static_cast<rasterizer_backend>(header.rasterizer) };
+		index_.try_emplace(key, scanned_end_);
+		scanned_end_ += record_size;
+	}
+	return true;
+}
+#pragma endregion
+
+#pragma region open
+bool text_to_texture_atlas::glyph_pack::open(const std::filesystem::path& path)
+{
+	close();
+	path_ = path;
+
+	std::error_code error{};
+	if (path.has_parent_path())
+	{
+		std::filesystem::create_directories(path.parent_path(), error);
+	}
+
+#ifdef _WIN32
+	const HANDLE file{ CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	file_ = file;
+#else
+	fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd_ < 0)
+	{
+		return false;
+	}
+#endif
+
+	std::unique_lock lock{ mutex_ };
+	if (!lock_file(true))
+	{
+		lock.unlock();
+		close();
+		return false;
+	}
+
+	const pack_header expected{};
+	bool usable{ true };
+	if (get_file_size() == 0)
+	{
+		usable = write_at(0, &expected, sizeof(expected));
+	}
+	if (usable)
+	{
+		pack_header header{};
+		usable = get_file_size() >= sizeof(pack_header) && map(get_file_size());
+		if (usable)
+		{
+			std::memcpy(&header, view_, sizeof(header));
+			usable = std::memcmp(&header, &expected, sizeof(header)) == 0;
+		}
+	}
+	if (usable)
+	{
+		scanned_end_ = sizeof(pack_header);
+		usable = refresh();
+	}
+	unlock_file();
+
+	lock.unlock();
+	if (!usable)
+	{
+		close();
+	}
+	return usable;
+}
+#pragma endregion
+
+#pragma region close
+void text_to_texture_atlas::glyph_pack::close()
+{
+	std::unique_lock lock{ mutex_ };
+	unmap();
+#ifdef _WIN32
+	if (file_)
+	{
+		CloseHandle(static_cast<HANDLE>(file_));
+		file_ = nullptr;
+	}
+#else
+	if (fd_ >= 0)
+	{
+		::close(fd_);
+		fd_ = -1;
+	}
+#endif
+	index_.clear();
+	scanned_end_ = 0;
+}
+#pragma endregion
+
+#pragma region find
+bool text_to_texture_atlas::glyph_pack::find
+(
+	const glyph_key& key,
+	cached_glyph& glyph
+)
+{
+	const auto read_record = [&](const std::uint64_t offset)
+	{
+		record_header header{};
+		std::memcpy(&header, view_ + offset, sizeof(header));
+		glyph.width = header.width;
+		glyph.height = header.height;
+		glyph.left = header.left;
+		glyph.top = header.top;
+		glyph.advance_x = static_cast<long>(header.advance_x);
+		glyph.advance_y = static_cast<long>(header.advance_y);
+		glyph.vertical_left = header.vertical_left;
+		glyph.vertical_top = header.vertical_top;
+		glyph.vertical_advance = static_cast<long>(header.vertical_advance);
+		const auto coverage{ view_ + offset + sizeof(record_header) };
+		glyph.coverage.assign(coverage, coverage + header.coverage_size);
+	};
+
+	{
+		std::shared_lock lock{ mutex_ };
+		if (!view_)
+		{
+			return false;
+		}
+		const auto found{ index_.find(key) };
+		if (found != index_.end() && found->second < view_size_)
+		{
+			read_record(found->second);
+			return true;
+		}
+	}
+
+	// Either another process may have appended the glyph, or this process appended it past the
+	// current view. Both are resolved by mapping the current file and indexing its new records.
+	std::unique_lock lock{ mutex_ };
+	if (!view_ || !lock_file(false))
+	{
+		return false;
+	}
+	const bool refreshed{ refresh() };
+	unlock_file();
+
+	const auto found{ index_.find(key) };
+	if (!refreshed || found == index_.end() || found->second >= view_size_)
+	{
+		return false;
+	}
+	read_record(found->second);
+	return true;
+}
+#pragma endregion
+
+#pragma region insert
+bool text_to_texture_atlas::glyph_pack::insert
+(
+	const glyph_key& key,
+	const cached_glyph& glyph
+)
+{
+	std::unique_lock lock{ mutex_ };
+	if (!view_)
+	{
+		return false;
+	}
+	if (index_.contains(key))
+	{
+		return true;
+	}
+
+	record_header header{};
+	header.magic = record_magic;
+	header.coverage_size = static_cast<std::uint32_t>(glyph.coverage.size());
+	header.face = key.face;
+	header.size = key.size;
+	header.glyph_index = key.glyph_index;
+	header.rasterizer = static_cast<std::uint32_t>(key.rasterizer);
+	header.width = glyph.width;
+	header.height = glyph.height;
+	header.left = glyph.left;
+	header.top = glyph.top;
+	header.advance_x = glyph.advance_x;
+	header.advance_y = glyph.advance_y;
+	header.vertical_left = glyph.vertical_left;
+	header.vertical_top = glyph.vertical_top;
+	header.vertical_advance = glyph.vertical_advance;
+	header.checksum = compute_checksum(header, glyph.coverage.data());
+
+	std::vector<unsigned char> record(padded_record_size(sizeof(record_header), glyph.coverage.size()));
+	std::memcpy(record.data(), &header, sizeof(header));
+	std::copy(glyph.coverage.begin(), glyph.coverage.end(), record.begin() + sizeof(record_header));
+
+	if (!lock_file(true))
+	{
+		return false;
+	}
+
+	// Another baker may have appended the same glyph since this process last looked.
+	bool written{ refresh() };
+	if (written && !index_.contains(key))
+	{
+		// Anything past the last valid record is a record torn by a crash.
+		if (get_file_size() > scanned_end_)
+		{
+			written = truncate(scanned_end_);
+		}
+		written = written && write_at(scanned_end_, record.data(), record.size());
+		if (written)
+		{
+			index_.emplace(key, scanned_end_);
+			scanned_end_ += record.size();
+		}
+	}
+	unlock_file();
+	return written;
+}
+#pragma endregion
+
+#pragma region size
+std::size_t text_to_texture_atlas::glyph_pack::size() const
+{
+	std::shared_lock lock{ mutex_ };
+	return index_.size();
+}
+#pragma endregion
+
+#pragma region operator_bool
+text_to_texture_atlas::glyph_pack::operator bool() const
+{
+	std::shared_lock lock{ mutex_ };
+	return view_ != nullptr;
+}
+#pragma endregion
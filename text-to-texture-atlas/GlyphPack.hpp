@@ -0,0 +1,144 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "GlyphCache.hpp"
+
+namespace text_to_texture_atlas
+{
+	/**
+	 * @brief
+	 * **A persistent, memory-mapped cache of rasterized glyphs shared by every bake on a machine.**
+	 *
+	 * @details
+	 * The pack is a single file of glyph records, each holding a `glyph_key`, the glyph's
+	 * metrics and its coverage bytes. Because keys hash the font file contents and the scaled
+	 * size, a glyph rendered once is reused by every later bake, by every manifest entry and
+	 * by every font file that is byte-identical, no matter where it lives.
+	 *
+	 * File layout:
+	 * - A 32 byte header: magic `TTAGPACK`, format version, byte-order mark.
+	 * - Records, appended and never modified: an 88 byte record header, then the coverage padded
+	 *   to 8 bytes. Every record carries a checksum of its header and coverage.
+	 *
+	 * The file is mapped read-only and an index of key -> record offset is kept in memory. It is
+	 * built when the pack is opened and extended with records other processes appended whenever a
+	 * lookup misses.
+	 *
+	 * Concurrent bakers are safe: appends hold an exclusive file lock, index scans hold a shared
+	 * one, and records are immutable once written. A record torn by a crash fails its checksum;
+	 * scanning stops there and the next append truncates it away.
+	 *
+	 * *Usage Example:*
+	 *
+	 * @code
+	 * text_to_texture_atlas::glyph_pack pack{};
+	 * if (!pack.open("build/glyphs.pack")) {
+	 *     // Build without the pack.
+	 * }
+	 *
+	 * text_to_texture_atlas::build_options options{};
+	 * options.pack = &pack;
+	 * auto font = text_to_texture_atlas::Font::Font_Px("arial.ttf", 32, 0, options);	// Rendered glyphs are added to the pack.
+	 * @endcode
+	 *
+	 * @note The pack only grows. Delete the file to reset it; it is recreated on the next open.
+	 */
+	class glyph_pack
+	{
+		/**
+		 * @brief The fixed-size header in front of every record's coverage bytes.
+		 */
+		struct record_header
+		{
+			std::uint32_t magic{};			// `record_magic`.
+			std::uint32_t coverage_size{};	// Number of coverage bytes after the header (without padding).
+			std::uint64_t face{};			// `glyph_key::face`.
+			std::uint64_t size{};			// `glyph_key::size`.
+			std::uint32_t glyph_index{};	// `glyph_key::glyph_index`.
+			std::uint32_t rasterizer{};		// `glyph_key::rasterizer`.
+			std::uint32_t width{};			// `cached_glyph::width`.
+			std::uint32_t height{};			// `cached_glyph::height`.
+			std::int32_t left{};			// `cached_glyph::left`.
+			std::int32_t top{};				// `cached_glyph::top`.
+			std::int64_t advance_x{};		// `cached_glyph::advance_x`.
+			std::int64_t advance_y{};		// `cached_glyph::advance_y`.
+			std::int32_t vertical_left{};	// `cached_glyph::vertical_left`.
+			std::int32_t vertical_top{};	// `cached_glyph::vertical_top`.
+			std::int64_t vertical_advance{};	// `cached_glyph::vertical_advance`.
+			std::uint64_t checksum{};		// Hash of this header (with `checksum` zeroed) and the coverage.
+		};
+		static_assert(sizeof(record_header) == 88, "record_header is part of the file format");
+
+		std::filesystem::path path_{};			// The pack file.
+#ifdef _WIN32
+		void* file_{};							// The open file handle (HANDLE), null if closed.
+		void* mapping_{};						// The file mapping object (HANDLE), null if not mapped.
+#else
+		int fd_{ -1 };							// The open file descriptor, -1 if closed.
+#endif
+		const unsigned char* view_{};			// The read-only mapping of the file, null if not mapped.
+		std::uint64_t view_size_{};				// Number of bytes mapped at `view_`.
+		std::uint64_t scanned_end_{};			// Offset just past the last valid record indexed so far.
+		std::unordered_map<glyph_key, std::uint64_t, glyph_key_hash> index_{};	// Key -> offset of its record.
+		mutable std::shared_mutex mutex_{};		// Guards everything above between threads of this process.
+
+		bool lock_file(bool exclusive) const;	// Takes the inter-process file lock, blocking.
+		void unlock_file() const;				// Releases the inter-process file lock.
+		std::uint64_t get_file_size() const;	// Returns the current size of the file on disk.
+		bool map(std::uint64_t size);			// Maps the first `size` bytes of the file, replacing the current view.
+		void unmap();							// Releases the current view.
+		bool refresh();							// Maps any growth and indexes new records. Call with the file lock held.
+		bool write_at(std::uint64_t offset, const void* data, std::size_t length) const;	// Writes raw bytes to the file.
+		bool truncate(std::uint64_t size);		// Cuts the file back to `size` bytes.
+		static std::uint64_t compute_checksum(const record_header& header, const unsigned char* coverage);	// Hashes a record.
+
+	public:
+		glyph_pack() = default;
+		~glyph_pack();
+		glyph_pack(const glyph_pack&) = delete;
+		glyph_pack& operator=(const glyph_pack&) = delete;
+
+		/**
+		 * @brief Opens a pack file, creating it (and its directory) if it does not exist.
+		 *
+		 * @return true if the pack can be used, false if the file could not be opened or is not a
+		 * glyph pack of this format version.
+		 */
+		bool open(const std::filesystem::path& path);
+
+		/**
+		 * @brief Unmaps and closes the file. Called by the destructor.
+		 */
+		void close();
+
+		/**
+		 * @brief Looks up a glyph, picking up records appended by other processes if needed.
+		 *
+		 * @param key The glyph to find.
+		 * @param glyph Receives a copy of the glyph when found.
+		 *
+		 * @return true if the glyph was found, false otherwise.
+		 */
+		bool find(const glyph_key& key, cached_glyph& glyph);
+
+		/**
+		 * @brief Appends a glyph. Nothing is written if the key is already in the pack.
+		 *
+		 * @return true if the glyph is in the pack afterwards, false if the write failed.
+		 */
+		bool insert(const glyph_key& key, const cached_glyph& glyph);
+
+		/// Returns the number of glyphs indexed so far.
+		std::size_t size() const;
+
+		/// Returns the path of the open pack file.
+		inline const std::filesystem::path& get_path() const { return path_; }
+
+		/// Returns true if the pack is open.
+		explicit operator bool() const;
+	};
+}
@@ -0,0 +1,371 @@
+#include "GlyphQueue.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#pragma region constructor
+text_to_texture_atlas::glyph_queue::glyph_queue
+(
+	std::string font_path,
+	Atlas& atlas,
+	const glyph_queue_settings& settings
+)
+	: font_path_(std::move(font_path)),
+	settings_(settings),
+	atlas_(atlas),
+	slots_(&atlas)
+{
+	if (!open_face(library_, face_))
+	{
+		error_ = true;
+		return;
+	}
+
+	// The placeholder is needed from the first frame, so it is the one glyph rendered up front.
+	for (const char32_t codepoint : { settings_.placeholder, U'?' })
+	{
+		finished_glyph result{ .codepoint = codepoint };
+		render(face_.get(), codepoint, result);
+		if (result.found)
+		{
+			if (publish(result, placeholder_))
+			{
+				records_.emplace(codepoint, placeholder_);
+			}
+			break;
+		}
+	}
+
+	workers_.reserve(settings_.worker_count);
+	for (unsigned int worker = 0; worker < settings_.worker_count; worker++)
+	{
+		workers_.emplace_back([this](const std::stop_token stop) { work(stop); });
+	}
+}
+#pragma endregion
+
+#pragma region destructor
+text_to_texture_atlas::glyph_queue::~glyph_queue()
+{
+	for (auto& worker : workers_)
+	{
+		worker.request_stop();
+	}
+	workers_.clear();
+}
+#pragma endregion
+
+#pragma region open_face
+bool text_to_texture_atlas::glyph_queue::open_face
+(
+	library_pointer& library,
+	face_pointer& face
+) const
+{
+	FT_Library new_library{};
+	if (FT_Init_FreeType(&new_library))
+	{
+		return false;
+	}
+	library.reset(new_library);
+
+	FT_Face new_face{};
+	if (FT_New_Face(library.get(), font_path_.c_str(), 0, &new_face))
+	{
+		return false;
+	}
+	face.reset(new_face);
+	return FT_Set_Pixel_Sizes(face.get(), 0, settings_.pixel_height) == 0;
+}
+#pragma endregion
+
+#pragma region render
+void text_to_texture_atlas::glyph_queue::render
+(
+	const FT_Face face,
+	const char32_t codepoint,
+	finished_glyph& result
+)
+{
+	result.codepoint = codepoint;
+	result.found = false;
+	const FT_UInt glyph_index{ FT_Get_Char_Index(face, codepoint) };
+	if (glyph_index == 0 || FT_Load_Glyph(face, glyph_index, FT_LOAD_RENDER))
+	{
+		return;
+	}
+
+	const FT_GlyphSlot slot{ face->glyph };
+	const FT_Bitmap& bitmap{ slot->bitmap };
+	auto& glyph{ result.glyph };
+	glyph.width = bitmap.width;
+	glyph.height = bitmap.rows;
+	glyph.left = slot->bitmap_left;
+	glyph.top = slot->bitmap_top;
+	glyph.advance_x = slot->advance.x;
+	glyph.advance_y = slot->advance.y;
+	glyph.coverage.assign(static_cast<std::size_t>(bitmap.width) * bitmap.rows, 0);
+	for (unsigned int y = 0; y < bitmap.rows && bitmap.buffer; y++)
+	{
+		const unsigned char* source_row{ bitmap.buffer + static_cast<std::ptrdiff_t>(y) * bitmap.pitch };
+		std::copy_n(source_row, bitmap.width, glyph.coverage.data() + static_cast<std::size_t>(y) * bitmap.width);
+	}
+	result.found = true;
+}
+#pragma endregion
+
+#pragma region publish
+bool text_to_texture_atlas::glyph_queue::publish
+(
+	const finished_glyph& result,
+	glyph_record& record
+)
+{
+	if (!result.found)
+	{
+		record = {};
+		return true;
+	}
+
+	const auto& glyph{ result.glyph };
+	atlas_slot slot{};
+	if (glyph.width && glyph.height)
+	{
+		if (glyph.width > atlas_.get_page_width() || glyph.height > atlas_.get_page_height())
+		{
+			// No page will ever have room, so it is drawn with the placeholder like a missing glyph.
+			record = {};
+			return true;
+		}
+		if (!slots_.allocate(glyph.width, glyph.height, slot))
+		{
+			return false;
+		}
+		if (!atlas_.write(slot, glyph.coverage, 1))
+		{
+			// Not for lack of space, so placing it again would fail the same way.
+			record = {};
+			return true;
+		}
+	}
+
+	const float page_width{ static_cast<float>(atlas_.get_page_width()) };
+	const float page_height{ static_cast<float>(atlas_.get_page_height()) };
+	record = {
+		.u0 = static_cast<float>(slot.rect.x) / page_width,
+		.v0 = static_cast<float>(slot.rect.y) / page_height,
+		.u1 = static_cast<float>(slot.rect.x + glyph.width) / page_width,
+		.v1 = static_cast<float>(slot.rect.y + glyph.height) / page_height,
+		.advance_x = static_cast<std::int32_t>(glyph.advance_x),
+		.bearing_x = static_cast<std::int16_t>(glyph.left),
+		.bearing_y = static_cast<std::int16_t>(glyph.top),
+		.width = static_cast<std::uint16_t>(glyph.width),
+		.height = static_cast<std::uint16_t>(glyph.height),
+		.page = static_cast<std::uint8_t>(slot.page),
+		.loaded = true };
+	return true;
+}
+#pragma endregion
+
+#pragma region take_job
+bool text_to_texture_atlas::glyph_queue::take_job
+(
+	job& taken
+)
+{
+	while (!jobs_.empty())
+	{
+		const job next{ jobs_.top() };
+		jobs_.pop();
+
+		// A raised priority leaves the earlier job behind; only the job matching `pending_` is live.
+		const auto pending{ pending_.find(next.codepoint) };
+		if (pending == pending_.end() || pending->second != next.priority)
+		{
+			continue;
+		}
+		pending_.erase(pending);
+		taken = next;
+		return true;
+	}
+	return false;
+}
+#pragma endregion
+
+#pragma region work
+void text_to_texture_atlas::glyph_queue::work
+(
+	const std::stop_token stop
+)
+{
+	// FreeType faces are not thread-safe, so every worker opens its own.
+	library_pointer library{};
+	face_pointer face{};
+	const bool opened{ open_face(library, face) };
+
+	while (!stop.stop_requested())
+	{
+		job next{};
+		{
+			std::unique_lock lock{ mutex_ };
+			if (!wake_.wait(lock, stop, [this] { return !pending_.empty(); }) || !take_job(next))
+			{
+				continue;
+			}
+		}
+
+		finished_glyph result{ .codepoint = next.codepoint };
+		if (opened)
+		{
+			render(face.get(), next.codepoint, result);
+		}
+
+		std::lock_guard lock{ mutex_ };
+		finished_.push_back(std::move(result));
+	}
+}
+#pragma endregion
+
+#pragma region request
+bool text_to_texture_atlas::glyph_queue::request
+(
+	const char32_t codepoint,
+	const int priority
+)
+{
+	if (error_ || records_.contains(codepoint))
+	{
+		return false;
+	}
+
+	const auto [requested, inserted] { requested_.try_emplace(codepoint, priority) };
+	if (!inserted && requested->second >= priority)
+	{
+		return false;
+	}
+	requested->second = priority;
+
+	{
+		std::lock_guard lock{ mutex_ };
+		const auto pending{ pending_.find(codepoint) };
+		if (!inserted && pending == pending_.end())
+		{
+			// Already being rasterized; a new job would only render it twice.
+			return false;
+		}
+		pending_[codepoint] = priority;
+		jobs_.push({ .priority = priority, .sequence = sequence_++, .codepoint = codepoint });
+	}
+	wake_.notify_one();
+	return true;
+}
+#pragma endregion
+
+#pragma region lookup
+bool text_to_texture_atlas::glyph_queue::lookup
+(
+	const char32_t codepoint,
+	const int priority,
+	glyph_record& record
+)
+{
+	const auto found{ records_.find(codepoint) };
+	if (found != records_.end() && found->second.loaded)
+	{
+		record = found->second;
+		return true;
+	}
+	if (found == records_.end())
+	{
+		request(codepoint, priority);
+	}
+	record = placeholder_;
+	return false;
+}
+#pragma endregion
+
+#pragma region pump
+std::size_t text_to_texture_atlas::glyph_queue::pump
+(
+	const std::chrono::microseconds budget
+)
+{
+	if (error_)
+	{
+		return 0;
+	}
+
+	const auto deadline{ std::chrono::steady_clock::now() + budget };
+	std::size_t published{};
+	const auto place = [&](const finished_glyph& result)
+	{
+		glyph_record record{};
+		if (!publish(result, record))
+		{
+			return false;
+		}
+		records_.insert_or_assign(result.codepoint, record);
+		requested_.erase(result.codepoint);
+		published++;
+		return true;
+	};
+	const auto add_record = [&](finished_glyph& result)
+	{
+		// A full atlas is not a missing glyph: it stays requested and is placed by a later pump.
+		if (!place(result))
+		{
+			deferred_.push_back(std::move(result));
+		}
+	};
+
+	// Slots freed since the last pump go to the glyphs that did not fit, oldest first.
+	const auto placed{ std::ranges::find_if_not(deferred_, place) };
+	deferred_.erase(deferred_.begin(), placed);
+
+	if (!workers_.empty())
+	{
+		std::vector<finished_glyph> finished{};
+		{
+			std::lock_guard lock{ mutex_ };
+			finished.swap(finished_);
+		}
+
+		// Whatever the budget leaves goes back, ahead of glyphs the workers finish meanwhile.
+		std::size_t next{};
+		do
+		{
+			if (next < finished.size())
+			{
+				add_record(finished[next++]);
+			}
+		} while (next < finished.size() && std::chrono::steady_clock::now() < deadline);
+
+		if (next < finished.size())
+		{
+			std::lock_guard lock{ mutex_ };
+			finished_.insert(finished_.begin(), std::make_move_iterator(finished.begin() + static_cast<std::ptrdiff_t>(next)), std::make_move_iterator(finished.end()));
+		}
+		return published;
+	}
+
+	finished_glyph result{};
+	while (deferred_.empty())
+	{
+		job next{};
+		{
+			std::lock_guard lock{ mutex_ };
+			if (!take_job(next))
+			{
+				break;
+			}
+		}
+		render(face_.get(), next.codepoint, result);
+		add_record(result);
+		if (std::chrono::steady_clock::now() >= deadline)
+		{
+			break;
+		}
+	}
+	return published;
+}
+#pragma endregion
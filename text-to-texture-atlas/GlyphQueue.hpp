@@ -0,0 +1,197 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <freetype/freetype.h>
+
+#include "Atlas.hpp"
+#include "Font.hpp"
+#include "GlyphCache.hpp"
+
+namespace text_to_texture_atlas
+{
+	/**
+	 * @brief
+	 * The size, threads and placeholder of a `glyph_queue`.
+	 */
+	struct glyph_queue_settings
+	{
+		unsigned int pixel_height{ 32 };		///< The glyph height in pixels, as in `Font::Font_Px`.
+		unsigned int worker_count{ 0 };			///< Background threads that rasterize (0 = `pump` rasterizes on the calling thread).
+		char32_t placeholder{ U'\uFFFD' };		///< Drawn until a glyph is ready, and for glyphs the font lacks; `?` if the font has no such glyph.
+	};
+
+	/**
+	 * @brief
+	 * **Rasterizes glyphs into a shared `Atlas` on demand, a frame's budget at a time.**
+	 *
+	 * @details
+	 * A `Font` renders its whole charset when it is built. Text that can use any of thousands of
+	 * codepoints, such as CJK chat or user names, cannot: rendering a few hundred new glyphs at once
+	 * stalls the frame they first appear in. This queue renders glyphs as they are asked for instead.
+	 *
+	 * `lookup` returns a glyph's record once it is ready. Until then it queues the glyph with the
+	 * given priority (higher first, e.g. visible text above prefetching) and returns the
+	 * placeholder, so text always lays out. Asking again with a higher priority moves a queued
+	 * glyph forward.
+	 *
+	 * Glyphs are rasterized either by `pump` on the calling thread until its time budget is spent,
+	 * or by `worker_count` background threads, each with its own FreeType face. Either way they
+	 * only become visible in `pump`: it copies the finished glyphs into the atlas and then adds
+	 * their records, so a record never points at pixels that are not there yet and the atlas is
+	 * only written on the thread that calls `pump`. Call it once per frame, before drawing and
+	 * before uploading the atlas's dirty regions.
+	 *
+	 * Only a glyph the font lacks is recorded for good and drawn with the placeholder. A glyph that
+	 * finds the atlas full stays requested: `pump` keeps it and places it again once slots are
+	 * freed, and renders no further glyphs meanwhile.
+	 *
+	 * *Usage Example:*
+	 *
+	 * @code
+	 * text_to_texture_atlas::Atlas atlas{ { .page_width = 2048, .page_height = 2048, .channels = 1 } };
+	 * text_to_texture_atlas::glyph_queue glyphs{ "NotoSansCJK-Regular.otf", atlas, { .pixel_height = 24, .worker_count = 2 } };
+	 *
+	 * // Every frame:
+	 * glyphs.pump(std::chrono::microseconds{ 1000 });
+	 * for (char32_t codepoint : visible_text) {
+	 *     text_to_texture_atlas::glyph_record record{};
+	 *     glyphs.lookup(codepoint, 1, record);	// The placeholder until the glyph is ready.
+	 *     draw_glyph(record);
+	 * }
+	 * @endcode
+	 *
+	 * @note Every method must be called from the same thread; the workers only touch the job list.
+	 * The atlas must outlive the queue, and is only written by `pump` and the constructor.
+	 */
+	class glyph_queue
+	{
+		/// One queued glyph. Raising a priority queues another job; the stale one is skipped.
+		struct job
+		{
+			int priority{};				///< Higher is rasterized first.
+			std::uint64_t sequence{};	///< Order of queueing, first come first served within a priority.
+			char32_t codepoint{};		///< The glyph to rasterize.
+
+			bool operator<(const job& other) const
+			{
+				return priority != other.priority ? priority < other.priority : sequence > other.sequence;
+			}
+		};
+
+		/// A rasterized glyph waiting for `pump` to publish it.
+		struct finished_glyph
+		{
+			char32_t codepoint{};		///< The glyph.
+			bool found{};				///< False if the font has no glyph for the codepoint or it failed to render.
+			cached_glyph glyph{};		///< The coverage and metrics.
+		};
+
+		// Freetype object ownership
+		struct library_deleter { void operator()(FT_Library library) const { FT_Done_FreeType(library); } };
+		struct face_deleter { void operator()(FT_Face face) const { FT_Done_Face(face); } };
+		using library_pointer = std::unique_ptr<FT_LibraryRec_, library_deleter>;
+		using face_pointer = std::unique_ptr<FT_FaceRec_, face_deleter>;
+
+		std::string font_path_{};									// The font file every face is opened from.
+		glyph_queue_settings settings_{};							// The size, threads and placeholder.
+		Atlas& atlas_;												// Where the glyphs are placed.
+		atlas_allocation slots_{};									// The slots held in `atlas_`.
+		library_pointer library_{};									// The calling thread's library.
+		face_pointer face_{};										// The calling thread's face, for `pump` and the placeholder.
+		bool error_{};												// Set if the font could not be opened.
+
+		// Only touched by the calling thread.
+		std::unordered_map<char32_t, glyph_record> records_{};		// Published glyphs; unloaded records mark glyphs drawn with the placeholder.
+		std::unordered_map<char32_t, int> requested_{};				// Queued glyphs not yet published, with their highest priority.
+		std::vector<finished_glyph> deferred_{};					// Rasterized glyphs that did not fit in the atlas, oldest first.
+		glyph_record placeholder_{};								// The placeholder's record.
+
+		// Shared with the workers.
+		mutable std::mutex mutex_{};								// Guards the job list and the finished glyphs.
+		std::condition_variable_any wake_{};						// Signalled when a job is queued.
+		std::priority_queue<job> jobs_{};							// The queued jobs, stale ones included.
+		std::unordered_map<char32_t, int> pending_{};				// Glyphs queued and not yet taken, with the priority of their live job.
+		std::vector<finished_glyph> finished_{};					// Glyphs rasterized by workers, not yet published.
+		std::uint64_t sequence_{};									// The next job's sequence number.
+		std::vector<std::jthread> workers_{};						// Declared last, so they stop before anything they use is destroyed.
+
+		bool open_face(library_pointer& library, face_pointer& face) const;	// Opens the font at `pixel_height`, returns false if unsuccessful.
+		bool take_job(job& taken);											// Pops the best live job, returns false if there is none. Call with `mutex_` held.
+		static void render(FT_Face face, char32_t codepoint, finished_glyph& result);	// Rasterizes one glyph into `result`.
+		bool publish(const finished_glyph& result, glyph_record& record);	// Copies a glyph into the atlas and sets its record (unloaded if the font has none or it exceeds a page), returns false if the atlas is full.
+		void work(std::stop_token stop);									// A worker's loop: take a job, rasterize it, hand it to `pump`.
+
+	public:
+		/**
+		 * @brief Opens the font, renders the placeholder into the atlas and starts the workers.
+		 *
+		 * @param font_path The font file, as a path (not resolved against a font directory).
+		 * @param atlas The atlas the glyphs are placed in; it must outlive the queue.
+		 * @param settings The size, threads and placeholder.
+		 */
+		glyph_queue(std::string font_path, Atlas& atlas, const glyph_queue_settings& settings = {});
+
+		glyph_queue(const glyph_queue&) = delete;
+		glyph_queue& operator=(const glyph_queue&) = delete;
+
+		/// Stops the workers. Published glyphs keep their atlas slots until the queue is destroyed.
+		~glyph_queue();
+
+		/**
+		 * @brief Returns a glyph's record, queueing the glyph if it is not ready yet.
+		 *
+		 * @param codepoint The character to draw.
+		 * @param priority The glyph's priority if it has to be queued; higher is rasterized first.
+		 * @param record Receives the glyph's record, or the placeholder's until it is ready or if the font lacks it.
+		 *
+		 * @return true if `record` is the glyph itself, false if it is the placeholder.
+		 */
+		bool lookup(char32_t codepoint, int priority, glyph_record& record);
+
+		/**
+		 * @brief Queues a glyph ahead of use, e.g. the rest of a string about to scroll into view.
+		 *
+		 * @return true if the glyph was queued or its priority raised, false if it is ready or already queued at that priority or higher.
+		 */
+		bool request(char32_t codepoint, int priority = 0);
+
+		/**
+		 * @brief Publishes glyphs the workers have finished and, without workers, rasterizes queued
+		 * glyphs, until the budget is spent. At least one glyph is handled per call, so the queue
+		 * always drains.
+		 *
+		 * @details Glyphs that did not fit in the atlas are placed first. While one still does not
+		 * fit, no queued glyph is rasterized on the calling thread.
+		 *
+		 * @param budget The time this call may spend.
+		 *
+		 * @return The number of glyphs published, missing ones included; glyphs that did not fit are not.
+		 */
+		std::size_t pump(std::chrono::microseconds budget);
+
+		/// Returns true if the glyph has been published, whether or not the font has it.
+		inline bool is_ready(const char32_t codepoint) const { return records_.contains(codepoint); }
+
+		/// Returns the number of glyphs queued and not yet published, including those waiting for atlas space.
+		inline std::size_t get_pending_count() const { return requested_.size(); }
+
+		/// Returns true if rasterized glyphs are waiting for slots to be freed in the atlas.
+		inline bool is_atlas_full() const { return !deferred_.empty(); }
+
+		/// Returns the placeholder's record; `loaded` is false if the font has neither the placeholder nor `?`.
+		inline const glyph_record& get_placeholder() const { return placeholder_; }
+
+		/// Returns true if the font was opened.
+		inline explicit operator bool() const { return !error_; }
+	};
+}
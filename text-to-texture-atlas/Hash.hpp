@@ -0,0 +1,181 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace text_to_texture_atlas
+{
+	/**
+	 * @brief
+	 * **A streaming 64-bit content hash for atlas pixels, metrics and input files.**
+	 *
+	 * @details
+	 * The hash consumes input eight bytes at a time with a MurmurHash3-style mix and finishes
+	 * with a full avalanche, so it is fast enough for multi-megabyte atlas buffers. Words are
+	 * always assembled little-endian and integral values are fed byte by byte in little-endian
+	 * order, so the same content produces the same digest on every platform and compiler.
+	 *
+	 * @code
+	 * text_to_texture_atlas::content_hasher hasher{};
+	 * hasher.update(atlas.atlas_buffer.data(), atlas.atlas_buffer.size());
+	 * hasher.update_value(atlas.width);
+	 * std::uint64_t digest = hasher.digest();
+	 * @endcode
+	 *
+	 * @note This is not a cryptographic hash. It is meant for cache keys and deduplication.
+	 */
+	class content_hasher
+	{
+		std::uint64_t state_{ 0x9E3779B97F4A7C15ull };	// Running hash state.
+		std::uint64_t total_length_{};					// Number of bytes consumed so far.
+		unsigned char pending_[8]{};					// Bytes waiting for a full word.
+		std::size_t pending_length_{};					// Number of valid bytes in `pending_`.
+
+		static constexpr std::uint64_t rotate_left(const std::uint64_t value, const int amount)
+		{
+			return (value << amount) | (value >> (64 - amount));
+		}
+
+		static constexpr std::uint64_t load_little_endian(const unsigned char* bytes)
+		{
+			std::uint64_t word{};
+			for (int i = 7; i >= 0; i--)
+			{
+				word = (word << 8) | bytes[i];
+			}
+			return word;
+		}
+
+		void mix_word(std::uint64_t word)
+		{
+			word *= 0x87C37B91114253D5ull;
+			word = rotate_left(word, 31);
+			word *= 0x4CF5AD432745937Full;
+			state_ ^= word;
+			state_ = rotate_left(state_, 27) * 5 + 0x52DCE729ull;
+		}
+
+	public:
+		/**
+		 * @brief Feeds raw bytes into the hash.
+		 *
+		 * @param data Pointer to the bytes to hash. May be null when `length` is 0.
+		 * @param length Number of bytes to hash.
+		 */
+		void update(const void* data, std::size_t length)
+		{
+			auto bytes{ static_cast<const unsigned char*>(data) };
+			total_length_ += length;
+
+			while (pending_length_ > 0 && pending_length_ < 8 && length > 0)
+			{
+				pending_[pending_length_++] = *bytes++;
+				length--;
+			}
+			if (pending_length_ == 8)
+			{
+				mix_word(load_little_endian(pending_));
+				pending_length_ = 0;
+			}
+
+			for (; length >= 8; bytes += 8, length -= 8)
+			{
+				mix_word(load_little_endian(bytes));
+			}
+
+			while (length > 0 && pending_length_ < 8)
+			{
+				pending_[pending_length_++] = *bytes++;
+				length--;
+			}
+		}
+
+		/**
+		 * @brief Feeds an integral or enum value into the hash in little-endian byte order.
+		 */
+		template <typename T>
+			requires std::is_integral_v<T> || std::is_enum_v<T>
+		void update_value(const T value)
+		{
+			auto bits{ [&]
+			{
+				if constexpr (std::is_enum_v<T>) { return static_cast<std::make_unsigned_t<std::underlying_type_t<T>>>(value); }
+				else { return static_cast<std::make_unsigned_t<T>>(value); }
+			}() };
+			unsigned char bytes[sizeof(T)]{};
+			for (auto& byte : bytes)
+			{
+				byte = static_cast<unsigned char>(bits & 0xFF);
+				if constexpr (sizeof(T) > 1) { bits >>= 8; }
+			}
+			update(bytes, sizeof(T));
+		}
+
+		/**
+		 * @brief Feeds a string's length and characters into the hash.
+		 */
+		void update_string(const std::string_view text)
+		{
+			update_value(static_cast<std::uint64_t>(text.size()));
+			update(text.data(), text.size());
+		}
+
+		/**
+		 * @brief Returns the digest of everything fed so far. The hasher can keep being updated afterwards.
+		 */
+		[[nodiscard]] std::uint64_t digest() const
+		{
+			std::uint64_t hash{ state_ };
+			if (pending_length_ > 0)
+			{
+				unsigned char tail[8]{};
+				for (std::size_t i = 0; i < pending_length_; i++) { tail[i] = pending_[i]; }
+				std::uint64_t word{ load_little_endian(tail) };
+				word *= 0x87C37B91114253D5ull;
+				word = rotate_left(word, 31);
+				word *= 0x4CF5AD432745937Full;
+				hash ^= word;
+			}
+
+			hash ^= total_length_;
+			hash ^= hash >> 33;
+			hash *= 0xFF51AFD7ED558CCDull;
+			hash ^= hash >> 33;
+			hash *= 0xC4CEB9FE1A85EC53ull;
+			hash ^= hash >> 33;
+			return hash;
+		}
+	};
+
+	/**
+	 * @brief Hashes the contents of a file with `content_hasher`.
+	 *
+	 * @return true if the file could be read, false otherwise.
+	 */
+	inline bool hash_file(const std::filesystem::path& path, std::uint64_t& hash)
+	{
+		std::ifstream file{ path, std::ios::binary };
+		if (!file)
+		{
+			return false;
+		}
+
+		content_hasher hasher{};
+		std::vector<char> chunk(1 << 16);
+		while (file)
+		{
+			file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+			hasher.update(chunk.data(), static_cast<std::size_t>(file.gcount()));
+		}
+		if (file.bad())
+		{
+			return false;
+		}
+		hash = hasher.digest();
+		return true;
+	}
+}
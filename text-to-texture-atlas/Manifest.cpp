@@ -0,0 +1,445 @@
+#include "Manifest.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <fstream>
+
+#include "Hash.hpp"
+
+namespace
+{
+	std::string_view trim(std::string_view text)
+	{
+		const auto first{ text.find_first_not_of(" \t\r") };
+		if (first == std::string_view::npos)
+		{
+			return {};
+		}
+		const auto last{ text.find_last_not_of(" \t\r") };
+		return text.substr(first, last - first + 1);
+	}
+
+	std::string_view strip_comment(std::string_view text)
+	{
+		const auto comment{ text.find_first_of("#;") };
+		return comment == std::string_view::npos ? text : text.substr(0, comment);
+	}
+
+	template <typename T>
+	bool parse_number(std::string_view text, T& result, const int base = 10)
+	{
+		text = trim(text);
+		const auto [end, ec] { std::from_chars(text.data(), text.data() + text.size(), result, base) };
+		return ec == std::errc{} && end == text.data() + text.size() && !text.empty();
+	}
+
+	bool parse_float(std::string_view text, float& result)
+	{
+		text = trim(text);
+		const auto [end, ec] { std::from_chars(text.data(), text.data() + text.size(), result) };
+		return ec == std::errc{} && end == text.data() + text.size() && !text.empty();
+	}
+
+	// Accepts U+XXXX, 0xXX or a decimal number.
+	bool parse_codepoint(std::string_view text, char32_t& result)
+	{
+		text = trim(text);
+		std::uint32_t value{};
+		bool parsed{};
+		if (text.starts_with("U+") || text.starts_with("u+") || text.starts_with("0x") || text.starts_with("0X"))
+		{
+			parsed = parse_number(text.substr(2), value, 16);
+		}
+		else
+		{
+			parsed = parse_number(text, value);
+		}
+		if (!parsed || value > 0x10FFFF)
+		{
+			return false;
+		}
+		result = static_cast<char32_t>(value);
+		return true;
+	}
+
+	template <typename Enum, std::size_t Count>
+	bool parse_enum(const std::string_view text, const std::pair<std::string_view, Enum>(&names)[Count], Enum& result)
+	{
+		for (const auto& [name, value] : names)
+		{
+			if (name == text)
+			{
+				result = value;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	constexpr std::pair<std::string_view, text_to_texture_atlas::atlas_format> format_names[]{
+		{ "rgba8", text_to_texture_atlas::atlas_format::rgba8 },
+		{ "r8", text_to_texture_atlas::atlas_format::r8 } };
+	constexpr std::pair<std::string_view, text_to_texture_atlas::atlas_packer> packer_names[]{
+		{ "grid", text_to_texture_atlas::atlas_packer::grid },
+		{ "shelf", text_to_texture_atlas::atlas_packer::shelf } };
+	constexpr std::pair<std::string_view, text_to_texture_atlas::placement_order> order_names[]{
+		{ "codepoint", text_to_texture_atlas::placement_order::codepoint },
+		{ "size", text_to_texture_atlas::placement_order::size } };
+	constexpr std::pair<std::string_view, text_to_texture_atlas::rasterizer_backend> rasterizer_names[]{
+		{ "freetype", text_to_texture_atlas::rasterizer_backend::freetype },
+		{ "scanline", text_to_texture_atlas::rasterizer_backend::scanline } };
+	constexpr std::pair<std::string_view, text_to_texture_atlas::effect_packing> packing_names[]{
+		{ "channels", text_to_texture_atlas::effect_packing::channels },
+		{ "variants", text_to_texture_atlas::effect_packing::variants } };
+	constexpr std::pair<std::string_view, bool> switch_names[]{
+		{ "no", false },
+		{ "yes", true } };
+}
+
+#pragma region parse_charset
+bool text_to_texture_atlas::baker::parse_charset(std::string_view spec, std::vector<codepoint_range>& result)
+{
+	result.clear();
+	while (!spec.empty())
+	{
+		const auto comma{ spec.find(',') };
+		const auto item{ trim(spec.substr(0, comma)) };
+		spec = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+
+		if (item == "ascii")
+		{
+			result.push_back({ 32, 126 });
+			continue;
+		}
+		if (item == "latin1")
+		{
+			result.push_back({ 32, 126 });
+			result.push_back({ 160, 255 });
+			continue;
+		}
+
+		codepoint_range range{};
+		const auto dash{ item.find('-') };
+		if (dash == std::string_view::npos)
+		{
+			if (!parse_codepoint(item, range.first)) { return false; }
+			range.last = range.first;
+		}
+		else if (!parse_codepoint(item.substr(0, dash), range.first) || !parse_codepoint(item.substr(dash + 1), range.last) || range.last < range.first)
+		{
+			return false;
+		}
+		result.push_back(range);
+	}
+	return !result.empty();
+}
+#pragma endregion
+
+#pragma region parse_variation
+bool text_to_texture_atlas::baker::parse_variation(std::string_view spec, std::vector<variation_coordinate>& result)
+{
+	result.clear();
+	while (!spec.empty())
+	{
+		const auto comma{ spec.find(',') };
+		const auto item{ trim(spec.substr(0, comma)) };
+		spec = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+
+		const auto colon{ item.find(':') };
+		const auto tag_text{ trim(item.substr(0, colon)) };
+		if (colon == std::string_view::npos || tag_text.size() != 4)
+		{
+			return false;
+		}
+		const char tag[5]{ tag_text[0], tag_text[1], tag_text[2], tag_text[3], '\0' };
+		float value{};
+		if (!parse_float(item.substr(colon + 1), value))
+		{
+			return false;
+		}
+		result.push_back({ .tag = axis_tag(tag), .value = value });
+	}
+	return true;
+}
+#pragma endregion
+
+#pragma region parse_size
+bool text_to_texture_atlas::baker::parse_size(std::string_view spec, size_spec& result)
+{
+	spec = trim(spec);
+	if (spec.starts_with("px:"))
+	{
+		result.unit = size_unit::px;
+		const auto dimensions{ spec.substr(3) };
+		const auto x{ dimensions.find('x') };
+		if (x == std::string_view::npos)
+		{
+			result.width_px = 0;
+			return parse_number(dimensions, result.height_px) && result.height_px > 0;
+		}
+		return parse_number(dimensions.substr(0, x), result.width_px) && parse_number(dimensions.substr(x + 1), result.height_px) && result.height_px > 0;
+	}
+
+	if (spec.starts_with("pt:"))
+	{
+		result.unit = size_unit::pt;
+		const auto size_and_dpi{ spec.substr(3) };
+		const auto at{ size_and_dpi.find('@') };
+		if (at == std::string_view::npos)
+		{
+			return false;
+		}
+
+		double points{};
+		const auto points_text{ trim(size_and_dpi.substr(0, at)) };
+		const auto [end, ec] { std::from_chars(points_text.data(), points_text.data() + points_text.size(), points) };
+		if (ec != std::errc{} || end != points_text.data() + points_text.size() || points <= 0.0)
+		{
+			return false;
+		}
+		result.pt_size = static_cast<signed long>(points * 64.0 + 0.5);
+
+		const auto dpi{ size_and_dpi.substr(at + 1) };
+		const auto x{ dpi.find('x') };
+		if (x == std::string_view::npos)
+		{
+			if (!parse_number(dpi, result.width_dpi)) { return false; }
+			result.height_dpi = result.width_dpi;
+			return true;
+		}
+		return parse_number(dpi.substr(0, x), result.width_dpi) && parse_number(dpi.substr(x + 1), result.height_dpi);
+	}
+
+	return false;
+}
+#pragma endregion
+
+#pragma region parse_manifest
+bool text_to_texture_atlas::baker::parse_manifest(const std::filesystem::path& path, manifest& result, std::string& error)
+{
+	std::ifstream file{ path };
+	if (!file)
+	{
+		error = path.string() + ": cannot open manifest";
+		return false;
+	}
+
+	const auto base_directory{ std::filesystem::absolute(path).parent_path() };
+	result.path = path;
+	result.entries.clear();
+
+	manifest_entry defaults{};
+	std::filesystem::path output_directory{ base_directory };
+	std::vector<bool> has_output{};
+
+	const auto fail = [&](const std::size_t line, const std::string& message)
+	{
+		error = path.string() + ":" + std::to_string(line) + ": " + message;
+		return false;
+	};
+
+	std::string raw_line{};
+	std::size_t line_number{};
+	while (std::getline(file, raw_line))
+	{
+		line_number++;
+		const auto line{ trim(strip_comment(raw_line)) };
+		if (line.empty())
+		{
+			continue;
+		}
+
+		if (line.front() == '[')
+		{
+			if (line.back() != ']' || line.size() < 3)
+			{
+				return fail(line_number, "malformed section header");
+			}
+			manifest_entry entry{ defaults };
+			entry.name = std::string{ trim(line.substr(1, line.size() - 2)) };
+			entry.line = line_number;
+			for (const auto& existing : result.entries)
+			{
+				if (existing.name == entry.name)
+				{
+					return fail(line_number, "duplicate entry '" + entry.name + "'");
+				}
+			}
+			result.entries.push_back(std::move(entry));
+			has_output.push_back(false);
+			continue;
+		}
+
+		const auto equals{ line.find('=') };
+		if (equals == std::string_view::npos)
+		{
+			return fail(line_number, "expected 'key = value'");
+		}
+		const auto key{ trim(line.substr(0, equals)) };
+		const auto value{ trim(line.substr(equals + 1)) };
+		auto& target{ result.entries.empty() ? defaults : result.entries.back() };
+
+		if (key == "output_dir" && result.entries.empty())
+		{
+			output_directory = base_directory / std::filesystem::path{ value };
+		}
+		else if (key == "output" && !result.entries.empty())
+		{
+			target.output = base_directory / std::filesystem::path{ value };
+			has_output.back() = true;
+		}
+		else
+		{
+			std::string setting_error{};
+			if (!apply_entry_setting(target, key, value, base_directory, setting_error))
+			{
+				return fail(line_number, setting_error);
+			}
+		}
+	}
+
+	if (result.entries.empty())
+	{
+		return fail(line_number, "no entries");
+	}
+
+	for (std::size_t i = 0; i < result.entries.size(); i++)
+	{
+		auto& entry{ result.entries[i] };
+		if (entry.font.empty())
+		{
+			return fail(entry.line, "entry '" + entry.name + "' has no font");
+		}
+		if (!has_output[i])
+		{
+			entry.output = output_directory / entry.name;
+		}
+		entry.output = std::filesystem::absolute(entry.output).lexically_normal();
+	}
+	return true;
+}
+#pragma endregion
+
+#pragma region apply_entry_setting
+bool text_to_texture_atlas::baker::apply_entry_setting
+(
+	manifest_entry& entry,
+	const std::string_view key,
+	const std::string_view value,
+	const std::filesystem::path& base_directory,
+	std::string& error
+)
+{
+	bool applied{ true };
+	if (key == "font")
+	{
+		entry.font = std::filesystem::absolute(base_directory / std::filesystem::path{ value }).lexically_normal();
+	}
+	else if (key == "size")
+	{
+		if (!parse_size(value, entry.size)) { error = "invalid size '" + std::string{ value } + "'"; applied = false; }
+	}
+	else if (key == "charset")
+	{
+		if (!parse_charset(value, entry.charset)) { error = "invalid charset '" + std::string{ value } + "'"; applied = false; }
+		else { entry.charset_spec = std::string{ value }; }
+	}
+	else if (key == "format")
+	{
+		if (!parse_enum(value, format_names, entry.format)) { error = "unknown format '" + std::string{ value } + "'"; applied = false; }
+	}
+	else if (key == "packer")
+	{
+		if (!parse_enum(value, packer_names, entry.packer)) { error = "unknown packer '" + std::string{ value } + "'"; applied = false; }
+	}
+	else if (key == "order")
+	{
+		if (!parse_enum(value, order_names, entry.order)) { error = "unknown order '" + std::string{ value } + "'"; applied = false; }
+	}
+	else if (key == "rasterizer")
+	{
+		if (!parse_enum(value, rasterizer_names, entry.rasterizer)) { error = "unknown rasterizer '" + std::string{ value } + "'"; applied = false; }
+	}
+	else if (key == "variation")
+	{
+		if (!parse_variation(value, entry.variation)) { error = "invalid variation '" + std::string{ value } + "'"; applied = false; }
+	}
+	else if (key == "embolden" || key == "oblique" || key == "outline")
+	{
+		auto& effect{ key == "embolden" ? entry.effects.embolden : key == "oblique" ? entry.effects.oblique : entry.effects.outline };
+		if (!parse_float(value, effect) || (key == "outline" && effect < 0.0f)) { error = "invalid " + std::string{ key } + " '" + std::string{ value } + "'"; applied = false; }
+	}
+	else if (key == "outline_packing")
+	{
+		if (!parse_enum(value, packing_names, entry.effects.packing)) { error = "unknown outline_packing '" + std::string{ value } + "'"; applied = false; }
+	}
+	else if (key == "vertical_metrics")
+	{
+		if (!parse_enum(value, switch_names, entry.vertical_metrics)) { error = "invalid vertical_metrics '" + std::string{ value } + "'"; applied = false; }
+	}
+	else
+	{
+		error = "unknown key '" + std::string{ key } + "'";
+		applied = false;
+	}
+	return applied;
+}
+#pragma endregion
+
+#pragma region to_build_options
+text_to_texture_atlas::build_options text_to_texture_atlas::baker::to_build_options(const manifest_entry& entry)
+{
+	build_options options{};
+	options.rasterizer = entry.rasterizer;
+	options.order = entry.order;
+	options.packer = entry.packer;
+	options.format = entry.format;
+	options.charset = entry.charset;
+	options.vertical_metrics = entry.vertical_metrics;
+	options.variation = entry.variation;
+	options.effects = entry.effects;
+	return options;
+}
+#pragma endregion
+
+#pragma region hash_entry_settings
+std::uint64_t text_to_texture_atlas::baker::hash_entry_settings(const manifest_entry& entry)
+{
+	content_hasher hasher{};
+	hasher.update_string(entry.font.generic_string());
+	hasher.update_value(entry.size.unit);
+	hasher.update_value(entry.size.width_px);
+	hasher.update_value(entry.size.height_px);
+	hasher.update_value(static_cast<std::int64_t>(entry.size.pt_size));
+	hasher.update_value(entry.size.width_dpi);
+	hasher.update_value(entry.size.height_dpi);
+	for (const auto& range : entry.charset)
+	{
+		hasher.update_value(static_cast<std::uint32_t>(range.first));
+		hasher.update_value(static_cast<std::uint32_t>(range.last));
+	}
+	hasher.update_value(entry.format);
+	hasher.update_value(entry.packer);
+	hasher.update_value(entry.order);
+	hasher.update_value(entry.rasterizer);
+	// Only hashed when set, so existing entries keep their stamps.
+	if (entry.vertical_metrics)
+	{
+		hasher.update_value(std::uint8_t{ 1 });
+	}
+	for (const auto& coordinate : entry.variation)
+	{
+		hasher.update_value(coordinate.tag);
+		hasher.update_value(std::bit_cast<std::uint32_t>(coordinate.value));
+	}
+	if (entry.effects.is_active())
+	{
+		hasher.update_value(std::bit_cast<std::uint32_t>(entry.effects.embolden));
+		hasher.update_value(std::bit_cast<std::uint32_t>(entry.effects.oblique));
+		hasher.update_value(std::bit_cast<std::uint32_t>(entry.effects.outline));
+		hasher.update_value(entry.effects.packing);
+	}
+	return hasher.digest();
+}
+#pragma endregion
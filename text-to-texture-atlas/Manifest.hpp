@@ -0,0 +1,146 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Font.hpp"
+
+namespace text_to_texture_atlas::baker
+{
+	/**
+	 * @brief
+	 * How an entry's font size is specified, mirroring the two `Font` factories.
+	 */
+	enum class size_unit
+	{
+		px,	///< Pixel sizing, built with `Font::Font_Px`.
+		pt	///< Point sizing with a DPI, built with `Font::Font_Pt`.
+	};
+
+	/**
+	 * @brief
+	 * A parsed `size = ...` value.
+	 */
+	struct size_spec
+	{
+		size_unit unit{ size_unit::px };
+		unsigned int width_px{ 0 };			///< Pixel width (0 = derived from the height).
+		unsigned int height_px{ 64 };		///< Pixel height.
+		signed long pt_size{ 64 * 64 };		///< Point size in 1/64 points, as passed to `FT_Set_Char_Size`.
+		unsigned int width_dpi{ 96 };		///< Horizontal DPI for point sizing.
+		unsigned int height_dpi{ 96 };		///< Vertical DPI for point sizing.
+	};
+
+	/**
+	 * @brief
+	 * One atlas to bake: a font at a size with a charset, format and packer.
+	 */
+	struct manifest_entry
+	{
+		std::string name{};							///< The entry's `[section]` name, unique within the manifest.
+		std::filesystem::path font{};				///< Absolute path to the font file.
+		size_spec size{};							///< The font size.
+		std::string charset_spec{ "ascii" };		///< The charset as written in the manifest.
+		std::vector<codepoint_range> charset{ { 32, 126 } };	///< The parsed charset.
+		atlas_format format{ atlas_format::rgba8 };	///< The atlas pixel layout.
+		atlas_packer packer{ atlas_packer::grid };	///< The packing algorithm.
+		placement_order order{ placement_order::codepoint };	///< The placement order.
+		rasterizer_backend rasterizer{ rasterizer_backend::freetype };	///< The rasterizer backend.
+		bool vertical_metrics{ false };				///< Whether glyphs also get vertical metrics.
+		std::vector<variation_coordinate> variation{};	///< Variable font design coordinates (empty = default instance).
+		glyph_effects effects{};					///< Synthetic bold, italic and outline effects.
+		std::filesystem::path output{};				///< Output path without extension; `.pam`, `.json` and `.stamp` are appended.
+		std::size_t line{};							///< The manifest line the entry starts on, for error messages.
+	};
+
+	/**
+	 * @brief
+	 * **A batch of atlases to bake, read from a manifest file.**
+	 *
+	 * @details
+	 * Manifests are INI-style text files. Keys before the first `[section]` are defaults for
+	 * every entry; each `[section]` starts a new entry that inherits those defaults. Relative
+	 * paths are resolved against the manifest's directory. `#` and `;` start comments.
+	 *
+	 * @code
+	 * # Defaults for every entry.
+	 * output_dir = build/atlases
+	 * charset = ascii
+	 *
+	 * [ui_regular_32]
+	 * font = fonts/Inter-Regular.ttf
+	 * size = px:32              # px:<height> | px:<width>x<height> | pt:<points>@<dpi> | pt:<points>@<xdpi>x<ydpi>
+	 * charset = latin1, U+20AC  # ascii | latin1 | <first>-<last> | <codepoint>, comma separated (U+XXXX, 0xXX or decimal)
+	 * format = r8               # rgba8 | r8
+	 * packer = shelf            # grid | shelf
+	 * order = size              # codepoint | size
+	 * rasterizer = scanline     # freetype | scanline
+	 * vertical_metrics = yes    # no | yes, also store metrics for vertical text
+	 * variation = wght:650      # <axis tag>:<design value>, comma separated, for variable fonts
+	 * embolden = 1              # pixels; oblique = <shear>, outline = <pixels>
+	 * outline_packing = channels # channels | variants
+	 * output = ui/regular_32    # optional, defaults to <output_dir>/<name>
+	 * @endcode
+	 */
+	struct manifest
+	{
+		std::filesystem::path path{};				///< The manifest file the entries were read from.
+		std::vector<manifest_entry> entries{};		///< The entries, in file order.
+	};
+
+	/**
+	 * @brief Reads and validates a manifest file.
+	 *
+	 * @param path The manifest file to read.
+	 * @param result Receives the parsed manifest.
+	 * @param error Receives a `file:line: message` description when parsing fails.
+	 *
+	 * @return true if the manifest was parsed, false otherwise.
+	 */
+	bool parse_manifest(const std::filesystem::path& path, manifest& result, std::string& error);
+
+	/**
+	 * @brief Parses a charset such as `ascii, U+4E00-U+4FFF` into codepoint ranges.
+	 *
+	 * @return true if every item was understood, false otherwise.
+	 */
+	bool parse_charset(std::string_view spec, std::vector<codepoint_range>& result);
+
+	/**
+	 * @brief Parses variable font coordinates such as `wght:650, wdth:87.5`.
+	 *
+	 * @return true if every item was understood, false otherwise.
+	 */
+	bool parse_variation(std::string_view spec, std::vector<variation_coordinate>& result);
+
+	/**
+	 * @brief Parses a size such as `px:32`, `px:24x32` or `pt:12@96` into a `size_spec`.
+	 *
+	 * @return true if the size was understood, false otherwise.
+	 */
+	bool parse_size(std::string_view spec, size_spec& result);
+
+	/**
+	 * @brief Applies one `key = value` setting (`font`, `size`, `charset`, `format`, `packer`,
+	 * `order`, `rasterizer`, `vertical_metrics`, `variation`, `embolden`, `oblique`, `outline` or
+	 * `outline_packing`) to an entry.
+	 *
+	 * @param base_directory The directory a relative `font` path is resolved against.
+	 * @param error Receives a description of the problem when the setting is rejected.
+	 *
+	 * @return true if the setting was applied, false if the key is unknown or the value invalid.
+	 */
+	bool apply_entry_setting(manifest_entry& entry, std::string_view key, std::string_view value, const std::filesystem::path& base_directory, std::string& error);
+
+	/**
+	 * @brief Converts an entry into the `build_options` its `Font` is built with.
+	 */
+	build_options to_build_options(const manifest_entry& entry);
+
+	/**
+	 * @brief Hashes every setting of an entry that affects its output, excluding the font file contents.
+	 */
+	std::uint64_t hash_entry_settings(const manifest_entry& entry);
+}
@@ -0,0 +1,88 @@
+#include "MemoryBudget.hpp"
+
+#include <utility>
+
+#pragma region memory_budget::constructors
+text_to_texture_atlas::memory_budget::memory_budget(const std::size_t limit)
+	: limit_(limit)
+{
+}
+#pragma endregion
+
+#pragma region memory_budget::try_reserve
+bool text_to_texture_atlas::memory_budget::try_reserve(const std::size_t bytes)
+{
+	std::size_t used{ used_.load() };
+	do
+	{
+		if (bytes > limit_ || used > limit_ - bytes)
+		{
+			return false;
+		}
+	} while (!used_.compare_exchange_weak(used, used + bytes));
+	return true;
+}
+#pragma endregion
+
+#pragma region memory_budget::release
+void text_to_texture_atlas::memory_budget::release(const std::size_t bytes)
+{
+	used_ -= bytes;
+}
+#pragma endregion
+
+#pragma region memory_budget::get_available
+std::size_t text_to_texture_atlas::memory_budget::get_available() const
+{
+	const std::size_t used{ used_ };
+	return used < limit_ ? limit_ - used : 0;
+}
+#pragma endregion
+
+#pragma region budget_reservation::constructors
+text_to_texture_atlas::budget_reservation::budget_reservation(memory_budget* budget)
+	: budget_(budget)
+{
+}
+
+text_to_texture_atlas::budget_reservation::~budget_reservation()
+{
+	resize(0);
+}
+
+text_to_texture_atlas::budget_reservation::budget_reservation(budget_reservation&& other) noexcept
+	: budget_(std::exchange(other.budget_, nullptr)),
+	bytes_(std::exchange(other.bytes_, 0))
+{
+}
+
+text_to_texture_atlas::budget_reservation& text_to_texture_atlas::budget_reservation::operator=(budget_reservation&& other) noexcept
+{
+	if (this != &other)
+	{
+		resize(0);
+		budget_ = std::exchange(other.budget_, nullptr);
+		bytes_ = std::exchange(other.bytes_, 0);
+	}
+	return *this;
+}
+#pragma endregion
+
+#pragma region budget_reservation::resize
+bool text_to_texture_atlas::budget_reservation::resize(const std::size_t bytes)
+{
+	if (budget_)
+	{
+		if (bytes > bytes_ && !budget_->try_reserve(bytes - bytes_))
+		{
+			return false;
+		}
+		if (bytes < bytes_)
+		{
+			budget_->release(bytes_ - bytes);
+		}
+	}
+	bytes_ = bytes;
+	return true;
+}
+#pragma endregion
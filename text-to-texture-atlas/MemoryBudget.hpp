@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+namespace text_to_texture_atlas
+{
+	/**
+	 * @brief
+	 * **A byte limit shared by every `Font` that is given it, e.g. one per process or container.**
+	 *
+	 * @details
+	 * Fonts reserve their estimated peak before allocating the atlas and keep a reservation for
+	 * the memory they hold afterwards, which shrinks when buffers are freed and is returned when
+	 * the font is destroyed. Reservations are atomic, so fonts may be built concurrently.
+	 *
+	 * @code
+	 * text_to_texture_atlas::memory_budget budget{ 64 * 1024 * 1024 };	// 64 MiB for all fonts.
+	 *
+	 * text_to_texture_atlas::build_options options{};
+	 * options.memory.shared = &budget;
+	 * auto font = text_to_texture_atlas::Font::Font_Px("arial.ttf", 128, 0, options);
+	 * @endcode
+	 *
+	 * @note The budget must outlive every font that holds a reservation on it.
+	 */
+	class memory_budget
+	{
+		std::size_t limit_{};				// The byte limit.
+		std::atomic<std::size_t> used_{};	// Bytes currently reserved.
+
+	public:
+		explicit memory_budget(std::size_t limit);
+		memory_budget(const memory_budget&) = delete;
+		memory_budget& operator=(const memory_budget&) = delete;
+
+		/**
+		 * @brief Reserves `bytes` if they fit under the limit.
+		 *
+		 * @return true if the bytes were reserved, false if nothing was reserved.
+		 */
+		bool try_reserve(std::size_t bytes);
+
+		/// Returns previously reserved bytes.
+		void release(std::size_t bytes);
+
+		/// Returns the byte limit.
+		inline std::size_t get_limit() const { return limit_; }
+
+		/// Returns the bytes currently reserved.
+		inline std::size_t get_used() const { return used_; }
+
+		/// Returns the bytes that can still be reserved.
+		std::size_t get_available() const;
+	};
+
+	/**
+	 * @brief
+	 * A move-only reservation on a `memory_budget`, returned when destroyed.
+	 */
+	class budget_reservation
+	{
+		memory_budget* budget_{};	// The budget reserved from, null for an unlimited reservation.
+		std::size_t bytes_{};		// Bytes currently reserved.
+
+	public:
+		budget_reservation() = default;
+		explicit budget_reservation(memory_budget* budget);
+		~budget_reservation();
+		budget_reservation(budget_reservation&& other) noexcept;
+		budget_reservation& operator=(budget_reservation&& other) noexcept;
+		budget_reservation(const budget_reservation&) = delete;
+		budget_reservation& operator=(const budget_reservation&) = delete;
+
+		/**
+		 * @brief Grows or shrinks the reservation to `bytes`. Shrinking always succeeds.
+		 *
+		 * @return true if the reservation now holds `bytes`, false if growing did not fit (the
+		 * reservation is unchanged).
+		 */
+		bool resize(std::size_t bytes);
+
+		/// Returns the bytes currently reserved.
+		inline std::size_t get_bytes() const { return bytes_; }
+	};
+}
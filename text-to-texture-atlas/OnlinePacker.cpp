@@ -0,0 +1,310 @@
+#include "OnlinePacker.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+	using free_range_map = std::map<unsigned int, unsigned int>;					// Start -> length.
+	using free_range_sizes = std::set<std::pair<unsigned int, unsigned int>>;		// The same ranges as (length, start).
+
+	// Adds `[start, start + length)` to a map of free ranges, merging it with the ranges it touches.
+	void add_free_range(free_range_map& ranges, free_range_sizes& sizes, const unsigned int start, const unsigned int length)
+	{
+		unsigned int merged_start{ start };
+		unsigned int merged_length{ length };
+		auto next{ ranges.lower_bound(start) };
+		if (next != ranges.end() && next->first == start + length)
+		{
+			merged_length += next->second;
+			sizes.erase({ next->second, next->first });
+			next = ranges.erase(next);
+		}
+		if (next != ranges.begin())
+		{
+			const auto previous{ std::prev(next) };
+			if (previous->first + previous->second == start)
+			{
+				merged_start = previous->first;
+				merged_length += previous->second;
+				sizes.erase({ previous->second, previous->first });
+				ranges.erase(previous);
+			}
+		}
+		ranges.emplace(merged_start, merged_length);
+		sizes.emplace(merged_length, merged_start);
+	}
+
+	// Takes `length` from the start of the free range at `start`, keeping the rest free.
+	void take_free_range(free_range_map& ranges, free_range_sizes& sizes, const unsigned int start, const unsigned int length)
+	{
+		const auto range{ ranges.find(start) };
+		const unsigned int remaining{ range->second - length };
+		sizes.erase({ range->second, start });
+		ranges.erase(range);
+		if (remaining)
+		{
+			ranges.emplace(start + length, remaining);
+			sizes.emplace(remaining, start + length);
+		}
+	}
+
+	// Returns the width of a shelf's widest free span, 0 if it is full.
+	unsigned int get_widest_span(const text_to_texture_atlas::online_packer::shelf& target)
+	{
+		return target.free_span_sizes.empty() ? 0 : target.free_span_sizes.rbegin()->first;
+	}
+}
+
+#pragma region constructor
+text_to_texture_atlas::online_packer::online_packer
+(
+	const unsigned int width,
+	const unsigned int height,
+	const online_packer_settings& settings
+)
+	: width_(width),
+	height_(height),
+	settings_(settings)
+{
+	reset();
+}
+#pragma endregion
+
+#pragma region reset
+void text_to_texture_atlas::online_packer::reset()
+{
+	state_ = {};
+	const unsigned int spacing{ settings_.spacing };
+	if (width_ > spacing * 2 && height_ > spacing * 2)
+	{
+		add_free_range(state_.free_rows, state_.free_row_sizes, spacing, height_ - spacing);
+	}
+}
+#pragma endregion
+
+#pragma region get_shelf_height
+unsigned int text_to_texture_atlas::online_packer::get_shelf_height
+(
+	const unsigned int height
+) const
+{
+	const unsigned int step{ std::max(settings_.shelf_height_step, 1u) };
+	return (height + step - 1) / step * step;
+}
+#pragma endregion
+
+#pragma region reindex_shelf
+void text_to_texture_atlas::online_packer::reindex_shelf
+(
+	const unsigned int top,
+	const shelf& target,
+	const unsigned int previous_widest
+)
+{
+	const unsigned int widest{ get_widest_span(target) };
+	if (widest == previous_widest)
+	{
+		return;
+	}
+	state_.shelf_index.erase({ target.height, previous_widest, top });
+	if (widest)
+	{
+		state_.shelf_index.emplace(target.height, widest, top);
+	}
+}
+#pragma endregion
+
+#pragma region find_span
+bool text_to_texture_atlas::online_packer::find_span
+(
+	const unsigned int lowest,
+	const unsigned int highest,
+	const unsigned int width,
+	unsigned int& shelf_top,
+	unsigned int& x
+) const
+{
+	// The first entry at or after (height, width) is a shelf of that height wide enough, or the
+	// height has none and the search moves on to the next height.
+	auto entry{ state_.shelf_index.lower_bound({ lowest, width, 0 }) };
+	while (entry != state_.shelf_index.end() && std::get<0>(*entry) <= highest)
+	{
+		const auto [height, widest, top] { *entry };
+		if (widest >= width)
+		{
+			const auto& sizes{ state_.shelves.at(top).free_span_sizes };
+			shelf_top = top;
+			x = sizes.lower_bound({ width, 0 })->second;
+			return true;
+		}
+		entry = state_.shelf_index.lower_bound({ height + 1, width, 0 });
+	}
+	return false;
+}
+#pragma endregion
+
+#pragma region find_free_rows
+bool text_to_texture_atlas::online_packer::find_free_rows
+(
+	const unsigned int rows,
+	unsigned int& top
+) const
+{
+	const auto gap{ state_.free_row_sizes.lower_bound({ rows, 0 }) };
+	if (gap == state_.free_row_sizes.end())
+	{
+		return false;
+	}
+	top = gap->second;
+	return true;
+}
+#pragma endregion
+
+#pragma region insert
+bool text_to_texture_atlas::online_packer::insert
+(
+	const unsigned int width,
+	const unsigned int height,
+	atlas_rect& rect
+)
+{
+	if (!width || !height)
+	{
+		rect = { .width = width, .height = height };
+		return true;
+	}
+
+	const unsigned int spacing{ settings_.spacing };
+	const unsigned int shelf_height{ get_shelf_height(height) };
+	const unsigned int padded_width{ width + spacing };
+	unsigned int top{};
+	unsigned int x{};
+
+	// A shelf of the rect's own height first, then a new shelf, and only once the page has no
+	// rows left a shelf up to twice as tall, which wastes rows but still fits the rect.
+	if (!find_span(shelf_height, shelf_height, padded_width, top, x))
+	{
+		if (padded_width <= width_ - spacing && find_free_rows(shelf_height + spacing, top))
+		{
+			take_free_range(state_.free_rows, state_.free_row_sizes, top, shelf_height + spacing);
+			auto& opened{ state_.shelves[top] };
+			opened.height = shelf_height;
+			add_free_range(opened.free_spans, opened.free_span_sizes, spacing, width_ - spacing);
+			state_.shelf_index.emplace(shelf_height, width_ - spacing, top);
+			x = spacing;
+		}
+		else if (!find_span(shelf_height + 1, shelf_height * 2, padded_width, top, x))
+		{
+			return false;
+		}
+	}
+
+	auto& target{ state_.shelves.at(top) };
+	const unsigned int previous_widest{ get_widest_span(target) };
+	take_free_range(target.free_spans, target.free_span_sizes, x, padded_width);
+	reindex_shelf(top, target, previous_widest);
+	target.rects.emplace(x, width);
+	state_.rect_count++;
+	state_.used_area += static_cast<unsigned long long>(width) * height;
+	state_.reserved_area += static_cast<unsigned long long>(padded_width) * (target.height + spacing);
+	rect = { .x = x, .y = top, .width = width, .height = height };
+	return true;
+}
+#pragma endregion
+
+#pragma region remove
+bool text_to_texture_atlas::online_packer::remove
+(
+	const atlas_rect& rect
+)
+{
+	if (!rect.width || !rect.height)
+	{
+		return true;
+	}
+
+	const auto found_shelf{ state_.shelves.find(rect.y) };
+	if (found_shelf == state_.shelves.end())
+	{
+		return false;
+	}
+	auto& target{ found_shelf->second };
+	const auto placed{ target.rects.find(rect.x) };
+	if (placed == target.rects.end() || placed->second != rect.width || rect.height > target.height)
+	{
+		return false;
+	}
+
+	const unsigned int spacing{ settings_.spacing };
+	const unsigned int padded_width{ rect.width + spacing };
+	const unsigned int previous_widest{ get_widest_span(target) };
+	target.rects.erase(placed);
+	add_free_range(target.free_spans, target.free_span_sizes, rect.x, padded_width);
+	state_.rect_count--;
+	state_.used_area -= static_cast<unsigned long long>(rect.width) * rect.height;
+	state_.reserved_area -= static_cast<unsigned long long>(padded_width) * (target.height + spacing);
+
+	// An empty shelf is closed so its rows can hold shelves of any height.
+	if (target.rects.empty())
+	{
+		state_.shelf_index.erase({ target.height, previous_widest, rect.y });
+		add_free_range(state_.free_rows, state_.free_row_sizes, rect.y, target.height + spacing);
+		state_.shelves.erase(found_shelf);
+	}
+	else
+	{
+		reindex_shelf(rect.y, target, previous_widest);
+	}
+	return true;
+}
+#pragma endregion
+
+#pragma region can_fit
+bool text_to_texture_atlas::online_packer::can_fit
+(
+	const unsigned int width,
+	const unsigned int height
+) const
+{
+	if (!width || !height)
+	{
+		return true;
+	}
+	const unsigned int spacing{ settings_.spacing };
+	const unsigned int shelf_height{ get_shelf_height(height) };
+	const unsigned int padded_width{ width + spacing };
+	unsigned int top{};
+	unsigned int x{};
+	return find_span(shelf_height, shelf_height, padded_width, top, x)
+		|| (padded_width <= width_ - spacing && find_free_rows(shelf_height + spacing, top))
+		|| find_span(shelf_height + 1, shelf_height * 2, padded_width, top, x);
+}
+#pragma endregion
+
+#pragma region clear
+void text_to_texture_atlas::online_packer::clear()
+{
+	reset();
+}
+#pragma endregion
+
+#pragma region get_free_area
+unsigned long long text_to_texture_atlas::online_packer::get_free_area() const
+{
+	const unsigned int spacing{ settings_.spacing };
+	if (width_ <= spacing * 2 || height_ <= spacing * 2)
+	{
+		return 0;
+	}
+	return static_cast<unsigned long long>(width_ - spacing) * (height_ - spacing) - state_.reserved_area;
+}
+#pragma endregion
+
+#pragma region get_occupancy
+double text_to_texture_atlas::online_packer::get_occupancy() const
+{
+	const unsigned long long page_area{ static_cast<unsigned long long>(width_) * height_ };
+	return page_area ? static_cast<double>(state_.used_area) / static_cast<double>(page_area) : 0.0;
+}
+#pragma endregion
@@ -0,0 +1,166 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <set>
+#include <tuple>
+#include <utility>
+
+#include "Packers.hpp"
+
+namespace text_to_texture_atlas
+{
+	/**
+	 * @brief
+	 * Controls the gaps and shelf sizes of an `online_packer`.
+	 */
+	struct online_packer_settings
+	{
+		/// Gap left between rects and around the edges, as the atlas packers do.
+		unsigned int spacing{ 5 };
+
+		/**
+		 * @brief Shelf heights are rounded up to a multiple of this.
+		 *
+		 * @details Rects whose heights round to the same value share shelves, so a larger step
+		 * wastes more rows per rect but lets more rects share a shelf.
+		 */
+		unsigned int shelf_height_step{ 8 };
+	};
+
+	/**
+	 * @brief
+	 * **Packs rects into a fixed-size page one at a time, and takes them back out.**
+	 *
+	 * @details
+	 * `pack_grid` and `pack_shelf` place a whole set at once. This packer serves atlases that
+	 * change at runtime: glyphs rendered on demand, icons and sprites loaded and unloaded with a
+	 * screen. The page is cut into horizontal shelves whose heights are multiples of
+	 * `shelf_height_step`. A rect goes into the narrowest free span wide enough on a shelf of its
+	 * rounded height, and a new shelf is opened in the shortest vertical gap tall enough if there
+	 * is none. Shelves with free space are indexed by height and widest free span, and free spans
+	 * and gaps by size, so an insert is a few O(log n) lookups; full shelves are left out of the
+	 * index. Only the fallback to a taller shelf looks up each shelf height it may use, which is
+	 * bounded by the page height, not by the rects placed.
+	 *
+	 * Removing a rect returns its span to its shelf and merges it with free neighbours. A shelf
+	 * left empty is closed, and its rows merge with the gaps around it so they can be reused for
+	 * shelves of any height.
+	 *
+	 * The whole layout is a value: `get_snapshot` copies it and `restore` puts it back, e.g. to try
+	 * inserting a batch and roll it back if it does not all fit.
+	 *
+	 * *Usage Example:*
+	 *
+	 * @code
+	 * text_to_texture_atlas::online_packer packer{ 1024, 1024 };
+	 *
+	 * text_to_texture_atlas::atlas_rect slot{};
+	 * if (packer.insert(icon.width, icon.height, slot)) {
+	 *     upload_sub_image(texture, slot, icon.pixels);
+	 * }
+	 * // When the icon is unloaded:
+	 * packer.remove(slot);
+	 * @endcode
+	 *
+	 * @warning This class is not thread-safe.
+	 */
+	class online_packer
+	{
+	public:
+		/**
+		 * @brief
+		 * One shelf: its height and the free spans left on it.
+		 */
+		struct shelf
+		{
+			unsigned int height{};						///< The shelf height, a multiple of `shelf_height_step`.
+			std::map<unsigned int, unsigned int> free_spans{};	///< Free spans, left edge -> width (gaps included).
+			std::set<std::pair<unsigned int, unsigned int>> free_span_sizes{};	///< The free spans as (width, left edge), for finding one wide enough.
+			std::map<unsigned int, unsigned int> rects{};		///< Rects placed on the shelf, left edge -> width.
+		};
+
+		/**
+		 * @brief
+		 * The complete layout, as returned by `get_snapshot` and accepted by `restore`.
+		 */
+		struct snapshot
+		{
+			std::map<unsigned int, shelf> shelves{};				///< Open shelves by top edge.
+			std::set<std::tuple<unsigned int, unsigned int, unsigned int>> shelf_index{};	///< (height, widest free span, top edge) of every shelf with free space, for finding one to insert into.
+			std::map<unsigned int, unsigned int> free_rows{};		///< Rows between shelves with no shelf, top edge -> height (gaps included).
+			std::set<std::pair<unsigned int, unsigned int>> free_row_sizes{};	///< The free rows as (height, top edge), for finding a gap tall enough.
+			std::size_t rect_count{};								///< The rects placed.
+			unsigned long long used_area{};							///< The area of the rects placed.
+			unsigned long long reserved_area{};						///< The area taken by the rects placed, gaps and shelf rounding included.
+		};
+
+	private:
+		unsigned int width_{};				// Page width in pixels.
+		unsigned int height_{};				// Page height in pixels.
+		online_packer_settings settings_{};
+		snapshot state_{};					// The layout.
+
+		unsigned int get_shelf_height(unsigned int height) const;						// Rounds a rect height up to its shelf height.
+		void reindex_shelf(unsigned int top, const shelf& target, unsigned int previous_widest);	// Moves a shelf's `shelf_index` entry after its free spans changed.
+		bool find_span																	// Finds a free span on an open shelf between the two heights.
+			(unsigned int lowest,
+				unsigned int highest,
+				unsigned int width,
+				unsigned int& shelf_top,
+				unsigned int& x) const;
+		bool find_free_rows(unsigned int rows, unsigned int& top) const;				// Finds the first gap with room for a new shelf.
+		void reset();																	// Empties the page.
+
+	public:
+		/**
+		 * @brief Creates an empty page.
+		 *
+		 * @param width The page width in pixels.
+		 * @param height The page height in pixels.
+		 * @param settings The gaps and shelf sizes.
+		 */
+		online_packer(unsigned int width, unsigned int height, const online_packer_settings& settings = {});
+
+		/**
+		 * @brief Places a rect.
+		 *
+		 * @param width The rect width in pixels.
+		 * @param height The rect height in pixels.
+		 * @param rect Receives where the rect was placed, with its size. An empty rect takes no space
+		 * and is always placed.
+		 *
+		 * @return true if the rect was placed, false if no free space is large enough (`rect` is unchanged).
+		 */
+		bool insert(unsigned int width, unsigned int height, atlas_rect& rect);
+
+		/**
+		 * @brief Frees a rect placed by `insert`, so its space can be reused.
+		 *
+		 * @return true if the rect was freed, false if it was not placed by `insert` or was already freed.
+		 */
+		bool remove(const atlas_rect& rect);
+
+		/// Returns true if `insert` would place a rect of this size, without placing it.
+		bool can_fit(unsigned int width, unsigned int height) const;
+
+		/// Frees every rect.
+		void clear();
+
+		/// Returns a copy of the layout, to be put back with `restore`.
+		inline const snapshot& get_snapshot() const { return state_; }
+
+		/// Puts back a layout returned by `get_snapshot` of a packer with the same size and settings.
+		inline void restore(const snapshot& layout) { state_ = layout; }
+
+		inline unsigned int get_width() const { return width_; }						// returns the page width in pixels.
+		inline unsigned int get_height() const { return height_; }						// returns the page height in pixels.
+		inline std::size_t get_rect_count() const { return state_.rect_count; }			// returns the number of rects placed.
+		inline unsigned long long get_used_area() const { return state_.used_area; }	// returns the area of the rects placed, in pixels.
+
+		/// Returns the area no rect reserves, in pixels. Gaps and shelf rounding count as reserved.
+		unsigned long long get_free_area() const;
+
+		/// Returns the area of the rects placed divided by the page area, from 0 to 1.
+		double get_occupancy() const;
+	};
+}
@@ -0,0 +1,90 @@
+#include "Packers.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#pragma region pack_grid
+bool text_to_texture_atlas::pack_grid
+(
+	const std::span<atlas_rect> rects,
+	const unsigned int cell_width,
+	const unsigned int cell_height,
+	unsigned int& atlas_width,
+	unsigned int& atlas_height,
+	const unsigned int spacing
+)
+{
+	const auto rect_count{ static_cast<double>(rects.size()) };
+	const unsigned int cells_per_side{ std::max(1u, static_cast<unsigned int>(std::ceil(std::sqrt(rect_count)))) };
+
+	// The grid starts one gap in, so nothing touches the atlas edge.
+	atlas_width = cells_per_side * (cell_width + spacing) + spacing * 2;
+	atlas_height = cells_per_side * (cell_height + spacing) + spacing * 2;
+
+	unsigned int x_position{ spacing };
+	unsigned int y_position{ spacing };
+	for (auto& rect : rects)
+	{
+		if (x_position + rect.width > atlas_width)
+		{
+			x_position = spacing;
+			y_position += cell_height + spacing;
+		}
+		if (y_position + rect.height > atlas_height)
+		{
+			return false;
+		}
+
+		rect.x = x_position;
+		rect.y = y_position;
+		x_position += cell_width + spacing;
+	}
+	return true;
+}
+#pragma endregion
+
+#pragma region pack_shelf
+bool text_to_texture_atlas::pack_shelf
+(
+	const std::span<atlas_rect> rects,
+	unsigned int& atlas_width,
+	unsigned int& atlas_height,
+	const unsigned int spacing
+)
+{
+	// Aim for a square atlas: the width is the square root of the total padded area, but never
+	// narrower than the widest rect.
+	unsigned long long total_area{};
+	unsigned int max_width{};
+	for (const auto& rect : rects)
+	{
+		total_area += static_cast<unsigned long long>(rect.width + spacing) * (rect.height + spacing);
+		max_width = std::max(max_width, rect.width);
+	}
+	atlas_width = std::max(
+		static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<double>(total_area)))) + spacing,
+		max_width + spacing * 2);
+
+	unsigned int x_position{ spacing };
+	unsigned int y_position{ spacing };
+	unsigned int shelf_height{};
+
+	for (auto& rect : rects)
+	{
+		if (x_position + rect.width + spacing > atlas_width)
+		{
+			x_position = spacing;
+			y_position += shelf_height + spacing;
+			shelf_height = 0;
+		}
+
+		rect.x = x_position;
+		rect.y = y_position;
+		x_position += rect.width + spacing;
+		shelf_height = std::max(shelf_height, rect.height);
+	}
+
+	atlas_height = y_position + shelf_height + spacing;
+	return true;
+}
+#pragma endregion
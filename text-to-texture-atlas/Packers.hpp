@@ -0,0 +1,69 @@
+#pragma once
+#include <span>
+
+namespace text_to_texture_atlas
+{
+	/**
+	 * @brief
+	 * A rectangle inside an atlas, in pixels.
+	 */
+	struct atlas_rect
+	{
+		unsigned int x{};		///< Left edge.
+		unsigned int y{};		///< Top edge.
+		unsigned int width{};	///< Width in pixels.
+		unsigned int height{};	///< Height in pixels.
+
+		bool operator==(const atlas_rect&) const = default;
+	};
+
+	/**
+	 * @brief
+	 * Places rects in a square grid of equal cells, in the order given. This is the packer behind
+	 * `atlas_packer::grid`.
+	 *
+	 * @details The grid has `ceil(sqrt(count))` columns and rows, so the atlas size depends only on
+	 * the cell size and the number of rects. Placement is fast and predictable, but every rect
+	 * takes a whole cell, so mixed glyph sizes leave most of the atlas empty.
+	 *
+	 * @param rects The rects to place; their `width` and `height` are read and `x` and `y` written.
+	 * @param cell_width The width of a cell, usually the widest rect.
+	 * @param cell_height The height of a cell, usually the tallest rect.
+	 * @param atlas_width Receives the atlas width.
+	 * @param atlas_height Receives the atlas height.
+	 * @param spacing Gap left between cells and around the edges.
+	 *
+	 * @return true if every rect was placed, false if one is larger than a cell.
+	 */
+	bool pack_grid(
+		std::span<atlas_rect> rects,
+		unsigned int cell_width,
+		unsigned int cell_height,
+		unsigned int& atlas_width,
+		unsigned int& atlas_height,
+		unsigned int spacing = 5
+	);
+
+	/**
+	 * @brief
+	 * Places rects left to right on shelves as tall as their tallest rect, in the order given. This
+	 * is the packer behind `atlas_packer::shelf`.
+	 *
+	 * @details The atlas width is the square root of the total padded area (but never narrower than
+	 * the widest rect), so the atlas comes out roughly square. Sorting the rects by height first,
+	 * as `placement_order::size` does, keeps the shelves tight.
+	 *
+	 * @param rects The rects to place; their `width` and `height` are read and `x` and `y` written.
+	 * @param atlas_width Receives the atlas width.
+	 * @param atlas_height Receives the atlas height.
+	 * @param spacing Gap left between rects and around the edges.
+	 *
+	 * @return true; every rect always fits.
+	 */
+	bool pack_shelf(
+		std::span<atlas_rect> rects,
+		unsigned int& atlas_width,
+		unsigned int& atlas_height,
+		unsigned int spacing = 5
+	);
+}
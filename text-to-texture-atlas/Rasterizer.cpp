@@ -0,0 +1,458 @@
+#include "Rasterizer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXT_TO_TEXTURE_ATLAS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Edges mark the accumulation cells they write in blocks of 2^block_shift, one SIMD step each.
+	constexpr unsigned int block_shift{ 3 };
+	constexpr unsigned int block_cells{ 1u << block_shift };
+	static_assert(block_cells == 8, "blocks are summed and filled 8 cells at a time");
+
+	// Narrower bitmaps have too little interior per row to repay marking the blocks.
+	constexpr unsigned int min_tracked_width{ 256 };
+
+	// A row is only skipped through when at most one block in this many was touched; otherwise
+	// the runs are too short and summing straight through is faster.
+	constexpr unsigned int sparse_row_ratio{ 4 };
+}
+
+#pragma region constructors
+text_to_texture_atlas::Rasterizer::Rasterizer(std::pmr::memory_resource* resource)
+	: accumulation_buffer_(resource),
+	coverage_buffer_(resource),
+	touched_blocks_(resource)
+{
+}
+#pragma endregion
+
+#pragma region move_to
+int text_to_texture_atlas::Rasterizer::move_to(const FT_Vector* to, void* user)
+{
+	auto& self{ *static_cast<Rasterizer*>(user) };
+	self.current_ = self.to_bitmap_space(*to);
+	return 0;
+}
+#pragma endregion
+
+#pragma region line_to
+int text_to_texture_atlas::Rasterizer::line_to(const FT_Vector* to, void* user)
+{
+	auto& self{ *static_cast<Rasterizer*>(user) };
+	const point next{ self.to_bitmap_space(*to) };
+	self.draw_line(self.current_, next);
+	self.current_ = next;
+	return 0;
+}
+#pragma endregion
+
+#pragma region conic_to
+int text_to_texture_atlas::Rasterizer::conic_to(const FT_Vector* control, const FT_Vector* to, void* user)
+{
+	auto& self{ *static_cast<Rasterizer*>(user) };
+	const point next{ self.to_bitmap_space(*to) };
+	self.draw_quadratic(self.current_, self.to_bitmap_space(*control), next);
+	self.current_ = next;
+	return 0;
+}
+#pragma endregion
+
+#pragma region cubic_to
+int text_to_texture_atlas::Rasterizer::cubic_to(const FT_Vector* control1, const FT_Vector* control2, const FT_Vector* to, void* user)
+{
+	auto& self{ *static_cast<Rasterizer*>(user) };
+	const point next{ self.to_bitmap_space(*to) };
+	self.draw_cubic(self.current_, self.to_bitmap_space(*control1), self.to_bitmap_space(*control2), next);
+	self.current_ = next;
+	return 0;
+}
+#pragma endregion
+
+#pragma region to_bitmap_space
+text_to_texture_atlas::Rasterizer::point text_to_texture_atlas::Rasterizer::to_bitmap_space(const FT_Vector& vector) const
+{
+	// Outline coordinates are 26.6 fixed point with y pointing up, the bitmap has y pointing down.
+	// Clamping keeps rounding noise on the control box edges inside the accumulation buffer.
+	const float x{ static_cast<float>(vector.x - origin_x_) / 64.0f };
+	const float y{ static_cast<float>(origin_y_ - vector.y) / 64.0f };
+	return point{
+		.x = std::clamp(x, 0.0f, static_cast<float>(width_)),
+		.y = std::clamp(y, 0.0f, static_cast<float>(height_))
+	};
+}
+#pragma endregion
+
+#pragma region draw_line
+void text_to_texture_atlas::Rasterizer::draw_line(point p0, point p1)
+{
+	if (std::abs(p0.y - p1.y) <= 1e-6f)
+	{
+		return;
+	}
+
+	float direction{ 1.0f };
+	if (p0.y > p1.y)
+	{
+		std::swap(p0, p1);
+		direction = -1.0f;
+	}
+
+	const float dxdy{ (p1.x - p0.x) / (p1.y - p0.y) };
+	float x{ p0.x };
+
+	const auto first_row{ static_cast<unsigned int>(p0.y) };
+	const auto last_row{ std::min(height_, static_cast<unsigned int>(std::ceil(p1.y))) };
+
+	for (unsigned int y = first_row; y < last_row; y++)
+	{
+		float* row{ accumulation_buffer_.data() + static_cast<size_t>(y) * stride_ };
+
+		const float dy{ std::min(static_cast<float>(y + 1), p1.y) - std::max(static_cast<float>(y), p0.y) };
+		// Rounding can carry the edge just outside the bitmap, which would write into the neighbouring rows.
+		const float x_next{ std::clamp(x + dxdy * dy, 0.0f, static_cast<float>(width_)) };
+		const float d{ dy * direction };
+
+		const float x0{ std::min(x, x_next) };
+		const float x1{ std::max(x, x_next) };
+		const float x0_floor{ std::floor(x0) };
+		const float x1_ceil{ std::ceil(x1) };
+		const auto x0i{ static_cast<int>(x0_floor) };
+		const auto x1i{ static_cast<int>(x1_ceil) };
+
+		// Both branches below write cells x0i through max(x0i + 1, x1i).
+		if (block_words_)
+		{
+			std::uint64_t* touched{ touched_blocks_.data() + static_cast<size_t>(y) * block_words_ };
+			const auto first_block{ static_cast<unsigned int>(x0i) >> block_shift };
+			const auto last_block{ static_cast<unsigned int>(std::max(x0i + 1, x1i)) >> block_shift };
+			if ((first_block >> 6) == (last_block >> 6))
+			{
+				touched[first_block >> 6] |= (~std::uint64_t{} >> (63 - (last_block - first_block))) << (first_block & 63);
+			}
+			else
+			{
+				for (auto block{ first_block }; block <= last_block; block++)
+				{
+					touched[block >> 6] |= std::uint64_t{ 1 } << (block & 63);
+				}
+			}
+		}
+
+		if (x1i <= x0i + 1)
+		{
+			// The edge stays within a single pixel column on this row.
+			const float x_mid{ 0.5f * (x + x_next) - x0_floor };
+			row[x0i] += d - d * x_mid;
+			row[x0i + 1] += d * x_mid;
+		}
+		else
+		{
+			// The edge crosses several columns, spread the area as a trapezoid.
+			const float s{ 1.0f / (x1 - x0) };
+			const float x0_fraction{ x0 - x0_floor };
+			const float a0{ 0.5f * s * (1.0f - x0_fraction) * (1.0f - x0_fraction) };
+			const float x1_fraction{ x1 - x1_ceil + 1.0f };
+			const float am{ 0.5f * s * x1_fraction * x1_fraction };
+
+			row[x0i] += d * a0;
+			if (x1i == x0i + 2)
+			{
+				row[x0i + 1] += d * (1.0f - a0 - am);
+			}
+			else
+			{
+				const float a1{ s * (1.5f - x0_fraction) };
+				row[x0i + 1] += d * (a1 - a0);
+				for (int xi = x0i + 2; xi < x1i - 1; xi++)
+				{
+					row[xi] += d * s;
+				}
+				const float a2{ a1 + static_cast<float>(x1i - x0i - 3) * s };
+				row[x1i - 1] += d * (1.0f - a2 - am);
+			}
+			row[x1i] += d * am;
+		}
+
+		x = x_next;
+	}
+}
+#pragma endregion
+
+#pragma region draw_quadratic
+void text_to_texture_atlas::Rasterizer::draw_quadratic(const point p0, const point p1, const point p2)
+{
+	// Pick the segment count from how far the control point bends the curve (font-rs heuristic).
+	const float dev_x{ p0.x - 2.0f * p1.x + p2.x };
+	const float dev_y{ p0.y - 2.0f * p1.y + p2.y };
+	const float dev_sq{ dev_x * dev_x + dev_y * dev_y };
+	if (dev_sq < 0.333f)
+	{
+		draw_line(p0, p2);
+		return;
+	}
+
+	const auto segments{ 1 + static_cast<int>(std::sqrt(std::sqrt(3.0f * dev_sq))) };
+	const float step{ 1.0f / static_cast<float>(segments) };
+
+	point previous{ p0 };
+	for (int i = 1; i <= segments; i++)
+	{
+		const float t{ step * static_cast<float>(i) };
+		const float mt{ 1.0f - t };
+		const point next{
+			.x = mt * mt * p0.x + 2.0f * mt * t * p1.x + t * t * p2.x,
+			.y = mt * mt * p0.y + 2.0f * mt * t * p1.y + t * t * p2.y
+		};
+		draw_line(previous, next);
+		previous = next;
+	}
+}
+#pragma endregion
+
+#pragma region draw_cubic
+void text_to_texture_atlas::Rasterizer::draw_cubic(const point p0, const point p1, const point p2, const point p3)
+{
+	// The second differences of the control polygon bound the curve's deviation from its chord.
+	const float dev1_x{ p0.x - 2.0f * p1.x + p2.x };
+	const float dev1_y{ p0.y - 2.0f * p1.y + p2.y };
+	const float dev2_x{ p1.x - 2.0f * p2.x + p3.x };
+	const float dev2_y{ p1.y - 2.0f * p2.y + p3.y };
+	const float dev_sq{ std::max(dev1_x * dev1_x + dev1_y * dev1_y, dev2_x * dev2_x + dev2_y * dev2_y) };
+	if (dev_sq < 0.333f)
+	{
+		draw_line(p0, p3);
+		return;
+	}
+
+	const auto segments{ 1 + static_cast<int>(std::sqrt(std::sqrt(6.75f * dev_sq))) };
+	const float step{ 1.0f / static_cast<float>(segments) };
+
+	point previous{ p0 };
+	for (int i = 1; i <= segments; i++)
+	{
+		const float t{ step * static_cast<float>(i) };
+		const float mt{ 1.0f - t };
+		const float c0{ mt * mt * mt };
+		const float c1{ 3.0f * mt * mt * t };
+		const float c2{ 3.0f * mt * t * t };
+		const float c3{ t * t * t };
+		const point next{
+			.x = c0 * p0.x + c1 * p1.x + c2 * p2.x + c3 * p3.x,
+			.y = c0 * p0.y + c1 * p1.y + c2 * p2.y + c3 * p3.y
+		};
+		draw_line(previous, next);
+		previous = next;
+	}
+}
+#pragma endregion
+
+#pragma region accumulate
+void text_to_texture_atlas::Rasterizer::accumulate()
+{
+	// Cells are zeroed as they are consumed, so the next render() starts from a clean buffer
+	// without paying for a separate clearing pass.
+	const unsigned int full_blocks{ width_ / block_cells };
+
+#ifdef TEXT_TO_TEXTURE_ATLAS_SSE2
+	// Inclusive prefix sum, four lanes per register: two shifted adds inside the register,
+	// then the running total of the previous block is broadcast in. Eight pixels are handled
+	// per step so only one add and one shuffle sit on the loop-carried `offset` chain.
+	// abs/min/scale/round match the scalar tail exactly.
+	const __m128 abs_mask{ _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)) };
+	const __m128 one{ _mm_set1_ps(1.0f) };
+	const __m128 scale{ _mm_set1_ps(255.0f) };
+	const __m128 half{ _mm_set1_ps(0.5f) };
+
+	const auto prefix_sum = [](__m128 v)
+	{
+		v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)));
+		return _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)));
+	};
+	const auto to_coverage = [&](const __m128 v)
+	{
+		const __m128 coverage{ _mm_min_ps(_mm_and_ps(v, abs_mask), one) };
+		return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(coverage, scale), half));
+	};
+#endif
+
+	// Sums cells [x, end) of a row onto `sum`, writing their coverage and zeroing them.
+	const auto sum_cells = [&](float* src, unsigned char* dst, unsigned int x, const unsigned int end, float& sum)
+	{
+#ifdef TEXT_TO_TEXTURE_ATLAS_SSE2
+		__m128 offset{ _mm_set1_ps(sum) };
+		for (; x + 8 <= end; x += 8)
+		{
+			__m128 low{ prefix_sum(_mm_loadu_ps(src + x)) };
+			__m128 high{ prefix_sum(_mm_loadu_ps(src + x + 4)) };
+			_mm_storeu_ps(src + x, _mm_setzero_ps());
+			_mm_storeu_ps(src + x + 4, _mm_setzero_ps());
+
+			high = _mm_add_ps(high, _mm_shuffle_ps(low, low, _MM_SHUFFLE(3, 3, 3, 3)));
+			low = _mm_add_ps(low, offset);
+			high = _mm_add_ps(high, offset);
+			offset = _mm_shuffle_ps(high, high, _MM_SHUFFLE(3, 3, 3, 3));
+
+			__m128i packed{ _mm_packs_epi32(to_coverage(low), to_coverage(high)) };
+			packed = _mm_packus_epi16(packed, packed);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x), packed);
+		}
+
+		for (; x + 4 <= end; x += 4)
+		{
+			__m128 v{ prefix_sum(_mm_loadu_ps(src + x)) };
+			_mm_storeu_ps(src + x, _mm_setzero_ps());
+			v = _mm_add_ps(v, offset);
+			offset = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+
+			__m128i packed{ to_coverage(v) };
+			packed = _mm_packs_epi32(packed, packed);
+			packed = _mm_packus_epi16(packed, packed);
+
+			const int bytes{ _mm_cvtsi128_si32(packed) };
+			std::memcpy(dst + x, &bytes, sizeof(bytes));
+		}
+		sum = _mm_cvtss_f32(offset);
+#endif
+
+		for (; x < end; x++)
+		{
+			sum += src[x];
+			src[x] = 0.0f;
+			const float coverage{ std::min(std::abs(sum), 1.0f) };
+			dst[x] = static_cast<unsigned char>(coverage * 255.0f + 0.5f);
+		}
+	};
+
+	for (unsigned int y = 0; y < height_; y++)
+	{
+		float* src{ accumulation_buffer_.data() + static_cast<size_t>(y) * stride_ };
+		unsigned char* dst{ coverage_buffer_.data() + static_cast<size_t>(y) * width_ };
+		const std::uint64_t* touched{ touched_blocks_.data() + static_cast<size_t>(y) * block_words_ };
+		float sum{};
+
+		// Skipping pays for itself only across long untouched runs; a row with many touched blocks
+		// is cheaper to sum straight through.
+		unsigned int touched_count{};
+		for (unsigned int word = 0; word < block_words_; word++)
+		{
+			touched_count += static_cast<unsigned int>(std::popcount(touched[word]));
+		}
+		const bool sparse{ block_words_ && touched_count * sparse_row_ratio <= full_blocks };
+
+		unsigned int block{};
+		while (sparse && block < full_blocks)
+		{
+			// Runs of untouched or touched blocks, up to the end of the word, are handled together.
+			const std::uint64_t word{ touched[block >> 6] >> (block & 63) };
+			const unsigned int word_end{ std::min(block - (block & 63) + 64, full_blocks) };
+			const unsigned int untouched{ std::min(static_cast<unsigned int>(std::countr_zero(word)), word_end - block) };
+			if (untouched)
+			{
+				// Runs are usually a few dozen pixels, too short to be worth a memset call.
+				const float coverage{ std::min(std::abs(sum), 1.0f) };
+				const auto value{ static_cast<unsigned char>(coverage * 255.0f + 0.5f) };
+#ifdef TEXT_TO_TEXTURE_ATLAS_SSE2
+				const __m128i values{ _mm_set1_epi8(static_cast<char>(value)) };
+				for (unsigned int x = block * block_cells; x < (block + untouched) * block_cells; x += block_cells)
+				{
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x), values);
+				}
+#else
+				std::memset(dst + block * block_cells, value, untouched * block_cells);
+#endif
+				block += untouched;
+				continue;
+			}
+
+			const unsigned int run_end{ std::min(block + static_cast<unsigned int>(std::countr_one(word)), word_end) };
+			sum_cells(src, dst, block * block_cells, run_end * block_cells, sum);
+			block = run_end;
+		}
+
+		// The rest of a dense row, or the last, partial block; then the two cells past the bitmap.
+		sum_cells(src, dst, block * block_cells, width_, sum);
+		src[width_] = 0.0f;
+		src[width_ + 1] = 0.0f;
+	}
+}
+#pragma endregion
+
+#pragma region render
+bool text_to_texture_atlas::Rasterizer::render(const FT_Outline& outline)
+{
+	// Size the bitmap the same way FreeType does for FT_RENDER_MODE_NORMAL.
+	FT_BBox cbox{};
+	FT_Outline_Get_CBox(&outline, &cbox);
+	cbox.xMin = cbox.xMin & ~63;
+	cbox.yMin = cbox.yMin & ~63;
+	cbox.xMax = (cbox.xMax + 63) & ~63;
+	cbox.yMax = (cbox.yMax + 63) & ~63;
+
+	width_ = static_cast<unsigned int>((cbox.xMax - cbox.xMin) >> 6);
+	height_ = static_cast<unsigned int>((cbox.yMax - cbox.yMin) >> 6);
+	stride_ = width_ + 2;
+	origin_x_ = cbox.xMin;
+	origin_y_ = cbox.yMax;
+	bitmap_left_ = static_cast<int>(cbox.xMin >> 6);
+	bitmap_top_ = static_cast<int>(cbox.yMax >> 6);
+
+	bitmap_ = FT_Bitmap{};
+	bitmap_.pixel_mode = FT_PIXEL_MODE_GRAY;
+	bitmap_.num_grays = 256;
+
+	if (outline.n_points == 0 || width_ == 0 || height_ == 0)
+	{
+		width_ = 0;
+		height_ = 0;
+		return true;
+	}
+
+	const size_t accumulation_size{ static_cast<size_t>(stride_) * height_ };
+	if (accumulation_buffer_.size() < accumulation_size)
+	{
+		accumulation_buffer_.resize(accumulation_size, 0.0f);
+	}
+	coverage_buffer_.resize(static_cast<size_t>(width_) * height_);
+	block_words_ = width_ >= min_tracked_width ? (stride_ + 64 * block_cells - 1) / (64 * block_cells) : 0;
+	touched_blocks_.assign(static_cast<size_t>(block_words_) * height_, 0);
+
+	FT_Outline_Funcs funcs{};
+	funcs.move_to = &Rasterizer::move_to;
+	funcs.line_to = &Rasterizer::line_to;
+	funcs.conic_to = &Rasterizer::conic_to;
+	funcs.cubic_to = &Rasterizer::cubic_to;
+
+	if (FT_Outline_Decompose(const_cast<FT_Outline*>(&outline), &funcs, this))
+	{
+		std::fill_n(accumulation_buffer_.begin(), accumulation_size, 0.0f);
+		return false;
+	}
+
+	accumulate();
+
+	bitmap_.rows = height_;
+	bitmap_.width = width_;
+	bitmap_.pitch = static_cast<int>(width_);
+	bitmap_.buffer = coverage_buffer_.data();
+	return true;
+}
+#pragma endregion
+
+#pragma region release
+void text_to_texture_atlas::Rasterizer::release()
+{
+	// Moving from an empty vector with the same resource frees the storage; swap would need equal allocators anyway.
+	accumulation_buffer_ = std::pmr::vector<float>{ accumulation_buffer_.get_allocator() };
+	coverage_buffer_ = std::pmr::vector<unsigned char>{ coverage_buffer_.get_allocator() };
+	touched_blocks_ = std::pmr::vector<std::uint64_t>{ touched_blocks_.get_allocator() };
+	bitmap_ = {};
+}
+#pragma endregion
@@ -0,0 +1,564 @@
+#include "Service.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iterator>
+#include <list>
+#include <ranges>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "Font.hpp"
+#include "Hash.hpp"
+
+namespace
+{
+	constexpr std::size_t max_request_length{ 64 * 1024 };	// Longer lines are rejected and the connection closed.
+	constexpr unsigned int max_request_pixels{ 2048 };		// Larger glyph sizes are rejected; one such atlas can exhaust memory.
+	constexpr std::uint64_t max_request_codepoints{ 0x30000 };	// Larger charsets are rejected (the BMP plus two supplementary planes).
+
+	std::string_view trim(std::string_view text)
+	{
+		const auto first{ text.find_first_not_of(" \t\r\n") };
+		if (first == std::string_view::npos)
+		{
+			return {};
+		}
+		const auto last{ text.find_last_not_of(" \t\r\n") };
+		return text.substr(first, last - first + 1);
+	}
+
+	std::string to_hex(const std::uint64_t value)
+	{
+		std::ostringstream stream{};
+		stream << std::hex << std::setw(16) << std::setfill('0') << value;
+		return stream.str();
+	}
+
+	// Parses `font=...; size=...; ...` into an entry, with the same keys and values as a manifest.
+	bool parse_build_request(std::string_view settings, text_to_texture_atlas::baker::manifest_entry& entry, std::string& error)
+	{
+		while (!settings.empty())
+		{
+			const auto separator{ settings.find(';') };
+			const auto item{ trim(settings.substr(0, separator)) };
+			settings = separator == std::string_view::npos ? std::string_view{} : settings.substr(separator + 1);
+			if (item.empty())
+			{
+				continue;
+			}
+
+			const auto equals{ item.find('=') };
+			if (equals == std::string_view::npos)
+			{
+				error = "expected 'key=value', got '" + std::string{ item } + "'";
+				return false;
+			}
+			const auto key{ trim(item.substr(0, equals)) };
+			const auto value{ trim(item.substr(equals + 1)) };
+			if (key == "font" && !std::filesystem::path{ value }.is_absolute())
+			{
+				error = "font must be an absolute path";
+				return false;
+			}
+			if (!text_to_texture_atlas::baker::apply_entry_setting(entry, key, value, {}, error))
+			{
+				return false;
+			}
+		}
+		if (entry.font.empty())
+		{
+			error = "no font";
+			return false;
+		}
+
+		// Requests come from any local process, so sizes that would build gigabytes are refused up front.
+		const auto& size{ entry.size };
+		const auto pixels = size.unit == text_to_texture_atlas::baker::size_unit::pt
+			? static_cast<std::uint64_t>(size.pt_size > 0 ? size.pt_size : 0) * std::max(size.width_dpi, size.height_dpi) / (64 * 72)
+			: static_cast<std::uint64_t>(std::max(size.width_px, size.height_px));
+		if (pixels > max_request_pixels)
+		{
+			error = "size too large, at most " + std::to_string(max_request_pixels) + " px";
+			return false;
+		}
+		std::uint64_t codepoints{};
+		for (const auto& range : entry.charset)
+		{
+			codepoints += range.last >= range.first ? static_cast<std::uint64_t>(range.last - range.first) + 1 : 0;
+		}
+		if (codepoints > max_request_codepoints)
+		{
+			error = "charset too large, at most " + std::to_string(max_request_codepoints) + " codepoints";
+			return false;
+		}
+		return true;
+	}
+
+#ifndef _WIN32
+	bool make_address(const std::filesystem::path& socket_path, sockaddr_un& address)
+	{
+		const auto path{ socket_path.string() };
+		address = {};
+		address.sun_family = AF_UNIX;
+		if (path.empty() || path.size() >= sizeof(address.sun_path))
+		{
+			return false;
+		}
+		std::copy(path.begin(), path.end(), address.sun_path);
+		return true;
+	}
+
+	bool send_all(const int socket, std::string_view data)
+	{
+		while (!data.empty())
+		{
+			const auto sent{ send(socket, data.data(), data.size(), MSG_NOSIGNAL) };
+			if (sent < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (sent <= 0)
+			{
+				return false;
+			}
+			data.remove_prefix(static_cast<std::size_t>(sent));
+		}
+		return true;
+	}
+
+	// Answers request lines until the peer disconnects, sends an overlong line, or a stop is requested.
+	void serve_connection
+	(
+		const std::stop_token stop,
+		const int client,
+		text_to_texture_atlas::baker::atlas_service& service,
+		std::ostream& out,
+		std::mutex& out_mutex
+	)
+	{
+		std::string pending{};
+		char buffer[4096];
+		bool open{ true };
+		while (open && !stop.stop_requested())
+		{
+			pollfd descriptor{ .fd = client, .events = POLLIN, .revents = 0 };
+			const int ready{ poll(&descriptor, 1, 200) };
+			if (ready <= 0)
+			{
+				open = ready == 0 || errno == EINTR;
+				continue;
+			}
+
+			const auto received{ recv(client, buffer, sizeof(buffer), 0) };
+			if (received <= 0)
+			{
+				open = received < 0 && errno == EINTR;
+				continue;
+			}
+			pending.append(buffer, static_cast<std::size_t>(received));
+
+			std::size_t newline{};
+			while (open && (newline = pending.find('\n')) != std::string::npos)
+			{
+				const std::string request{ trim(std::string_view{ pending }.substr(0, newline)) };
+				pending.erase(0, newline + 1);
+
+				const auto start{ std::chrono::steady_clock::now() };
+				const auto response{ service.handle(request) };
+				const std::chrono::duration<double, std::milli> elapsed{ std::chrono::steady_clock::now() - start };
+				{
+					std::scoped_lock lock{ out_mutex };
+					out << "[request] " << request << "\n          -> " << response << " (" << elapsed.count() << " ms)\n";
+					out.flush();
+				}
+				open = send_all(client, response + "\n");
+			}
+			if (pending.size() > max_request_length)
+			{
+				send_all(client, "error request too long\n");
+				open = false;
+			}
+		}
+		close(client);
+	}
+#endif
+}
+
+#pragma region atlas_service::constructors
+text_to_texture_atlas::baker::atlas_service::atlas_service(const service_settings& settings)
+	: settings_(settings)
+{
+}
+#pragma endregion
+
+#pragma region atlas_service::handle
+std::string text_to_texture_atlas::baker::atlas_service::handle(const std::string_view request)
+{
+	const auto line{ trim(request) };
+	if (line == "stats")
+	{
+		const auto stats{ get_stats() };
+		return "ok requests=" + std::to_string(stats.requests) + " builds=" + std::to_string(stats.builds)
+			+ " cached=" + std::to_string(stats.cached) + " coalesced=" + std::to_string(stats.coalesced)
+			+ " failures=" + std::to_string(stats.failures);
+	}
+	if (!line.starts_with("build ") && line != "build")
+	{
+		return "error unknown command, expected 'build <settings>' or 'stats'";
+	}
+
+	const auto reject = [&](const std::string& message)
+	{
+		std::scoped_lock lock{ mutex_ };
+		stats_.requests++;
+		stats_.failures++;
+		return "error " + message;
+	};
+
+	manifest_entry entry{};
+	std::string error{};
+	if (!parse_build_request(line.substr(5), entry, error))
+	{
+		return reject(error);
+	}
+
+	// The font contents are part of the key, so an edited font file is never answered from the cache.
+	std::uint64_t font_hash{};
+	if (!hash_file(entry.font, font_hash))
+	{
+		return reject("cannot read font '" + entry.font.string() + "'");
+	}
+	content_hasher hasher{};
+	hasher.update_value(font_hash);
+	hasher.update_value(hash_entry_settings(entry));
+	const auto key{ hasher.digest() };
+
+	std::shared_ptr<cached_atlas> atlas{};
+	std::promise<std::string> promise{};
+	bool building{};
+	{
+		std::scoped_lock lock{ mutex_ };
+		stats_.requests++;
+		auto [found, inserted] { atlases_.try_emplace(key) };
+		if (inserted)
+		{
+			found->second = std::make_shared<cached_atlas>();
+			found->second->response = promise.get_future().share();
+			found->second->font_hash = font_hash;
+			building = true;
+			stats_.builds++;
+		}
+		else if (found->second->response.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready)
+		{
+			stats_.cached++;
+		}
+		else
+		{
+			stats_.coalesced++;
+		}
+		atlas = found->second;
+		atlas->last_used = ++use_counter_;
+	}
+
+	if (!building)
+	{
+		return atlas->response.get();
+	}
+
+	// Waiting requests must always get an answer, and a build that throws must not end the service.
+	std::string response{};
+	try
+	{
+		response = build(key, entry, *atlas);
+	}
+	catch (const std::exception& exception)
+	{
+		response = std::string{ "error font build failed: " } + exception.what();
+	}
+	catch (...)
+	{
+		response = "error font build failed";
+	}
+	const bool failed{ response.starts_with("error") };
+	promise.set_value(response);
+
+	std::scoped_lock lock{ mutex_ };
+	if (failed)
+	{
+		// Requests already waiting get the error; later ones try again.
+		const auto found{ atlases_.find(key) };
+		if (found != atlases_.end() && found->second == atlas)
+		{
+			atlases_.erase(found);
+		}
+		stats_.failures++;
+	}
+	evict();
+	return response;
+}
+#pragma endregion
+
+#pragma region atlas_service::build
+std::string text_to_texture_atlas::baker::atlas_service::build
+(
+	const std::uint64_t key,
+	const manifest_entry& entry,
+	cached_atlas& atlas
+)
+{
+	auto options{ to_build_options(entry) };
+	options.cache = &cache_;
+	options.pack = settings_.pack;
+
+	const auto font = entry.size.unit == size_unit::pt
+		? Font::Font_Pt(entry.font.string(), entry.size.pt_size, entry.size.width_dpi, entry.size.height_dpi, options)
+		: Font::Font_Px(entry.font.string(), entry.size.height_px, entry.size.width_px, options);
+	if (!font)
+	{
+		const auto& issues{ font.get_issues() };
+		const auto failure{ std::ranges::find(issues, issue_severity::error, &build_issue::severity) };
+		return failure != issues.end() ? "error font build failed: " + describe(*failure) : "error font build failed";
+	}
+
+	const std::string name{ "atlas-" + to_hex(key) };
+	if (!atlas.publisher.open(name) || !atlas.publisher.publish(font))
+	{
+		return "error cannot publish the atlas in shared memory";
+	}
+
+	const auto& main_atlas{ font.get_main_atlas() };
+	return "ok shm=" + name + " generation=" + std::to_string(atlas.publisher.get_generation())
+		+ " width=" + std::to_string(main_atlas.width) + " height=" + std::to_string(main_atlas.height)
+		+ " channels=" + std::to_string(main_atlas.channels) + " glyphs=" + std::to_string(font.get_characters().size())
+		+ " hash=" + to_hex(font.get_content_hash());
+}
+#pragma endregion
+
+#pragma region atlas_service::evict
+void text_to_texture_atlas::baker::atlas_service::evict()
+{
+	const auto is_finished = [](const std::shared_ptr<cached_atlas>& atlas)
+	{
+		return atlas->response.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready;
+	};
+
+	auto finished{ static_cast<std::size_t>(std::ranges::count_if(atlases_ | std::views::values, is_finished)) };
+	while (finished > settings_.max_cached)
+	{
+		auto oldest{ atlases_.end() };
+		for (auto it = atlases_.begin(); it != atlases_.end(); ++it)
+		{
+			if (is_finished(it->second) && (oldest == atlases_.end() || it->second->last_used < oldest->second->last_used))
+			{
+				oldest = it;
+			}
+		}
+		// Readers that attached keep their mapping; new requests rebuild the atlas.
+		atlases_.erase(oldest);
+		finished--;
+	}
+
+	// Keep the glyphs of fonts with a cached atlas, most recently requested first. Fonts that are
+	// still building are never dropped, since their build is adding glyphs right now.
+	struct font_use
+	{
+		std::uint64_t font_hash{};
+		std::uint64_t last_used{};
+		bool building{};
+	};
+	std::vector<font_use> fonts{};
+	for (const auto& atlas : atlases_ | std::views::values)
+	{
+		const bool building{ !is_finished(atlas) };
+		const auto found{ std::ranges::find(fonts, atlas->font_hash, &font_use::font_hash) };
+		if (found == fonts.end())
+		{
+			fonts.push_back({ atlas->font_hash, atlas->last_used, building });
+		}
+		else
+		{
+			found->last_used = std::max(found->last_used, atlas->last_used);
+			found->building = found->building || building;
+		}
+	}
+	std::ranges::sort(fonts, [](const font_use& a, const font_use& b)
+	{
+		return a.building != b.building ? a.building : a.last_used > b.last_used;
+	});
+
+	std::vector<std::uint64_t> faces{};
+	faces.reserve(fonts.size());
+	std::ranges::transform(fonts, std::back_inserter(faces), &font_use::font_hash);
+	cache_.retain_faces(faces);
+	while (!faces.empty() && !fonts[faces.size() - 1].building && cache_.get_memory_usage() > settings_.max_cache_bytes)
+	{
+		// The atlas stays published; only a rebuild of it renders these glyphs again.
+		faces.pop_back();
+		cache_.retain_faces(faces);
+	}
+}
+#pragma endregion
+
+#pragma region atlas_service::get_stats
+text_to_texture_atlas::baker::service_stats text_to_texture_atlas::baker::atlas_service::get_stats() const
+{
+	std::scoped_lock lock{ mutex_ };
+	return stats_;
+}
+#pragma endregion
+
+#pragma region serve
+bool text_to_texture_atlas::baker::serve
+(
+	const std::filesystem::path& socket_path,
+	const service_settings& settings,
+	std::ostream& out,
+	const std::stop_token stop
+)
+{
+#ifdef _WIN32
+	out << "serve: Unix domain sockets are not supported on this platform\n";
+	return false;
+#else
+	sockaddr_un address{};
+	if (!make_address(socket_path, address))
+	{
+		out << socket_path.string() << ": invalid socket path\n";
+		return false;
+	}
+
+	// A socket file nobody accepts on is left over from a service that did not shut down.
+	std::string existing{};
+	if (std::filesystem::exists(socket_path))
+	{
+		if (send_request(socket_path, "stats", existing))
+		{
+			out << socket_path.string() << ": a service is already running\n";
+			return false;
+		}
+		std::error_code error{};
+		std::filesystem::remove(socket_path, error);
+	}
+
+	const int listener{ socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) };
+	if (listener < 0)
+	{
+		out << "cannot create socket\n";
+		return false;
+	}
+	const mode_t previous_mask{ umask(077) };
+	const bool bound{ bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0 };
+	umask(previous_mask);
+	if (!bound || listen(listener, SOMAXCONN) != 0)
+	{
+		out << socket_path.string() << ": cannot listen on socket\n";
+		close(listener);
+		return false;
+	}
+	out << "serving on " << socket_path.string() << std::endl;
+
+	atlas_service service{ settings };
+	std::mutex out_mutex{};
+	struct connection
+	{
+		std::shared_ptr<std::atomic<bool>> finished{};
+		std::jthread thread{};
+	};
+	std::list<connection> connections{};
+
+	while (!stop.stop_requested())
+	{
+		std::erase_if(connections, [](const connection& current) { return current.finished->load(); });
+
+		pollfd descriptor{ .fd = listener, .events = POLLIN, .revents = 0 };
+		if (poll(&descriptor, 1, 200) <= 0)
+		{
+			continue;
+		}
+		const int client{ accept4(listener, nullptr, nullptr, SOCK_CLOEXEC) };
+		if (client < 0)
+		{
+			continue;
+		}
+
+		auto finished{ std::make_shared<std::atomic<bool>>(false) };
+		connections.push_back({ finished, std::jthread{ [&service, &out, &out_mutex, client, finished](const std::stop_token connection_stop)
+		{
+			serve_connection(connection_stop, client, service, out, out_mutex);
+			finished->store(true);
+		} } });
+	}
+
+	// Connections stop and join before the service they use is destroyed.
+	connections.clear();
+	close(listener);
+	std::error_code error{};
+	std::filesystem::remove(socket_path, error);
+	return true;
+#endif
+}
+#pragma endregion
+
+#pragma region send_request
+bool text_to_texture_atlas::baker::send_request
+(
+	const std::filesystem::path& socket_path,
+	const std::string_view request,
+	std::string& response
+)
+{
+#ifdef _WIN32
+	return false;
+#else
+	sockaddr_un address{};
+	if (!make_address(socket_path, address))
+	{
+		return false;
+	}
+	const int client{ socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) };
+	if (client < 0)
+	{
+		return false;
+	}
+
+	bool received{ connect(client, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0
+		&& send_all(client, std::string{ request } + "\n") };
+	response.clear();
+	char buffer[4096];
+	while (received && response.find('\n') == std::string::npos)
+	{
+		const auto count{ recv(client, buffer, sizeof(buffer), 0) };
+		if (count < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		received = count > 0;
+		if (received)
+		{
+			response.append(buffer, static_cast<std::size_t>(count));
+		}
+	}
+	close(client);
+
+	if (!received)
+	{
+		return false;
+	}
+	response.erase(response.find('\n'));
+	return true;
+#endif
+}
+#pragma endregion
@@ -0,0 +1,140 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "GlyphCache.hpp"
+#include "GlyphPack.hpp"
+#include "Manifest.hpp"
+#include "SharedAtlas.hpp"
+
+namespace text_to_texture_atlas::baker
+{
+	/**
+	 * @brief
+	 * Settings for an atlas service.
+	 */
+	struct service_settings
+	{
+		std::size_t max_cached{ 64 };	///< Finished atlases kept published; the least recently requested one is dropped beyond this.
+		std::size_t max_cache_bytes{ 256 * 1024 * 1024 };	///< Coverage bytes kept in the shared glyph cache; the glyphs of the least recently requested fonts are dropped beyond this.
+		glyph_pack* pack{ nullptr };	///< An open on-disk glyph pack shared with bakers (null = none).
+	};
+
+	/**
+	 * @brief
+	 * Counters of what an `atlas_service` has done since it started.
+	 */
+	struct service_stats
+	{
+		std::uint64_t requests{};	///< Build requests received, including rejected ones.
+		std::uint64_t builds{};		///< Atlases actually built.
+		std::uint64_t cached{};		///< Requests answered by an atlas that was already published.
+		std::uint64_t coalesced{};	///< Requests that waited for an identical request's build.
+		std::uint64_t failures{};	///< Requests that were rejected or whose build failed.
+	};
+
+	/**
+	 * @brief
+	 * **Builds atlases on request and publishes them in shared memory, once per distinct request.**
+	 *
+	 * @details
+	 * Requests and responses are single text lines, so the service is independent of its
+	 * transport; `serve` carries them over a Unix domain socket.
+	 *
+	 * @code
+	 * build font=/usr/share/fonts/Inter.ttf; size=px:32; charset=latin1, U+20AC; format=r8
+	 * ok shm=atlas-5f0c... generation=1 width=512 height=256 channels=1 glyphs=192 hash=9a3e...
+	 *
+	 * stats
+	 * ok requests=12 builds=3 cached=8 coalesced=1 failures=0
+	 * @endcode
+	 *
+	 * Settings are separated by `;` and use the manifest keys and values (`font`, `size`,
+	 * `charset`, `format`, `packer`, `order`, `rasterizer`, `vertical_metrics`, `variation`,
+	 * `embolden`, `oblique`, `outline`, `outline_packing`); `font` must be an absolute path.
+	 * The `shm` name is attached with `shared_atlas_reader`, which also holds the glyph metrics.
+	 *
+	 * A request is identified by a hash of the font file contents and every setting. Identical
+	 * requests that arrive while one is building wait for that build instead of starting their
+	 * own; later ones are answered from the published atlas. Failed builds, including builds that
+	 * throw, are answered with an error and not cached, so a fixed font can be requested again.
+	 * Sizes above 2048 px and charsets above 196608 codepoints are rejected before building. Every build shares one `glyph_cache`, which only keeps
+	 * the glyphs of fonts that still have a cached atlas, and drops those of the least recently
+	 * requested fonts while it holds more than `max_cache_bytes`.
+	 *
+	 * @note `handle` is thread-safe and is meant to be called from one thread per connection.
+	 */
+	class atlas_service
+	{
+		/**
+		 * @brief One distinct request: its build, once finished, and the published atlas.
+		 */
+		struct cached_atlas
+		{
+			std::shared_future<std::string> response{};		// The response line, ready once the build finished.
+			shared_atlas_publisher publisher{};				// Keeps the atlas published while it is cached.
+			std::uint64_t last_used{};						// `use_counter_` of the last request for this atlas.
+			std::uint64_t font_hash{};						// Hash of the font file, the face of its glyphs in `cache_`.
+		};
+
+		service_settings settings_{};
+		glyph_cache cache_{};								// Glyphs shared by every build.
+		std::unordered_map<std::uint64_t, std::shared_ptr<cached_atlas>> atlases_{};	// Request hash -> its atlas.
+		std::uint64_t use_counter_{};						// Incremented for every request, orders `last_used`.
+		service_stats stats_{};
+		mutable std::mutex mutex_{};						// Guards everything above except `cache_`, which locks itself.
+
+		std::string build(std::uint64_t key, const manifest_entry& entry, cached_atlas& atlas);	// Builds and publishes an atlas, returns the response line.
+		void evict();										// Drops the least recently used finished atlases beyond `max_cached` and prunes `cache_`. Call with `mutex_` held.
+
+	public:
+		explicit atlas_service(const service_settings& settings = {});
+		atlas_service(const atlas_service&) = delete;
+		atlas_service& operator=(const atlas_service&) = delete;
+
+		/**
+		 * @brief Answers one request line.
+		 *
+		 * @return The response line, without a trailing newline: `ok ...` or `error <message>`.
+		 */
+		std::string handle(std::string_view request);
+
+		/// Returns the counters so far.
+		service_stats get_stats() const;
+	};
+
+	/**
+	 * @brief
+	 * **Runs an `atlas_service` on a Unix domain socket until a stop is requested.**
+	 *
+	 * @details
+	 * Every connection is served on its own thread and may send any number of request lines;
+	 * each is answered with one response line. An existing socket file that nothing listens on
+	 * is replaced. The socket is created with owner-only permissions and removed on exit.
+	 *
+	 * @param socket_path The socket file to listen on.
+	 * @param settings The service settings.
+	 * @param out The stream a line per request is logged to.
+	 * @param stop Ends the service when a stop is requested.
+	 *
+	 * @return false if the socket could not be created (or on Windows, where it is unsupported),
+	 * true when stopped.
+	 */
+	bool serve(const std::filesystem::path& socket_path, const service_settings& settings = {}, std::ostream& out = std::cout, std::stop_token stop = {});
+
+	/**
+	 * @brief Sends one request line to a running service and waits for its response.
+	 *
+	 * @return true if a response was received, false if the service could not be reached.
+	 */
+	bool send_request(const std::filesystem::path& socket_path, std::string_view request, std::string& response);
+}
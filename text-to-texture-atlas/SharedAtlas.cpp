@@ -0,0 +1,570 @@
+#include "SharedAtlas.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Font.hpp"
+
+namespace
+{
+	/**
+	 * @brief The control segment: the only thing the publisher and readers share mutably.
+	 */
+	struct control_block
+	{
+		char magic[8]{ 'T', 'T', 'A', 'S', 'H', 'C', 'T', 'L' };
+		std::uint32_t version{ 1 };					// Bump whenever the control or snapshot layout changes.
+		std::uint32_t byte_order{ 0x01020304 };		// Fields are stored in native byte order.
+		std::atomic<std::uint64_t> generation{};	// The current snapshot, 0 before the first publish.
+	};
+	static_assert(sizeof(control_block) == 24, "control_block is part of the shared memory layout");
+	static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "the generation counter is shared between processes");
+
+	/**
+	 * @brief The header at the start of every snapshot segment.
+	 */
+	struct snapshot_header
+	{
+		char magic[8]{ 'T', 'T', 'A', 'S', 'H', 'A', 'T', 'L' };
+		std::uint32_t version{ 1 };
+		std::uint32_t byte_order{ 0x01020304 };
+		std::uint64_t generation{};		// Must match the generation the segment is named after.
+		std::uint64_t total_size{};		// Bytes used by the snapshot, including this header.
+		std::uint64_t glyph_offset{};	// Offset of the glyph table.
+		std::uint64_t pixels_offset{};	// Offset of the atlas's top row.
+		std::uint64_t row_pitch{};		// Bytes from one atlas row to the next.
+		std::uint64_t content_hash{};	// The publishing font's content hash.
+		std::uint32_t glyph_count{};	// Entries in the glyph table.
+		std::uint32_t glyph_size{ sizeof(text_to_texture_atlas::shared_glyph) };
+		std::uint32_t width{};			// Atlas width in pixels.
+		std::uint32_t height{};			// Atlas height in pixels.
+		std::uint32_t channels{};		// Bytes per pixel.
+		std::uint32_t reserved{};
+	};
+	static_assert(sizeof(snapshot_header) == 88, "snapshot_header is part of the shared memory layout");
+
+	enum class segment_mode
+	{
+		read,				// Open an existing segment read-only.
+		open_or_create,		// Open read-write, creating it with the given size if needed.
+		create_exclusive	// Create a new read-write segment of the given size, failing if it exists.
+	};
+
+	constexpr std::uint64_t align_up(const std::uint64_t value, const std::uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool is_valid_name(const std::string& name)
+	{
+		return !name.empty() && name.size() <= 200 && std::ranges::all_of(name, [](const char c)
+		{
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.';
+		});
+	}
+
+	std::string control_segment(const std::string& name)
+	{
+		return "tta-" + name;
+	}
+
+	std::string snapshot_segment(const std::string& name, const std::uint64_t generation)
+	{
+		return "tta-" + name + "-" + std::to_string(generation);
+	}
+
+	bool has_expected_header(const control_block& control)
+	{
+		const control_block expected{};
+		return std::memcmp(control.magic, expected.magic, sizeof(expected.magic)) == 0
+			&& control.version == expected.version && control.byte_order == expected.byte_order;
+	}
+
+	/**
+	 * @brief Opens or creates a shared-memory segment and maps all of it.
+	 *
+	 * @param mapping Receives the mapping object on Windows, which must stay open for the segment
+	 * to exist; unused elsewhere, where the segment lives until it is unlinked.
+	 */
+	void* map_segment
+	(
+		const std::string& segment,
+		const segment_mode mode,
+		const std::size_t create_size,
+		std::size_t& size,
+		void*& mapping
+	)
+	{
+		mapping = nullptr;
+		size = 0;
+#ifdef _WIN32
+		const std::wstring wide_name{ L"Local\\" + std::wstring(segment.begin(), segment.end()) };
+		HANDLE handle{};
+		if (mode == segment_mode::read)
+		{
+			handle = OpenFileMappingW(FILE_MAP_READ, FALSE, wide_name.c_str());
+		}
+		else
+		{
+			const auto large_size{ static_cast<std::uint64_t>(create_size) };
+			handle = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+				static_cast<DWORD>(large_size >> 32), static_cast<DWORD>(large_size & 0xFFFFFFFF), wide_name.c_str());
+			if (handle && mode == segment_mode::create_exclusive && GetLastError() == ERROR_ALREADY_EXISTS)
+			{
+				CloseHandle(handle);
+				handle = nullptr;
+			}
+		}
+		if (!handle)
+		{
+			return nullptr;
+		}
+		void* view{ MapViewOfFile(handle, mode == segment_mode::read ? FILE_MAP_READ : FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0) };
+		MEMORY_BASIC_INFORMATION information{};
+		if (!view || VirtualQuery(view, &information, sizeof(information)) == 0)
+		{
+			if (view)
+			{
+				UnmapViewOfFile(view);
+			}
+			CloseHandle(handle);
+			return nullptr;
+		}
+		mapping = handle;
+		size = information.RegionSize;
+		return view;
+#else
+		const std::string posix_name{ "/" + segment };
+		int flags{ mode == segment_mode::read ? O_RDONLY : O_RDWR };
+		flags |= mode == segment_mode::open_or_create ? O_CREAT : 0;
+		flags |= mode == segment_mode::create_exclusive ? O_CREAT | O_EXCL : 0;
+		const int fd{ shm_open(posix_name.c_str(), flags, 0600) };
+		if (fd < 0)
+		{
+			return nullptr;
+		}
+
+		struct stat status{};
+		bool sized{ fstat(fd, &status) == 0 };
+		if (sized && mode != segment_mode::read && static_cast<std::size_t>(status.st_size) < create_size)
+		{
+			sized = ftruncate(fd, static_cast<off_t>(create_size)) == 0;
+			status.st_size = static_cast<off_t>(create_size);
+		}
+		void* view{ sized && status.st_size > 0
+			? mmap(nullptr, static_cast<std::size_t>(status.st_size), mode == segment_mode::read ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+			: MAP_FAILED };
+
+		// The mapping keeps the segment alive on its own.
+		::close(fd);
+		if (view == MAP_FAILED)
+		{
+			return nullptr;
+		}
+		size = static_cast<std::size_t>(status.st_size);
+		return view;
+#endif
+	}
+
+	void unmap_segment(const void* view, const std::size_t size)
+	{
+		if (!view)
+		{
+			return;
+		}
+#ifdef _WIN32
+		UnmapViewOfFile(view);
+#else
+		munmap(const_cast<void*>(view), size);
+#endif
+	}
+
+	void close_mapping([[maybe_unused]] void*& mapping)
+	{
+#ifdef _WIN32
+		if (mapping)
+		{
+			CloseHandle(static_cast<HANDLE>(mapping));
+		}
+#endif
+		mapping = nullptr;
+	}
+
+	// Windows destroys a mapping when its last handle closes, so only POSIX segments need removing.
+	void remove_segment([[maybe_unused]] const std::string& segment)
+	{
+#ifndef _WIN32
+		shm_unlink(("/" + segment).c_str());
+#endif
+	}
+
+	snapshot_header read_header(const unsigned char* snapshot)
+	{
+		snapshot_header header{};
+		if (snapshot)
+		{
+			std::memcpy(&header, snapshot, sizeof(header));
+		}
+		return header;
+	}
+}
+
+#pragma region shared_atlas_publisher::destructor
+text_to_texture_atlas::shared_atlas_publisher::~shared_atlas_publisher()
+{
+	close();
+}
+#pragma endregion
+
+#pragma region shared_atlas_publisher::open
+bool text_to_texture_atlas::shared_atlas_publisher::open(const std::string& name)
+{
+	close();
+	if (!is_valid_name(name))
+	{
+		return false;
+	}
+
+	std::size_t size{};
+	void* mapping{};
+	control_ = map_segment(control_segment(name), segment_mode::open_or_create, sizeof(control_block), size, mapping);
+#ifdef _WIN32
+	control_mapping_ = mapping;
+#endif
+	if (!control_ || size < sizeof(control_block))
+	{
+		close();
+		return false;
+	}
+
+	// A new segment is zero filled. An existing one is left by an earlier publisher, whose
+	// generations are continued so readers never see a generation go backwards.
+	const char zero_magic[8]{};
+	if (std::memcmp(control_, zero_magic, sizeof(zero_magic)) == 0)
+	{
+		new (control_) control_block{};
+	}
+	else if (!has_expected_header(*static_cast<control_block*>(control_)))
+	{
+		close();
+		return false;
+	}
+
+	name_ = name;
+	generation_ = static_cast<control_block*>(control_)->generation.load(std::memory_order_acquire);
+	return true;
+}
+#pragma endregion
+
+#pragma region shared_atlas_publisher::close
+void text_to_texture_atlas::shared_atlas_publisher::close()
+{
+	unmap_segment(control_, sizeof(control_block));
+	control_ = nullptr;
+#ifdef _WIN32
+	close_mapping(control_mapping_);
+	close_mapping(snapshot_mapping_);
+#endif
+	if (!name_.empty())
+	{
+		remove_segment(control_segment(name_));
+		if (generation_)
+		{
+			remove_segment(snapshot_segment(name_, generation_));
+		}
+	}
+	name_.clear();
+	generation_ = 0;
+}
+#pragma endregion
+
+#pragma region shared_atlas_publisher::publish
+bool text_to_texture_atlas::shared_atlas_publisher::publish(const Font& font)
+{
+	if (!control_ || !font || !font.get_main_atlas().has_pixels())
+	{
+		return false;
+	}
+	const auto& atlas{ font.get_main_atlas() };
+
+	std::vector<shared_glyph> glyphs{};
+	glyphs.reserve(font.get_characters().size());
+	for (const auto& [codepoint, value] : font.get_characters())
+	{
+		glyphs.push_back({
+			.codepoint = static_cast<std::uint32_t>(codepoint),
+			.x = value.top_left.x,
+			.y = value.top_left.y,
+			.width = value.width_,
+			.height = value.height_,
+			.bearing_x = value.x_bearing_,
+			.bearing_y = value.y_bearing_,
+			.advance_x = value.advance_x_,
+			.advance_y = value.advance_y_,
+			.u0 = value.tex_coords_top_left.x,
+			.v0 = value.tex_coords_top_left.y,
+			.u1 = value.tex_coords_bottom_right.x,
+			.v1 = value.tex_coords_bottom_right.y
+		});
+	}
+	std::ranges::sort(glyphs, {}, &shared_glyph::codepoint);
+
+	// Pixels start on a page boundary so readers can hand them to upload APIs that want aligned memory.
+	snapshot_header header{};
+	header.generation = generation_ + 1;
+	header.glyph_offset = align_up(sizeof(snapshot_header), 64);
+	header.glyph_count = static_cast<std::uint32_t>(glyphs.size());
+	header.pixels_offset = align_up(header.glyph_offset + glyphs.size() * sizeof(shared_glyph), 4096);
+	header.row_pitch = static_cast<std::uint64_t>(atlas.width) * atlas.channels;
+	header.total_size = header.pixels_offset + header.row_pitch * atlas.height;
+	header.content_hash = font.get_content_hash();
+	header.width = atlas.width;
+	header.height = atlas.height;
+	header.channels = atlas.channels;
+
+	// A crashed publisher may have left a segment with this name behind.
+	const std::string segment{ snapshot_segment(name_, header.generation) };
+	remove_segment(segment);
+
+	std::size_t size{};
+	void* mapping{};
+	auto* view{ static_cast<unsigned char*>(map_segment(segment, segment_mode::create_exclusive, static_cast<std::size_t>(header.total_size), size, mapping)) };
+	if (!view || size < header.total_size)
+	{
+		unmap_segment(view, size);
+		close_mapping(mapping);
+		remove_segment(segment);
+		return false;
+	}
+
+	std::memcpy(view, &header, sizeof(header));
+	std::memcpy(view + header.glyph_offset, glyphs.data(), glyphs.size() * sizeof(shared_glyph));
+	for (unsigned int y = 0; y < atlas.height; y++)
+	{
+		std::memcpy(view + header.pixels_offset + y * header.row_pitch, atlas.get_pixels() + y * atlas.row_pitch, static_cast<std::size_t>(header.row_pitch));
+	}
+	unmap_segment(view, size);
+
+	// The snapshot is complete before readers can learn its generation.
+	static_cast<control_block*>(control_)->generation.store(header.generation, std::memory_order_release);
+
+	// Readers still mapping the previous snapshot keep it until they update.
+	if (generation_)
+	{
+		remove_segment(snapshot_segment(name_, generation_));
+	}
+#ifdef _WIN32
+	close_mapping(snapshot_mapping_);
+	snapshot_mapping_ = mapping;
+#endif
+	generation_ = header.generation;
+	return true;
+}
+#pragma endregion
+
+#pragma region shared_atlas_reader::destructor
+text_to_texture_atlas::shared_atlas_reader::~shared_atlas_reader()
+{
+	detach();
+}
+#pragma endregion
+
+#pragma region shared_atlas_reader::attach
+bool text_to_texture_atlas::shared_atlas_reader::attach(const std::string& name)
+{
+	detach();
+	if (!is_valid_name(name))
+	{
+		return false;
+	}
+
+	std::size_t size{};
+	void* mapping{};
+	control_ = map_segment(control_segment(name), segment_mode::read, 0, size, mapping);
+#ifdef _WIN32
+	control_mapping_ = mapping;
+#endif
+	if (!control_ || size < sizeof(control_block) || !has_expected_header(*static_cast<const control_block*>(control_)))
+	{
+		detach();
+		return false;
+	}
+
+	// The control block stays mapped even if nothing is published yet, so `update` can pick up the first snapshot.
+	name_ = name;
+	update();
+	return snapshot_ != nullptr;
+}
+#pragma endregion
+
+#pragma region shared_atlas_reader::detach
+void text_to_texture_atlas::shared_atlas_reader::detach()
+{
+	unmap_snapshot();
+	unmap_segment(control_, sizeof(control_block));
+	control_ = nullptr;
+#ifdef _WIN32
+	close_mapping(control_mapping_);
+#endif
+	name_.clear();
+}
+#pragma endregion
+
+#pragma region shared_atlas_reader::map_snapshot
+bool text_to_texture_atlas::shared_atlas_reader::map_snapshot(const std::uint64_t generation)
+{
+	std::size_t size{};
+	void* mapping{};
+	const auto* view{ static_cast<const unsigned char*>(map_segment(snapshot_segment(name_, generation), segment_mode::read, 0, size, mapping)) };
+	if (!view)
+	{
+		return false;
+	}
+
+	const snapshot_header expected{};
+	const snapshot_header header{ size >= sizeof(snapshot_header) ? read_header(view) : snapshot_header{} };
+	const std::uint64_t row_bytes{ static_cast<std::uint64_t>(header.width) * header.channels };
+	const bool valid{ size >= sizeof(snapshot_header)
+		&& std::memcmp(header.magic, expected.magic, sizeof(expected.magic)) == 0
+		&& header.version == expected.version && header.byte_order == expected.byte_order
+		&& header.glyph_size == expected.glyph_size && header.generation == generation
+		&& header.total_size <= size && header.row_pitch >= row_bytes
+		&& header.glyph_offset % alignof(shared_glyph) == 0
+		&& header.glyph_offset + static_cast<std::uint64_t>(header.glyph_count) * sizeof(shared_glyph) <= header.total_size
+		&& header.pixels_offset + header.row_pitch * header.height <= header.total_size };
+	if (!valid)
+	{
+		unmap_segment(view, size);
+		close_mapping(mapping);
+		return false;
+	}
+
+	unmap_snapshot();
+	snapshot_ = view;
+	snapshot_size_ = size;
+#ifdef _WIN32
+	snapshot_mapping_ = mapping;
+#endif
+	generation_ = generation;
+	return true;
+}
+#pragma endregion
+
+#pragma region shared_atlas_reader::unmap_snapshot
+void text_to_texture_atlas::shared_atlas_reader::unmap_snapshot()
+{
+	unmap_segment(snapshot_, snapshot_size_);
+	snapshot_ = nullptr;
+	snapshot_size_ = 0;
+#ifdef _WIN32
+	close_mapping(snapshot_mapping_);
+#endif
+	generation_ = 0;
+}
+#pragma endregion
+
+#pragma region shared_atlas_reader::update
+bool text_to_texture_atlas::shared_atlas_reader::update()
+{
+	if (!control_)
+	{
+		return false;
+	}
+	const auto& control{ *static_cast<const control_block*>(control_) };
+
+	// The publisher removes a snapshot as soon as it publishes the next one, so a snapshot can
+	// vanish between reading its generation and opening it; the newer one is tried instead.
+	constexpr int attempts{ 4 };
+	for (int attempt = 0; attempt < attempts; attempt++)
+	{
+		const auto latest{ control.generation.load(std::memory_order_acquire) };
+		if (latest == 0 || latest == generation_)
+		{
+			return false;
+		}
+		if (map_snapshot(latest))
+		{
+			return true;
+		}
+		if (control.generation.load(std::memory_order_acquire) == latest)
+		{
+			return false;
+		}
+	}
+	return false;
+}
+#pragma endregion
+
+#pragma region shared_atlas_reader::is_current
+bool text_to_texture_atlas::shared_atlas_reader::is_current() const
+{
+	return control_ && static_cast<const control_block*>(control_)->generation.load(std::memory_order_acquire) == generation_;
+}
+#pragma endregion
+
+#pragma region shared_atlas_reader::find
+const text_to_texture_atlas::shared_glyph* text_to_texture_atlas::shared_atlas_reader::find(const char32_t codepoint) const
+{
+	const auto glyphs{ get_glyphs() };
+	const auto found{ std::ranges::lower_bound(glyphs, static_cast<std::uint32_t>(codepoint), {}, &shared_glyph::codepoint) };
+	return found != glyphs.end() && found->codepoint == static_cast<std::uint32_t>(codepoint) ? &*found : nullptr;
+}
+#pragma endregion
+
+#pragma region shared_atlas_reader::get_glyphs
+std::span<const text_to_texture_atlas::shared_glyph> text_to_texture_atlas::shared_atlas_reader::get_glyphs() const
+{
+	if (!snapshot_)
+	{
+		return {};
+	}
+	const auto header{ read_header(snapshot_) };
+	return { reinterpret_cast<const shared_glyph*>(snapshot_ + header.glyph_offset), header.glyph_count };
+}
+#pragma endregion
+
+#pragma region shared_atlas_reader::getters
+const unsigned char* text_to_texture_atlas::shared_atlas_reader::get_pixels() const
+{
+	return snapshot_ ? snapshot_ + read_header(snapshot_).pixels_offset : nullptr;
+}
+
+unsigned int text_to_texture_atlas::shared_atlas_reader::get_width() const
+{
+	return read_header(snapshot_).width;
+}
+
+unsigned int text_to_texture_atlas::shared_atlas_reader::get_height() const
+{
+	return read_header(snapshot_).height;
+}
+
+unsigned int text_to_texture_atlas::shared_atlas_reader::get_channels() const
+{
+	return read_header(snapshot_).channels;
+}
+
+std::size_t text_to_texture_atlas::shared_atlas_reader::get_row_pitch() const
+{
+	return static_cast<std::size_t>(read_header(snapshot_).row_pitch);
+}
+
+std::uint64_t text_to_texture_atlas::shared_atlas_reader::get_content_hash() const
+{
+	return read_header(snapshot_).content_hash;
+}
+#pragma endregion
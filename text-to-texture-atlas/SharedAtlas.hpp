@@ -0,0 +1,200 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace text_to_texture_atlas
+{
+	class Font;
+
+	/**
+	 * @brief
+	 * One glyph in a shared atlas's glyph table.
+	 */
+	struct shared_glyph
+	{
+		std::uint32_t codepoint{};	///< The character's codepoint; the table is sorted by it.
+		std::uint32_t x{};			///< Left edge of the glyph in the atlas, in pixels.
+		std::uint32_t y{};			///< Top edge of the glyph in the atlas, in pixels.
+		std::uint32_t width{};		///< Width of the glyph in pixels.
+		std::uint32_t height{};		///< Height of the glyph in pixels.
+		std::int32_t bearing_x{};	///< Horizontal distance from the pen position to the left edge.
+		std::int32_t bearing_y{};	///< Vertical distance from the baseline to the top edge.
+		std::int32_t advance_x{};	///< Horizontal pen advance (in 1/64 pixels).
+		std::int32_t advance_y{};	///< Vertical pen advance (in 1/64 pixels).
+		float u0{};					///< Left texture coordinate.
+		float v0{};					///< Top texture coordinate.
+		float u1{};					///< Right texture coordinate.
+		float v1{};					///< Bottom texture coordinate.
+	};
+	static_assert(sizeof(shared_glyph) == 52, "shared_glyph is part of the shared memory layout");
+
+	/**
+	 * @brief
+	 * **Publishes built atlases into shared memory for other processes on the host.**
+	 *
+	 * @details
+	 * Every `publish` writes a complete, immutable snapshot into a new shared-memory segment:
+	 * a header, the glyph table sorted by codepoint, then the atlas pixels (page aligned, tightly
+	 * pitched). Only then is the snapshot's generation stored into a small control segment with
+	 * a single atomic release store, which is all readers ever synchronise on. The previous
+	 * snapshot is unlinked right after; readers still mapping it keep a valid view until they
+	 * move on, so no reader ever sees a half-written atlas and nobody takes a lock.
+	 *
+	 * Segments are named after `name`: `/tta-<name>` for the control block and
+	 * `/tta-<name>-<generation>` for each snapshot (`Local\tta-...` mappings on Windows).
+	 *
+	 * *Usage Example:*
+	 *
+	 * @code
+	 * text_to_texture_atlas::shared_atlas_publisher publisher{};
+	 * if (publisher.open("ui-arial-32")) {
+	 *     auto font = text_to_texture_atlas::Font::Font_Px("arial.ttf", 32, 0);
+	 *     publisher.publish(font);	// Renderers attached to "ui-arial-32" pick it up.
+	 * }
+	 * @endcode
+	 *
+	 * @note Use one publisher per name. Segments are removed by `close`, so the publisher should
+	 * live as long as the atlas is served.
+	 */
+	class shared_atlas_publisher
+	{
+		std::string name_{};					// The atlas name segments are derived from.
+		std::uint64_t generation_{};			// The generation published last, 0 before the first publish.
+#ifdef _WIN32
+		void* control_mapping_{};				// The control block's mapping object (HANDLE).
+		void* snapshot_mapping_{};				// The latest snapshot's mapping object (HANDLE), kept open so it outlives publish.
+#endif
+		void* control_{};						// The mapped control block, null if not open.
+
+	public:
+		shared_atlas_publisher() = default;
+		~shared_atlas_publisher();
+		shared_atlas_publisher(const shared_atlas_publisher&) = delete;
+		shared_atlas_publisher& operator=(const shared_atlas_publisher&) = delete;
+
+		/**
+		 * @brief Creates (or takes over) the control block for `name`.
+		 *
+		 * @param name The atlas name: letters, digits, `-`, `_` and `.` only.
+		 *
+		 * @return true if the publisher can publish, false if the name is invalid or the control
+		 * block could not be created.
+		 */
+		bool open(const std::string& name);
+
+		/**
+		 * @brief Removes the control block and the latest snapshot. Called by the destructor.
+		 *
+		 * @details Readers that are attached keep their current snapshot, but can no longer see updates.
+		 */
+		void close();
+
+		/**
+		 * @brief Copies the font's atlas and glyph table into a new snapshot and makes it current.
+		 *
+		 * @return true if the snapshot was published, false if the font has no atlas or the
+		 * segment could not be created (the current snapshot stays current).
+		 */
+		bool publish(const Font& font);
+
+		/// Returns the generation published last, 0 before the first publish.
+		inline std::uint64_t get_generation() const { return generation_; }
+
+		/// Returns true if the publisher is open.
+		inline explicit operator bool() const { return control_ != nullptr; }
+	};
+
+	/**
+	 * @brief
+	 * **A read-only, zero-copy view of an atlas published by another process.**
+	 *
+	 * @details
+	 * The pixels and glyph table are read straight from the shared mapping. `is_current` is a
+	 * single atomic load, cheap enough to check every frame; `update` maps the newer snapshot
+	 * when there is one, after which the previous pointers are invalid.
+	 *
+	 * @code
+	 * text_to_texture_atlas::shared_atlas_reader atlas{};
+	 * if (atlas.attach("ui-arial-32")) {
+	 *     upload_texture(atlas.get_pixels(), atlas.get_width(), atlas.get_height());
+	 *     const auto* glyph = atlas.find(U'A');
+	 * }
+	 *
+	 * // Every frame:
+	 * if (atlas.update()) {
+	 *     upload_texture(atlas.get_pixels(), atlas.get_width(), atlas.get_height());
+	 * }
+	 * @endcode
+	 *
+	 * @warning This class is not thread-safe; `update` remaps the view.
+	 */
+	class shared_atlas_reader
+	{
+		std::string name_{};					// The atlas name attached to.
+		const void* control_{};					// The mapped control block, null if detached.
+		const unsigned char* snapshot_{};		// The mapped snapshot, null if none is attached.
+		std::size_t snapshot_size_{};			// Bytes mapped at `snapshot_`.
+#ifdef _WIN32
+		void* control_mapping_{};				// The control block's mapping object (HANDLE).
+		void* snapshot_mapping_{};				// The snapshot's mapping object (HANDLE).
+#endif
+		std::uint64_t generation_{};			// The generation of the mapped snapshot.
+
+		bool map_snapshot(std::uint64_t generation);	// Maps and validates a snapshot, replacing the current one on success.
+		void unmap_snapshot();							// Releases the mapped snapshot.
+
+	public:
+		shared_atlas_reader() = default;
+		~shared_atlas_reader();
+		shared_atlas_reader(const shared_atlas_reader&) = delete;
+		shared_atlas_reader& operator=(const shared_atlas_reader&) = delete;
+
+		/**
+		 * @brief Attaches to the atlas published as `name` and maps its current snapshot.
+		 *
+		 * @return true if a snapshot is mapped, false if nothing is published under that name.
+		 */
+		bool attach(const std::string& name);
+
+		/**
+		 * @brief Unmaps everything. Called by the destructor.
+		 */
+		void detach();
+
+		/**
+		 * @brief Maps the publisher's newest snapshot if it is newer than the mapped one.
+		 *
+		 * @return true if a newer snapshot is now mapped, false if there was none or it could not
+		 * be mapped (the current snapshot stays mapped).
+		 */
+		bool update();
+
+		/// Returns true if no snapshot newer than the mapped one has been published.
+		bool is_current() const;
+
+		/**
+		 * @brief Looks up a glyph by codepoint with a binary search of the glyph table.
+		 *
+		 * @return The glyph, or null if the atlas does not contain the codepoint.
+		 */
+		const shared_glyph* find(char32_t codepoint) const;
+
+		/// Returns the glyph table, sorted by codepoint.
+		std::span<const shared_glyph> get_glyphs() const;
+
+		/// Returns the first byte of the atlas's top row.
+		const unsigned char* get_pixels() const;
+
+		unsigned int get_width() const;				// returns the atlas width in pixels.
+		unsigned int get_height() const;			// returns the atlas height in pixels.
+		unsigned int get_channels() const;			// returns the bytes per pixel (4 for RGBA, 1 for R8).
+		std::size_t get_row_pitch() const;			// returns the bytes from one row to the next.
+		std::uint64_t get_content_hash() const;		// returns the publishing font's `get_content_hash()`.
+		inline std::uint64_t get_generation() const { return generation_; }	// returns the generation of the mapped snapshot.
+
+		/// Returns true if a snapshot is mapped.
+		inline explicit operator bool() const { return snapshot_ != nullptr; }
+	};
+}
@@ -0,0 +1,176 @@
+#include "VariableFont.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <filesystem>
+#include <memory>
+#include <ranges>
+#include <freetype/freetype.h>
+#include <freetype/ftmm.h>
+
+#include "Hash.hpp"
+
+#pragma region constructor
+text_to_texture_atlas::variable_font::variable_font
+(
+	std::string font_name,
+	const unsigned int char_height,
+	const unsigned int char_width,
+	const build_options& options,
+	const variable_font_settings& settings
+)
+	: font_name_(std::move(font_name)),
+	char_height_(char_height),
+	char_width_(char_width),
+	options_(options),
+	settings_(settings)
+{
+	options_.variation.clear();
+	read_axes();
+}
+#pragma endregion
+
+#pragma region read_axes
+void text_to_texture_atlas::variable_font::read_axes()
+{
+	struct library_deleter { void operator()(FT_Library library) const { FT_Done_FreeType(library); } };
+	struct face_deleter { void operator()(FT_Face face) const { FT_Done_Face(face); } };
+
+	FT_Library new_library{};
+	if (FT_Init_FreeType(&new_library))
+	{
+		return;
+	}
+	const std::unique_ptr<FT_LibraryRec_, library_deleter> library{ new_library };
+
+	const std::string font{ std::filesystem::path(font_name_).is_absolute() ? font_name_ : options_.font_directory + font_name_ };
+	FT_Face new_face{};
+	if (FT_New_Face(library.get(), font.c_str(), 0, &new_face))
+	{
+		return;
+	}
+	const std::unique_ptr<FT_FaceRec_, face_deleter> face{ new_face };
+
+	FT_MM_Var* master{};
+	if (FT_Get_MM_Var(face.get(), &master))
+	{
+		return;
+	}
+	const auto to_float = [](const FT_Fixed value) { return static_cast<float>(static_cast<double>(value) / 65536.0); };
+	for (const auto& axis : std::span<const FT_Var_Axis>{ master->axis, master->num_axis })
+	{
+		axes_.push_back({ .tag = static_cast<std::uint32_t>(axis.tag), .minimum = to_float(axis.minimum),
+			.default_value = to_float(axis.def), .maximum = to_float(axis.maximum) });
+	}
+	FT_Done_MM_Var(library.get(), master);
+}
+#pragma endregion
+
+#pragma region quantize
+std::vector<text_to_texture_atlas::variation_coordinate> text_to_texture_atlas::variable_font::quantize
+(
+	const std::span<const variation_coordinate> coordinates
+) const
+{
+	// Every axis starts at its default, so leaving one out and giving its default are the same instance.
+	std::vector<variation_coordinate> quantized{};
+	quantized.reserve(axes_.size() + coordinates.size());
+	for (const auto& axis : axes_)
+	{
+		quantized.push_back({ .tag = axis.tag, .value = axis.default_value });
+	}
+
+	for (const auto& coordinate : coordinates)
+	{
+		const auto step_entry{ std::ranges::find(settings_.steps, coordinate.tag, &variation_coordinate::tag) };
+		const float step{ step_entry != settings_.steps.end() ? step_entry->value : settings_.default_step };
+		float value{ step > 0.0f ? std::round(coordinate.value / step) * step : coordinate.value };
+
+		// Clamped as FreeType clamps it, so values past the end of the axis share the last instance.
+		// Unknown axes are kept as given, and the build reports them.
+		const auto axis{ std::ranges::find(axes_, coordinate.tag, &axis_range::tag) };
+		if (axis != axes_.end())
+		{
+			value = std::clamp(value, axis->minimum, axis->maximum);
+			if (step > 0.0f && std::abs(value - axis->default_value) < step * 0.5f)
+			{
+				value = axis->default_value;
+			}
+		}
+
+		// A later coordinate for the same axis wins, as it would in `FT_Set_Var_Design_Coordinates`.
+		const auto existing{ std::ranges::find(quantized, coordinate.tag, &variation_coordinate::tag) };
+		if (existing != quantized.end())
+		{
+			existing->value = value;
+		}
+		else
+		{
+			quantized.push_back({ .tag = coordinate.tag, .value = value });
+		}
+	}
+	std::ranges::sort(quantized, {}, &variation_coordinate::tag);
+	return quantized;
+}
+#pragma endregion
+
+#pragma region get_instance
+const text_to_texture_atlas::Font* text_to_texture_atlas::variable_font::get_instance
+(
+	const std::span<const variation_coordinate> coordinates
+)
+{
+	last_built_ = false;
+	auto quantized{ quantize(coordinates) };
+
+	content_hasher hasher{};
+	for (const auto& coordinate : quantized)
+	{
+		hasher.update_value(coordinate.tag);
+		hasher.update_value(std::bit_cast<std::uint32_t>(coordinate.value + 0.0f));	// + 0 folds -0 into 0.
+	}
+	const std::uint64_t key{ hasher.digest() };
+
+	const auto found{ instances_.find(key) };
+	if (found != instances_.end())
+	{
+		found->second.last_used = ++use_counter_;
+		return found->second.font.get();
+	}
+
+	build_options options{ options_ };
+	options.variation = quantized;
+	auto font{ std::make_unique<Font>(Font::Font_Px(font_name_, char_height_, char_width_, options)) };
+	if (!*font)
+	{
+		return nullptr;
+	}
+
+	last_built_ = true;
+	auto& built{ instances_[key] };
+	built = instance{ .coordinates = std::move(quantized), .font = std::move(font), .last_used = ++use_counter_ };
+	const Font* result{ built.font.get() };
+	evict();
+	return result;
+}
+#pragma endregion
+
+#pragma region evict
+void text_to_texture_atlas::variable_font::evict()
+{
+	// The instance just built is the most recently used, so it is never the one dropped.
+	while (instances_.size() > std::max<std::size_t>(settings_.max_instances, 1))
+	{
+		const auto oldest{ std::ranges::min_element(instances_, {}, [](const auto& entry) { return entry.second.last_used; }) };
+		instances_.erase(oldest);
+	}
+}
+#pragma endregion
+
+#pragma region clear
+void text_to_texture_atlas::variable_font::clear()
+{
+	instances_.clear();
+}
+#pragma endregion
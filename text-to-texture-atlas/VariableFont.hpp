@@ -0,0 +1,135 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Font.hpp"
+
+namespace text_to_texture_atlas
+{
+	/**
+	 * @brief
+	 * Controls how finely a `variable_font` distinguishes instances and how many it keeps.
+	 */
+	struct variable_font_settings
+	{
+		/// The quantization step per axis; coordinates are rounded to the nearest multiple. Axes not listed use `default_step`.
+		std::vector<variation_coordinate> steps{ { axis_tag("wght"), 10.0f } };
+
+		/// The quantization step for axes not listed in `steps`.
+		float default_step{ 1.0f };
+
+		/// The most instance atlases kept; the least recently used one is dropped beyond this.
+		std::size_t max_instances{ 8 };
+	};
+
+	/**
+	 * @brief
+	 * **Builds and caches atlases for the instances of one variable font.**
+	 *
+	 * @details
+	 * Coordinates are quantized per axis before lookup, so a weight animating from 300 to 900
+	 * visits at most one atlas per step instead of building one per frame. They are first clamped
+	 * to the axis's range and omitted axes take their default, as FreeType applies them, so
+	 * `wght` 950 on a font that stops at 900, or an axis given explicitly at its default, reuse
+	 * the instance that looks the same. A quantized value within half a step of the default
+	 * snaps to the default. Every instance is
+	 * built with the same options. Glyph keys include the instance, so instances never share
+	 * cached glyphs; an instance's glyphs are freed with it when it is evicted. A `cache` in the
+	 * options still receives every instance's glyphs and is left to its owner to prune.
+	 *
+	 * *Usage Example:*
+	 *
+	 * @code
+	 * using text_to_texture_atlas::axis_tag;
+	 * text_to_texture_atlas::variable_font inter{ "InterVariable.ttf", 32, 0 };
+	 *
+	 * // Every frame:
+	 * const float weight = 300.0f + 600.0f * animation_progress;
+	 * const auto* font = inter.get_instance({ { axis_tag("wght"), weight } });
+	 * if (font && inter.get_last_built()) {
+	 *     upload_texture(font->get_main_atlas());	// Only when the quantized instance changed to a new one.
+	 * }
+	 * @endcode
+	 *
+	 * @warning This class is not thread-safe. Pointers returned by `get_instance` stay valid until
+	 * a later call evicts that instance or the `variable_font` is destroyed.
+	 */
+	class variable_font
+	{
+		/**
+		 * @brief One built instance and when it was last requested.
+		 */
+		/**
+		 * @brief One design axis of the font, in design units.
+		 */
+		struct axis_range
+		{
+			std::uint32_t tag{};		// The axis's OpenType tag.
+			float minimum{};			// The lowest value FreeType applies.
+			float default_value{};		// The value used when the axis is not given.
+			float maximum{};			// The highest value FreeType applies.
+		};
+
+		struct instance
+		{
+			std::vector<variation_coordinate> coordinates{};	// The quantized coordinates it was built with.
+			std::unique_ptr<Font> font{};						// The built font.
+			std::uint64_t last_used{};							// `use_counter_` of the last request for it.
+		};
+
+		std::string font_name_{};					// The font file, as passed to `Font::Font_Px`.
+		unsigned int char_height_{};				// The pixel height every instance is built at.
+		unsigned int char_width_{};					// The pixel width every instance is built at.
+		build_options options_{};					// The options every instance is built with, minus `variation`.
+		variable_font_settings settings_{};
+		std::vector<axis_range> axes_{};			// The font's axes, read once; empty if it is not a variable font.
+		std::unordered_map<std::uint64_t, instance> instances_{};	// Quantized coordinates hash -> instance.
+		std::uint64_t use_counter_{};				// Incremented for every request, orders `last_used`.
+		bool last_built_{};							// Whether the last `get_instance` built its instance.
+
+		void read_axes();							// Fills `axes_` from the font file.
+		std::vector<variation_coordinate> quantize(std::span<const variation_coordinate> coordinates) const;	// Clamps, rounds, fills in defaults and sorts coordinates by tag.
+		void evict();								// Drops the least recently used instances beyond `max_instances`.
+
+	public:
+		/**
+		 * @brief Prepares a cache for a variable font. No atlas is built until `get_instance`.
+		 *
+		 * @param font_name The font file, resolved like `Font::Font_Px`.
+		 * @param char_height The pixel height of every instance.
+		 * @param char_width The pixel width of every instance (0 = derived from the height).
+		 * @param options The options every instance is built with; `variation` is ignored.
+		 * @param settings The quantization steps and instance limit.
+		 */
+		variable_font(std::string font_name, unsigned int char_height, unsigned int char_width = 0, const build_options& options = {}, const variable_font_settings& settings = {});
+		variable_font(const variable_font&) = delete;
+		variable_font& operator=(const variable_font&) = delete;
+
+		/**
+		 * @brief Returns the atlas for the instance nearest to `coordinates`, building it if it is not cached.
+		 *
+		 * @param coordinates The design-axis coordinates; axes not listed use the font's default.
+		 *
+		 * @return The instance's font, or null if it could not be built (e.g. an unknown axis).
+		 * Failed instances are not cached.
+		 */
+		const Font* get_instance(std::span<const variation_coordinate> coordinates);
+
+		/// Returns the atlas for the instance nearest to `coordinates`, building it if it is not cached.
+		inline const Font* get_instance(std::initializer_list<variation_coordinate> coordinates) { return get_instance(std::span{ coordinates.begin(), coordinates.size() }); }
+
+		/// Returns true if the last `get_instance` built a new atlas rather than returning a cached one.
+		inline bool get_last_built() const { return last_built_; }
+
+		/// Returns the number of instances currently cached.
+		inline std::size_t get_instance_count() const { return instances_.size(); }
+
+		/// Drops every cached instance.
+		void clear();
+	};
+}
@@ -0,0 +1,340 @@
+#include "Watcher.hpp"
+
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <ranges>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "GlyphCache.hpp"
+
+namespace
+{
+	std::filesystem::path normalize(const std::filesystem::path& path)
+	{
+		std::error_code error{};
+		const auto absolute{ std::filesystem::absolute(path, error) };
+		return (error ? path : absolute).lexically_normal();
+	}
+
+	void add_unique(std::vector<std::filesystem::path>& paths, const std::filesystem::path& path)
+	{
+		if (std::ranges::find(paths, path) == paths.end())
+		{
+			paths.push_back(path);
+		}
+	}
+
+#ifndef __linux__
+	std::filesystem::file_time_type get_write_time(const std::filesystem::path& path)
+	{
+		std::error_code error{};
+		const auto time{ std::filesystem::last_write_time(path, error) };
+		return error ? std::filesystem::file_time_type::min() : time;
+	}
+#endif
+}
+
+#pragma region file_watcher::constructors
+text_to_texture_atlas::baker::file_watcher::file_watcher()
+{
+#ifdef __linux__
+	inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+text_to_texture_atlas::baker::file_watcher::~file_watcher()
+{
+#ifdef __linux__
+	if (inotify_fd_ >= 0)
+	{
+		close(inotify_fd_);
+	}
+#endif
+}
+#pragma endregion
+
+#pragma region file_watcher::watch
+bool text_to_texture_atlas::baker::file_watcher::watch(const std::vector<std::filesystem::path>& files)
+{
+	std::vector<std::filesystem::path> normalized{};
+	for (const auto& file : files)
+	{
+		add_unique(normalized, normalize(file));
+	}
+
+#ifdef __linux__
+	files_ = std::move(normalized);
+	if (inotify_fd_ < 0)
+	{
+		return false;
+	}
+
+	// Directories rather than files are watched, so a file replaced by a rename keeps being watched.
+	// A directory that is already watched keeps its descriptor, so events queued before this call
+	// are still resolved; only directories no longer needed are removed.
+	std::unordered_map<int, std::filesystem::path> directories{};
+	bool watched{ true };
+	for (const auto& file : files_)
+	{
+		const auto directory{ file.parent_path() };
+		const int descriptor{ inotify_add_watch(inotify_fd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE) };
+		if (descriptor < 0)
+		{
+			watched = false;
+			continue;
+		}
+		directories[descriptor] = directory;
+	}
+	for (const auto descriptor : directories_ | std::views::keys)
+	{
+		if (!directories.contains(descriptor))
+		{
+			inotify_rm_watch(inotify_fd_, descriptor);
+		}
+	}
+	directories_ = std::move(directories);
+	return watched;
+#else
+	// Files that were already watched keep their last seen time, so a change made since is still reported.
+	std::vector<std::filesystem::file_time_type> write_times{};
+	for (const auto& file : normalized)
+	{
+		const auto previous{ std::ranges::find(files_, file) };
+		write_times.push_back(previous != files_.end() ? write_times_[static_cast<std::size_t>(previous - files_.begin())] : get_write_time(file));
+	}
+	files_ = std::move(normalized);
+	write_times_ = std::move(write_times);
+	return true;
+#endif
+}
+#pragma endregion
+
+#pragma region file_watcher::collect_changes
+bool text_to_texture_atlas::baker::file_watcher::collect_changes
+(
+	std::vector<std::filesystem::path>& changed,
+	const std::chrono::milliseconds timeout
+)
+{
+	bool found{};
+#ifdef __linux__
+	pollfd descriptor{ .fd = inotify_fd_, .events = POLLIN, .revents = 0 };
+	if (poll(&descriptor, 1, static_cast<int>(timeout.count())) <= 0)
+	{
+		return false;
+	}
+
+	alignas(inotify_event) std::array<char, 16 * 1024> buffer{};
+	for (;;)
+	{
+		const auto length{ read(inotify_fd_, buffer.data(), buffer.size()) };
+		if (length <= 0)
+		{
+			break;
+		}
+
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const auto* event{ reinterpret_cast<const inotify_event*>(buffer.data() + offset) };
+			offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+			const auto directory{ directories_.find(event->wd) };
+			if (event->len == 0 || directory == directories_.end())
+			{
+				continue;
+			}
+			const auto path{ (directory->second / event->name).lexically_normal() };
+			if (std::ranges::find(files_, path) != files_.end())
+			{
+				add_unique(changed, path);
+				found = true;
+			}
+		}
+	}
+#else
+	constexpr std::chrono::milliseconds poll_interval{ 100 };
+	const auto deadline{ std::chrono::steady_clock::now() + timeout };
+	do
+	{
+		std::this_thread::sleep_for(std::min(poll_interval, timeout));
+		for (size_t i = 0; i < files_.size(); i++)
+		{
+			const auto time{ get_write_time(files_[i]) };
+			if (time != write_times_[i])
+			{
+				write_times_[i] = time;
+				add_unique(changed, files_[i]);
+				found = true;
+			}
+		}
+	} while (!found && std::chrono::steady_clock::now() < deadline);
+#endif
+	return found;
+}
+#pragma endregion
+
+#pragma region file_watcher::wait
+bool text_to_texture_atlas::baker::file_watcher::wait
+(
+	std::vector<std::filesystem::path>& changed,
+	const std::chrono::milliseconds quiet_period,
+	const std::stop_token stop
+)
+{
+	constexpr std::chrono::milliseconds stop_check_interval{ 250 };
+	changed.clear();
+
+#ifdef __linux__
+	if (inotify_fd_ < 0)
+	{
+		return false;
+	}
+#endif
+
+	while (!collect_changes(changed, stop_check_interval))
+	{
+		if (stop.stop_requested())
+		{
+			return false;
+		}
+	}
+	while (collect_changes(changed, quiet_period))
+	{
+	}
+	return true;
+}
+#pragma endregion
+
+#pragma region watch_manifest
+bool text_to_texture_atlas::baker::watch_manifest
+(
+	const std::filesystem::path& manifest_path,
+	const bake_settings& settings,
+	std::ostream& out,
+	const std::stop_token stop
+)
+{
+	manifest current{};
+	std::string error{};
+	if (!parse_manifest(manifest_path, current, error))
+	{
+		out << error << "\n";
+		return false;
+	}
+
+	glyph_cache cache{};
+	bake_settings session_settings{ settings };
+	session_settings.cache = &cache;
+
+	// The face hash of every font, kept so glyphs of fonts that changed or are gone can be dropped.
+	std::unordered_map<std::string, std::uint64_t> font_hashes{};
+	const auto record_results = [&](const manifest& baked, const std::vector<bake_result>& results)
+	{
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			font_hashes[baked.entries[i].font.string()] = results[i].font_hash;
+		}
+
+		std::vector<std::uint64_t> live_faces{};
+		for (const auto& entry : current.entries)
+		{
+			const auto found{ font_hashes.find(entry.font.string()) };
+			if (found != font_hashes.end())
+			{
+				live_faces.push_back(found->second);
+			}
+		}
+		const auto dropped{ cache.retain_faces(live_faces) };
+
+		out << "glyph cache: " << cache.size() << " glyphs, " << cache.get_memory_usage() / 1024 << " KiB, "
+			<< cache.get_hits() << " hits, " << cache.get_misses() << " misses";
+		if (dropped)
+		{
+			out << ", " << dropped << " stale glyphs dropped";
+		}
+		out << "\n";
+	};
+
+	// Watching starts before every bake, so files saved while a bake runs are reported after it.
+	const auto manifest_file{ normalize(manifest_path) };
+	file_watcher watcher{};
+	std::vector<std::filesystem::path> watched{};
+	const auto update_watched = [&]
+	{
+		std::vector<std::filesystem::path> files{ manifest_file };
+		for (const auto& entry : current.entries)
+		{
+			add_unique(files, entry.font);
+		}
+		if (files == watched)
+		{
+			return true;
+		}
+		watched = std::move(files);
+		return watcher.watch(watched);
+	};
+	if (!update_watched())
+	{
+		out << "cannot watch the manifest and its fonts\n";
+		return false;
+	}
+
+	record_results(current, bake_manifest(current, session_settings, out));
+	session_settings.force = false;
+
+	std::vector<std::filesystem::path> changed{};
+	while (!stop.stop_requested())
+	{
+		out << "watching " << watched.size() << " files, press Ctrl+C to stop\n" << std::flush;
+
+		if (!watcher.wait(changed, std::chrono::milliseconds{ 200 }, stop))
+		{
+			break;
+		}
+
+		manifest next{ current };
+		if (std::ranges::find(changed, manifest_file) != changed.end() && !parse_manifest(manifest_path, next, error))
+		{
+			out << error << "\n";
+			continue;
+		}
+
+		// An entry is affected if it is new, any of its settings changed, or its font file changed.
+		manifest affected{ .path = next.path, .entries = {} };
+		for (const auto& entry : next.entries)
+		{
+			const auto previous{ std::ranges::find(current.entries, entry.name, &manifest_entry::name) };
+			const bool settings_changed{ previous == current.entries.end()
+				|| previous->output != entry.output
+				|| hash_entry_settings(*previous) != hash_entry_settings(entry) };
+			const bool font_changed{ std::ranges::find(changed, entry.font) != changed.end() };
+			if (settings_changed || font_changed)
+			{
+				affected.entries.push_back(entry);
+			}
+		}
+
+		current = std::move(next);
+		if (!update_watched())
+		{
+			out << "cannot watch the manifest and its fonts\n";
+			return false;
+		}
+		if (affected.entries.empty())
+		{
+			out << "no entries affected\n";
+			continue;
+		}
+		record_results(affected, bake_manifest(affected, session_settings, out));
+	}
+	return true;
+}
+#pragma endregion
@@ -0,0 +1,92 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <stop_token>
+#include <unordered_map>
+#include <vector>
+
+#include "Baker.hpp"
+
+namespace text_to_texture_atlas::baker
+{
+	/**
+	 * @brief
+	 * **Reports which of a set of files were written, replaced or deleted.**
+	 *
+	 * @details
+	 * On Linux the watcher uses inotify on the files' parent directories, so editors that save by
+	 * writing a new file and renaming it over the old one are reported as well. On other platforms
+	 * it falls back to polling each file's last write time.
+	 *
+	 * @warning This class is not thread-safe.
+	 */
+	class file_watcher
+	{
+		std::vector<std::filesystem::path> files_{};	// The watched files, absolute and normalized.
+#ifdef __linux__
+		int inotify_fd_{ -1 };							// The inotify instance, -1 if it could not be created.
+		std::unordered_map<int, std::filesystem::path> directories_{};	// Watch descriptor -> watched directory.
+#else
+		std::vector<std::filesystem::file_time_type> write_times_{};	// Last seen write time of each file in `files_`.
+#endif
+
+		bool collect_changes(std::vector<std::filesystem::path>& changed, std::chrono::milliseconds timeout);	// Adds changed files to `changed`, waiting up to `timeout` for the first one.
+
+	public:
+		file_watcher();
+		~file_watcher();
+		file_watcher(const file_watcher&) = delete;
+		file_watcher& operator=(const file_watcher&) = delete;
+
+		/**
+		 * @brief Replaces the set of watched files.
+		 *
+		 * @details Changes to files that stay watched are kept: those made before this call are
+		 * still reported by the next `wait`.
+		 *
+		 * @return true if every file could be watched, false otherwise.
+		 */
+		bool watch(const std::vector<std::filesystem::path>& files);
+
+		/**
+		 * @brief Blocks until at least one watched file changed, then until no more changes arrive.
+		 *
+		 * @param changed Receives every watched file that changed, without duplicates.
+		 * @param quiet_period How long the files must stay unchanged before returning, so a save
+		 * that touches a file several times is reported once.
+		 * @param stop Returns early with no changes when a stop is requested.
+		 *
+		 * @return true if files changed, false if stopped or the watcher failed.
+		 */
+		bool wait(std::vector<std::filesystem::path>& changed, std::chrono::milliseconds quiet_period = std::chrono::milliseconds{ 200 }, std::stop_token stop = {});
+	};
+
+	/**
+	 * @brief
+	 * **Bakes a manifest, then keeps rebaking the affected entries whenever their inputs change.**
+	 *
+	 * @details
+	 * The manifest file and every font it references are watched. When something changes:
+	 *
+	 * - A changed manifest is parsed again. If it no longer parses, the error is printed and the
+	 *   previous manifest stays in effect until the next change.
+	 * - Only entries that are new, whose settings changed, or whose font file changed are baked.
+	 *   Entries removed from the manifest keep their outputs.
+	 * - Stamps still apply, so a font that was saved without changing its contents is skipped.
+	 *
+	 * Every build in the session shares one `glyph_cache`, so an entry whose charset, format or
+	 * packer changed only renders glyphs it has not rendered before. Glyphs of font files that are
+	 * no longer referenced, or whose contents changed, are dropped after every rebake.
+	 *
+	 * @param manifest_path The manifest to bake and watch.
+	 * @param settings Parallelism and rebuild settings for the initial bake. `force` applies to the
+	 * initial bake only and `cache` is replaced by the session's cache.
+	 * @param out The stream progress lines are written to.
+	 * @param stop Ends the session when a stop is requested.
+	 *
+	 * @return false if the manifest could not be parsed initially or the files could not be
+	 * watched, true when stopped.
+	 */
+	bool watch_manifest(const std::filesystem::path& manifest_path, const bake_settings& settings = {}, std::ostream& out = std::cout, std::stop_token stop = {});
+}
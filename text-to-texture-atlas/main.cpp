@@ -1,30 +1,399 @@
 #include "Font.hpp"
+#include "Baker.hpp"
+#include "Benchmarks.hpp"
+#include "Service.hpp"
+#include "Watcher.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <vector>
 
-int main()
+namespace
 {
-	/*
-	auto before{ std::chrono::system_clock::now() };
-	auto arial = text_to_texture_atlas::Font::Font_Px("arial.tff", 100, 100);
-	auto char_a = arial.get_character('a');
-	char_a.output_raw();
-	char_a.output_buffer_positions();
-	char_a.output_texture_coordinates();
-	/*
-	text_to_texture_atlas::Font::Font_Px("arial.ttf", 600, 600);
-	auto after{ std::chrono::system_clock::now() };
-	auto check = after - before;
-	std::cout << std::chrono::duration_cast<std::chrono::milliseconds>(check) << "\n";
-	//arial.get_character('a').output_raw();
-
-	//auto& _char = arial.get_character('b');
-	//auto& atlas = arial.get_main_atlas();
-
-	//std::string path{ "C:/Users/Luke - Home/Desktop/New folder/test3.png" };
-	//text_to_texture_atlas::character_to_png::character_to_png(path, atlas.atlas_buffer, atlas.width, atlas.height);
-	*/
-
-	return 0;
-
-}
\ No newline at end of file
+	std::atomic<bool> interrupted{};	// Set by SIGINT or SIGTERM; a lock-free atomic is safe to store from a signal handler.
+
+	void handle_interrupt(int)
+	{
+		interrupted.store(true);
+	}
+
+	// Requests a stop on `source` when SIGINT or SIGTERM arrives, so long-running commands can clean
+	// up (remove their socket, unlink shared memory) instead of being killed. The stop is requested
+	// from a thread rather than the handler, since `request_stop` is not async-signal-safe.
+	std::jthread forward_interrupts(std::stop_source source)
+	{
+		std::signal(SIGINT, handle_interrupt);
+		std::signal(SIGTERM, handle_interrupt);
+		return std::jthread{ [source](const std::stop_token stop) mutable
+		{
+			while (!stop.stop_requested() && !interrupted.load())
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds{ 50 });
+			}
+			if (interrupted.load())
+			{
+				source.request_stop();
+			}
+		} };
+	}
+
+	void print_usage()
+	{
+		std::cout
+			<< "usage:\n"
+			<< "  text-to-texture-atlas bake <manifest> [--jobs <n>] [--force] [--watch] [--glyph-pack <file>]\n"
+			<< "      Bakes every entry of the manifest into <output>.pam / .json / .stamp.\n"
+			<< "      Entries whose font file and settings are unchanged are skipped.\n"
+			<< "      --watch keeps running and rebakes the entries affected by every change\n"
+			<< "      to the manifest or its fonts, reusing already rasterized glyphs.\n"
+			<< "      --glyph-pack reuses glyphs rasterized by earlier or concurrent bakes\n"
+			<< "      through a shared on-disk pack file, and adds newly rendered ones to it.\n"
+			<< "  text-to-texture-atlas serve <socket> [--max-cached <n>] [--max-cache-mb <n>] [--glyph-pack <file>]\n"
+			<< "      Builds atlases on request over a Unix domain socket and publishes them in\n"
+			<< "      shared memory. Identical requests are built once and answered from a cache.\n"
+			<< "      --max-cache-mb caps the glyphs kept for rebuilds (default 256).\n"
+			<< "  text-to-texture-atlas request <socket> <request>\n"
+			<< "      Sends one request line, e.g. \"build font=/fonts/Inter.ttf; size=px:32\", and\n"
+			<< "      prints the response.\n"
+			<< "  text-to-texture-atlas bench-raster <font-path> [<px> ...]\n"
+			<< "      Compares the built-in scanline rasterizer against FT_Render_Glyph.\n"
+			<< "  text-to-texture-atlas bench-pack <font-path | file.rects> ... [--px <n>] ... [--page <n>] [--save <file.rects>]\n"
+			<< "      Compares the atlas packers on the glyph sizes of each font at every --px\n"
+			<< "      (default 16, 32, 64) for ASCII, Latin-1 and a CJK subset, or on rect sets\n"
+			<< "      recorded earlier with --save. --page is the largest page side (default 4096).\n";
+	}
+
+	bool parse_unsigned(const std::string_view text, unsigned int& value)
+	{
+		const auto [end, ec] { std::from_chars(text.data(), text.data() + text.size(), value) };
+		return ec == std::errc{} && end == text.data() + text.size();
+	}
+
+	int run_bake(const std::vector<std::string_view>& args)
+	{
+		using namespace text_to_texture_atlas::baker;
+
+		std::string_view manifest_path{};
+		bake_settings settings{};
+		bool watch{};
+		std::string_view pack_path{};
+		for (size_t i = 0; i < args.size(); i++)
+		{
+			if (args[i] == "--force")
+			{
+				settings.force = true;
+			}
+			else if (args[i] == "--watch")
+			{
+				watch = true;
+			}
+			else if (args[i] == "--jobs" && i + 1 < args.size() && parse_unsigned(args[i + 1], settings.jobs))
+			{
+				i++;
+			}
+			else if (args[i] == "--glyph-pack" && i + 1 < args.size())
+			{
+				pack_path = args[++i];
+			}
+			else if (manifest_path.empty() && !args[i].starts_with("--"))
+			{
+				manifest_path = args[i];
+			}
+			else
+			{
+				print_usage();
+				return 2;
+			}
+		}
+		if (manifest_path.empty())
+		{
+			print_usage();
+			return 2;
+		}
+
+		text_to_texture_atlas::glyph_pack pack{};
+		if (!pack_path.empty())
+		{
+			if (pack.open(std::filesystem::path{ pack_path }))
+			{
+				settings.pack = &pack;
+			}
+			else
+			{
+				std::cerr << pack_path << ": cannot open glyph pack, baking without it\n";
+			}
+		}
+
+		if (watch)
+		{
+			std::stop_source stop{};
+			const auto forwarder{ forward_interrupts(stop) };
+			return watch_manifest(std::filesystem::path{ manifest_path }, settings, std::cout, stop.get_token()) ? 0 : 2;
+		}
+
+		manifest source{};
+		std::string error{};
+		if (!parse_manifest(std::filesystem::path{ manifest_path }, source, error))
+		{
+			std::cerr << error << "\n";
+			return 2;
+		}
+
+		const auto results{ bake_manifest(source, settings) };
+		if (settings.pack)
+		{
+			std::cout << "glyph pack: " << settings.pack->size() << " glyphs in " << settings.pack->get_path().string() << "\n";
+		}
+		const bool failed{ std::ranges::any_of(results, [](const bake_result& result) { return result.status == bake_status::failed; }) };
+		return failed ? 1 : 0;
+	}
+
+	int run_serve(const std::vector<std::string_view>& args)
+	{
+		using namespace text_to_texture_atlas::baker;
+
+		std::string_view socket_path{};
+		service_settings settings{};
+		std::string_view pack_path{};
+		for (size_t i = 0; i < args.size(); i++)
+		{
+			unsigned int max_cached{};
+			unsigned int max_cache_mb{};
+			if (args[i] == "--max-cached" && i + 1 < args.size() && parse_unsigned(args[i + 1], max_cached))
+			{
+				settings.max_cached = max_cached;
+				i++;
+			}
+			else if (args[i] == "--max-cache-mb" && i + 1 < args.size() && parse_unsigned(args[i + 1], max_cache_mb))
+			{
+				settings.max_cache_bytes = std::size_t{ max_cache_mb } * 1024 * 1024;
+				i++;
+			}
+			else if (args[i] == "--glyph-pack" && i + 1 < args.size())
+			{
+				pack_path = args[++i];
+			}
+			else if (socket_path.empty() && !args[i].starts_with("--"))
+			{
+				socket_path = args[i];
+			}
+			else
+			{
+				print_usage();
+				return 2;
+			}
+		}
+		if (socket_path.empty())
+		{
+			print_usage();
+			return 2;
+		}
+
+		text_to_texture_atlas::glyph_pack pack{};
+		if (!pack_path.empty())
+		{
+			if (pack.open(std::filesystem::path{ pack_path }))
+			{
+				settings.pack = &pack;
+			}
+			else
+			{
+				std::cerr << pack_path << ": cannot open glyph pack, serving without it\n";
+			}
+		}
+
+		std::stop_source stop{};
+		const auto forwarder{ forward_interrupts(stop) };
+		return serve(std::filesystem::path{ socket_path }, settings, std::cout, stop.get_token()) ? 0 : 2;
+	}
+
+	int run_request(const std::vector<std::string_view>& args)
+	{
+		if (args.size() < 2)
+		{
+			print_usage();
+			return 2;
+		}
+
+		// The request may arrive as one quoted argument or split by the shell.
+		std::string request{};
+		for (size_t i = 1; i < args.size(); i++)
+		{
+			request += (i > 1 ? " " : "") + std::string{ args[i] };
+		}
+
+		std::string response{};
+		if (!text_to_texture_atlas::baker::send_request(std::filesystem::path{ args[0] }, request, response))
+		{
+			std::cerr << args[0] << ": cannot reach the service\n";
+			return 2;
+		}
+		std::cout << response << "\n";
+		return response.starts_with("ok") ? 0 : 1;
+	}
+
+	int run_bench_raster(const std::vector<std::string_view>& args)
+	{
+		if (args.empty())
+		{
+			print_usage();
+			return 2;
+		}
+
+		std::vector<unsigned int> pixel_heights{};
+		for (size_t i = 1; i < args.size(); i++)
+		{
+			unsigned int pixel_height{};
+			if (!parse_unsigned(args[i], pixel_height))
+			{
+				print_usage();
+				return 2;
+			}
+			pixel_heights.push_back(pixel_height);
+		}
+		if (pixel_heights.empty())
+		{
+			pixel_heights = { 32, 128, 600 };
+		}
+
+		return text_to_texture_atlas::benchmarks::run_rasterizer_benchmark(std::string{ args[0] }, pixel_heights, 10) ? 0 : 1;
+	}
+
+	int run_bench_pack(const std::vector<std::string_view>& args)
+	{
+		using namespace text_to_texture_atlas::benchmarks;
+
+		std::vector<std::string_view> inputs{};
+		std::vector<unsigned int> pixel_heights{};
+		unsigned int max_page_size{ 4096 };
+		std::string_view save_path{};
+		for (size_t i = 0; i < args.size(); i++)
+		{
+			unsigned int pixel_height{};
+			if (args[i] == "--px" && i + 1 < args.size() && parse_unsigned(args[i + 1], pixel_height))
+			{
+				pixel_heights.push_back(pixel_height);
+				i++;
+			}
+			else if (args[i] == "--page" && i + 1 < args.size() && parse_unsigned(args[i + 1], max_page_size))
+			{
+				i++;
+			}
+			else if (args[i] == "--save" && i + 1 < args.size())
+			{
+				save_path = args[++i];
+			}
+			else if (!args[i].starts_with("--"))
+			{
+				inputs.push_back(args[i]);
+			}
+			else
+			{
+				print_usage();
+				return 2;
+			}
+		}
+		if (inputs.empty())
+		{
+			print_usage();
+			return 2;
+		}
+		if (pixel_heights.empty())
+		{
+			pixel_heights = { 16, 32, 64 };
+		}
+
+		const std::pair<std::string_view, std::vector<text_to_texture_atlas::codepoint_range>> charsets[]{
+			{ "ascii", { { 32, 126 } } },
+			{ "latin-1", { { 32, 126 }, { 160, 255 } } },
+			{ "cjk", { { 0x4E00, 0x5DFF } } } };
+
+		std::vector<glyph_rect_set> sets{};
+		for (const auto input : inputs)
+		{
+			const std::filesystem::path path{ input };
+			if (path.extension() == ".rects")
+			{
+				std::ifstream file{ path };
+				if (!file || !read_rect_sets(file, sets))
+				{
+					std::cerr << input << ": cannot read rect sets\n";
+					return 1;
+				}
+				continue;
+			}
+			for (const auto pixel_height : pixel_heights)
+			{
+				for (const auto& [charset_name, charset] : charsets)
+				{
+					glyph_rect_set set{ .name = path.stem().string() + " " + std::string{ charset_name } + " " + std::to_string(pixel_height) + "px" };
+					if (!record_glyph_rects(path.string(), pixel_height, charset, set))
+					{
+						std::cerr << input << ": cannot load the font\n";
+						return 1;
+					}
+					sets.push_back(std::move(set));
+				}
+			}
+		}
+
+		if (!save_path.empty())
+		{
+			std::ofstream file{ std::filesystem::path{ save_path } };
+			write_rect_sets(sets, file);
+			if (!file)
+			{
+				std::cerr << save_path << ": cannot write rect sets\n";
+				return 1;
+			}
+		}
+
+		const auto packers{ get_packer_heuristics() };
+		const auto results{ run_packer_benchmark(sets, packers, max_page_size) };
+		return std::ranges::all_of(results, [](const packer_result& result) { return !result.packed || result.valid; }) ? 0 : 1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		print_usage();
+		return 2;
+	}
+
+	const std::string_view command{ argv[1] };
+	const std::vector<std::string_view> args(argv + 2, argv + argc);
+
+	if (command == "bake")
+	{
+		return run_bake(args);
+	}
+	if (command == "serve")
+	{
+		return run_serve(args);
+	}
+	if (command == "request")
+	{
+		return run_request(args);
+	}
+	if (command == "bench-raster")
+	{
+		return run_bench_raster(args);
+	}
+	if (command == "bench-pack")
+	{
+		return run_bench_pack(args);
+	}
+
+	print_usage();
+	return 2;
+}